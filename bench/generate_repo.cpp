@@ -0,0 +1,331 @@
+// Generate a synthetic repository for the benchmarks. The content is derived from a seeded
+// pseudo-random generator and the signatures have fixed dates, so that the same options always give
+// the same objects.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <git2.h>
+
+namespace
+{
+    struct generator_options
+    {
+        std::string path;
+        size_t commits = 100;
+        size_t files = 1000;
+        size_t file_size = 1024;
+        size_t depth = 3;
+        size_t fanout = 8;
+        size_t changes_per_commit = 10;
+        size_t tags = 20;
+        size_t branches = 20;
+        size_t topic_commits = 5;
+        size_t binary_files = 0;
+        size_t binary_size = 4 * 1024 * 1024;
+        uint64_t seed = 1;
+    };
+
+    constexpr int64_t first_commit_time = 1700000000;
+
+    void check(int error, const char* what)
+    {
+        if (error < 0)
+        {
+            const git_error* last = git_error_last();
+            std::cerr << "error: " << what << ": " << (last ? last->message : "unknown error") << std::endl;
+            std::exit(1);
+        }
+    }
+
+    // xorshift64*
+    class random_generator
+    {
+    public:
+
+        explicit random_generator(uint64_t seed)
+            : m_state(seed ? seed : 1)
+        {
+        }
+
+        uint64_t next()
+        {
+            m_state ^= m_state >> 12;
+            m_state ^= m_state << 25;
+            m_state ^= m_state >> 27;
+            return m_state * 0x2545F4914F6CDD1DULL;
+        }
+
+        size_t below(size_t bound)
+        {
+            return bound ? size_t(next() % bound) : 0;
+        }
+
+    private:
+
+        uint64_t m_state;
+    };
+
+    // Files are spread over depth levels of fanout directories.
+    std::string text_file_path(size_t index, const generator_options& opts)
+    {
+        std::string path;
+        size_t n = index;
+        for (size_t level = 0; level < opts.depth; ++level)
+        {
+            path += "dir" + std::to_string(n % opts.fanout) + "/";
+            n /= opts.fanout;
+        }
+        return path + "file" + std::to_string(index) + ".txt";
+    }
+
+    std::string text_content(random_generator& rng, size_t size)
+    {
+        std::string content;
+        content.reserve(size + 32);
+        while (content.size() < size)
+        {
+            content += "line " + std::to_string(rng.next() % 1000000) + "\n";
+        }
+        return content;
+    }
+
+    std::string binary_content(random_generator& rng, size_t size)
+    {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            content[i] = char(rng.next() >> 56);
+        }
+        return content;
+    }
+
+    class generator
+    {
+    public:
+
+        generator(git_repository* repo, const generator_options& opts)
+            : m_repo(repo)
+            , m_opts(opts)
+            , m_rng(opts.seed)
+        {
+            check(git_index_new(&m_index), "create index");
+        }
+
+        ~generator()
+        {
+            git_index_free(m_index);
+        }
+
+        void run()
+        {
+            std::vector<git_oid> history;
+            history.reserve(m_opts.commits);
+            git_oid topic_base = {};
+
+            for (size_t c = 0; c < m_opts.commits; ++c)
+            {
+                if (c == 0)
+                {
+                    for (size_t i = 0; i < m_opts.files; ++i)
+                    {
+                        add_file(text_file_path(i, m_opts), text_content(m_rng, m_opts.file_size));
+                    }
+                    for (size_t i = 0; i < m_opts.binary_files; ++i)
+                    {
+                        add_file(
+                            "binary/blob" + std::to_string(i) + ".bin",
+                            binary_content(m_rng, m_opts.binary_size)
+                        );
+                    }
+                }
+                else
+                {
+                    for (size_t i = 0; i < m_opts.changes_per_commit; ++i)
+                    {
+                        const size_t index = m_rng.below(m_opts.files);
+                        add_file(text_file_path(index, m_opts), text_content(m_rng, m_opts.file_size));
+                    }
+                }
+
+                const git_oid* parent = history.empty() ? nullptr : &history.back();
+                history.push_back(commit("refs/heads/main", "Commit " + std::to_string(c), parent, c));
+                if (c == m_opts.commits / 2)
+                {
+                    topic_base = history.back();
+                }
+            }
+
+            // Tags and branches are spread evenly over the history.
+            for (size_t i = 0; i < m_opts.tags; ++i)
+            {
+                create_tag("v" + std::to_string(i), history[i * history.size() / m_opts.tags], i);
+            }
+            for (size_t i = 0; i < m_opts.branches; ++i)
+            {
+                create_branch("branch-" + std::to_string(i), history[i * history.size() / m_opts.branches]);
+            }
+
+            // The topic branch only adds files so that it merges into main without conflict.
+            if (m_opts.topic_commits > 0)
+            {
+                read_tree(topic_base);
+                git_oid tip = topic_base;
+                for (size_t i = 0; i < m_opts.topic_commits; ++i)
+                {
+                    const std::string path = "topic/file" + std::to_string(i) + ".txt";
+                    add_file(path, text_content(m_rng, m_opts.file_size));
+                    const std::string message = "Topic " + std::to_string(i);
+                    tip = commit("refs/heads/topic", message, &tip, m_opts.commits + i);
+                }
+            }
+        }
+
+    private:
+
+        void add_file(const std::string& path, const std::string& content)
+        {
+            git_index_entry entry = {};
+            check(
+                git_blob_create_from_buffer(&entry.id, m_repo, content.data(), content.size()),
+                "write blob"
+            );
+            entry.mode = GIT_FILEMODE_BLOB;
+            entry.path = path.c_str();
+            check(git_index_add(m_index, &entry), "add index entry");
+        }
+
+        void read_tree(const git_oid& commit_id)
+        {
+            git_commit* commit = nullptr;
+            git_tree* tree = nullptr;
+            check(git_commit_lookup(&commit, m_repo, &commit_id), "lookup commit");
+            check(git_commit_tree(&tree, commit), "lookup tree");
+            check(git_index_read_tree(m_index, tree), "read tree");
+            git_tree_free(tree);
+            git_commit_free(commit);
+        }
+
+        git_signature* signature(size_t tick)
+        {
+            git_signature* sig = nullptr;
+            const int64_t time = first_commit_time + int64_t(tick) * 60;
+            check(git_signature_new(&sig, "Bench Author", "bench@example.com", time, 0), "create signature");
+            return sig;
+        }
+
+        git_oid
+        commit(const std::string& ref, const std::string& message, const git_oid* parent_id, size_t tick)
+        {
+            git_oid tree_id;
+            check(git_index_write_tree_to(&tree_id, m_index, m_repo), "write tree");
+            git_tree* tree = nullptr;
+            check(git_tree_lookup(&tree, m_repo, &tree_id), "lookup tree");
+
+            git_commit* parent = nullptr;
+            if (parent_id)
+            {
+                check(git_commit_lookup(&parent, m_repo, parent_id), "lookup parent");
+            }
+            const git_commit* parents[] = {parent};
+
+            git_signature* sig = signature(tick);
+            git_oid commit_id;
+            check(
+                git_commit_create(
+                    &commit_id,
+                    m_repo,
+                    ref.c_str(),
+                    sig,
+                    sig,
+                    nullptr,
+                    message.c_str(),
+                    tree,
+                    parent ? 1 : 0,
+                    parents
+                ),
+                "create commit"
+            );
+
+            git_signature_free(sig);
+            git_commit_free(parent);
+            git_tree_free(tree);
+            return commit_id;
+        }
+
+        void create_tag(const std::string& name, const git_oid& target_id, size_t tick)
+        {
+            git_object* target = nullptr;
+            check(git_object_lookup(&target, m_repo, &target_id, GIT_OBJECT_COMMIT), "lookup tag target");
+            git_signature* sig = signature(tick);
+            git_oid tag_id;
+            const std::string message = "Release " + name;
+            check(
+                git_tag_create(&tag_id, m_repo, name.c_str(), target, sig, message.c_str(), 0),
+                "create tag"
+            );
+            git_signature_free(sig);
+            git_object_free(target);
+        }
+
+        void create_branch(const std::string& name, const git_oid& target_id)
+        {
+            git_commit* target = nullptr;
+            git_reference* branch = nullptr;
+            check(git_commit_lookup(&target, m_repo, &target_id), "lookup branch target");
+            check(git_branch_create(&branch, m_repo, name.c_str(), target, 0), "create branch");
+            git_reference_free(branch);
+            git_commit_free(target);
+        }
+
+        git_repository* m_repo;
+        const generator_options& m_opts;
+        random_generator m_rng;
+        git_index* m_index = nullptr;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    generator_options opts;
+
+    CLI::App app{"Generate a deterministic repository for the git2cpp benchmarks"};
+    app.add_option("<path>", opts.path, "Directory of the new repository")->required();
+    app.add_option("--commits", opts.commits, "Number of commits on main")->check(CLI::PositiveNumber);
+    app.add_option("--files", opts.files, "Number of text files")->check(CLI::PositiveNumber);
+    app.add_option("--file-size", opts.file_size, "Approximate size of the text files in bytes");
+    app.add_option("--depth", opts.depth, "Directory depth of the text files");
+    app.add_option("--fanout", opts.fanout, "Number of subdirectories per directory")
+        ->check(CLI::PositiveNumber);
+    app.add_option("--changes-per-commit", opts.changes_per_commit, "Number of files changed by each commit");
+    app.add_option("--tags", opts.tags, "Number of annotated tags");
+    app.add_option("--branches", opts.branches, "Number of branches");
+    app.add_option("--topic-commits", opts.topic_commits, "Number of commits of the topic branch");
+    app.add_option("--binary-files", opts.binary_files, "Number of binary files");
+    app.add_option("--binary-size", opts.binary_size, "Size of the binary files in bytes");
+    app.add_option("--seed", opts.seed, "Seed of the content generator");
+    CLI11_PARSE(app, argc, argv);
+
+    git_libgit2_init();
+
+    git_repository_init_options init_opts = GIT_REPOSITORY_INIT_OPTIONS_INIT;
+    init_opts.flags = GIT_REPOSITORY_INIT_MKPATH;
+    init_opts.initial_head = "main";
+    git_repository* repo = nullptr;
+    check(git_repository_init_ext(&repo, opts.path.c_str(), &init_opts), "init repository");
+
+    generator(repo, opts).run();
+
+    // Populate the index and the worktree from main.
+    git_checkout_options checkout_opts = GIT_CHECKOUT_OPTIONS_INIT;
+    checkout_opts.checkout_strategy = GIT_CHECKOUT_FORCE;
+    check(git_checkout_head(repo, &checkout_opts), "checkout main");
+
+    git_repository_free(repo);
+    git_libgit2_shutdown();
+    return 0;
+}
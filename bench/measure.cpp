@@ -0,0 +1,62 @@
+// Run a command with its standard output discarded and print its wall time in seconds and its peak
+// resident set size in KiB, then exit with its exit code.
+//
+// The peak RSS reported for a child process includes the memory of the process it was forked from
+// (the kernel records it when the child calls exec), measuring from the Python runner directly would
+// then report the size of the interpreter. This launcher only uses a few hundred KiB.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s <command> [<args>...]\n", argv[0]);
+        return 2;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        std::perror("fork");
+        return 2;
+    }
+    if (pid == 0)
+    {
+        const int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0)
+        {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        execvp(argv[1], argv + 1);
+        std::perror("execvp");
+        std::_Exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0)
+    {
+        std::perror("wait4");
+        return 2;
+    }
+    const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start;
+
+#ifdef __APPLE__
+    const long max_rss_kib = usage.ru_maxrss / 1024;
+#else
+    const long max_rss_kib = usage.ru_maxrss;
+#endif
+    std::printf("%.6f %ld\n", wall_time.count(), max_rss_kib);
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
@@ -0,0 +1,196 @@
+"""Run the git2cpp benchmarks on a generated repository and report the results as JSON.
+
+For each command the wall time of every run, the peak resident set size and, when strace is
+available, the number of system calls are reported. Commands modifying the repository run on a
+fresh copy of it each time, the copy is not part of the measurement.
+"""
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+# Options of the repository generator, with their default values.
+GENERATOR_OPTIONS = {
+    "commits": 500,
+    "files": 5000,
+    "file_size": 1024,
+    "depth": 3,
+    "fanout": 8,
+    "changes_per_commit": 20,
+    "tags": 100,
+    "branches": 50,
+    "topic_commits": 5,
+    "binary_files": 4,
+    "binary_size": 4 * 1024 * 1024,
+    "seed": 1,
+}
+
+
+def touch_files(repo, count):
+    """Modify and create files so that add -A has work to do."""
+    text_files = sorted((repo / "dir0").rglob("*.txt"))[:count]
+    for path in text_files:
+        with open(path, "a") as f:
+            f.write("modified\n")
+    new_dir = repo / "new"
+    new_dir.mkdir()
+    for i in range(count):
+        (new_dir / f"file{i}.txt").write_text(f"new file {i}\n")
+
+
+# name, command, setup of the repository copy or None if the command does not modify it.
+BENCHMARKS = [
+    ("status", ["status"], None),
+    ("log", ["log"], None),
+    ("diff", ["diff", "branch-0", "main"], None),
+    ("tag -l", ["tag", "-l"], None),
+    ("rev-list", ["rev-list", "--objects", "main"], None),
+    ("add -A", ["add", "-A"], lambda repo: touch_files(repo, 500)),
+    ("checkout", ["checkout", "branch-0"], lambda repo: None),
+    ("merge", ["merge", "topic"], lambda repo: None),
+]
+
+
+def run_once(measure, cmd, cwd, env):
+    """Return the wall time in seconds and the peak RSS in KiB of cmd."""
+    p = subprocess.run([measure, *cmd], cwd=cwd, env=env, capture_output=True, text=True)
+    if p.returncode != 0:
+        raise RuntimeError(f"{' '.join(map(str, cmd))} failed:\n{p.stderr}")
+    wall_time, max_rss_kib = p.stdout.split()
+    return float(wall_time), int(max_rss_kib)
+
+
+def count_syscalls(cmd, cwd, env):
+    """Return the number of system calls made by cmd, or None if strace is not available."""
+    strace = shutil.which("strace")
+    if strace is None:
+        return None
+    with tempfile.NamedTemporaryFile(mode="r", suffix=".strace") as summary:
+        strace_cmd = [strace, "-f", "-c", "-o", summary.name, *map(str, cmd)]
+        p = subprocess.run(strace_cmd, cwd=cwd, env=env, capture_output=True)
+        if p.returncode != 0:
+            return None
+        # Last line: "100.00    0.001234           1      1234        12 total"
+        for line in summary.read().splitlines():
+            fields = line.split()
+            if fields and fields[-1] == "total":
+                return int(fields[3])
+    return None
+
+
+def prepare(template, work_dir, setup):
+    """Return the directory to run the command in: the template itself or a fresh copy of it."""
+    if setup is None:
+        return template
+    copy = work_dir / "copy"
+    if copy.exists():
+        shutil.rmtree(copy)
+    shutil.copytree(template, copy, symlinks=True)
+    setup(copy)
+    return copy
+
+
+def run_benchmark(args, template, work_dir, benchmark, env):
+    name, git2cpp_args, setup = benchmark
+    cmd = [args.git2cpp, *git2cpp_args]
+    wall_times = []
+    peak_rss = 0
+    for _ in range(args.runs):
+        cwd = prepare(template, work_dir, setup)
+        wall_time, rss = run_once(args.measure, cmd, cwd, env)
+        wall_times.append(wall_time)
+        peak_rss = max(peak_rss, rss)
+
+    syscall_count = None
+    if not args.no_syscalls:
+        syscall_count = count_syscalls(cmd, prepare(template, work_dir, setup), env)
+
+    return {
+        "name": name,
+        "command": git2cpp_args,
+        "runs": args.runs,
+        "wall_time_s": {
+            "min": min(wall_times),
+            "median": statistics.median(wall_times),
+            "max": max(wall_times),
+        },
+        "peak_rss_kib": peak_rss,
+        "syscalls": syscall_count,
+    }
+
+
+def main():
+    root = Path(__file__).resolve().parent.parent
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--git2cpp", type=Path, default=root / "build" / "git2cpp")
+    parser.add_argument(
+        "--generator", type=Path, default=root / "build" / "bench" / "git2cpp-bench-repo"
+    )
+    parser.add_argument(
+        "--measure", type=Path, default=root / "build" / "bench" / "git2cpp-bench-measure"
+    )
+    parser.add_argument("--repo", type=Path, help="Use this generated repository as is")
+    parser.add_argument("--output", type=Path, help="JSON file to write (default: stdout)")
+    parser.add_argument("--runs", type=int, default=5, help="Number of runs per command")
+    parser.add_argument("--no-syscalls", action="store_true", help="Do not count system calls")
+    parser.add_argument(
+        "--filter", action="append", default=[], help="Only run the benchmarks of this name"
+    )
+    for option, default in GENERATOR_OPTIONS.items():
+        parser.add_argument(f"--{option.replace('_', '-')}", type=int, default=default)
+    args = parser.parse_args()
+
+    generator_options = {option: getattr(args, option) for option in GENERATOR_OPTIONS}
+    benchmarks = [b for b in BENCHMARKS if not args.filter or b[0] in args.filter]
+
+    # Fixed identity and no pager, the results must not depend on the user environment.
+    env = dict(os.environ)
+    env.update(
+        {
+            "GIT_AUTHOR_NAME": "Bench Author",
+            "GIT_AUTHOR_EMAIL": "bench@example.com",
+            "GIT_COMMITTER_NAME": "Bench Author",
+            "GIT_COMMITTER_EMAIL": "bench@example.com",
+            "PAGER": "cat",
+        }
+    )
+
+    with tempfile.TemporaryDirectory(prefix="git2cpp-bench-") as tmp:
+        work_dir = Path(tmp)
+        template = args.repo
+        if template is None:
+            template = work_dir / "repo"
+            generator_cmd = [args.generator, template]
+            for option, value in generator_options.items():
+                generator_cmd += [f"--{option.replace('_', '-')}", str(value)]
+            start = time.perf_counter()
+            subprocess.run(generator_cmd, check=True)
+            print(f"Generated repository in {time.perf_counter() - start:.1f}s", file=sys.stderr)
+
+        results = []
+        for benchmark in benchmarks:
+            print(f"Running {benchmark[0]}", file=sys.stderr)
+            results.append(run_benchmark(args, template, work_dir, benchmark, env))
+
+    report = {
+        "platform": platform.platform(),
+        "repository": generator_options if args.repo is None else str(args.repo),
+        "benchmarks": results,
+    }
+    text = json.dumps(report, indent=2)
+    if args.output:
+        args.output.write_text(text + "\n")
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
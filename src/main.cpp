@@ -1,13 +1,17 @@
 #include <cmath>
+#include <functional>
 #include <iostream>
+#include <string>
 
 #include <CLI/CLI.hpp>
 #include <git2.h>  // For version number only
 
 #include "subcommand/add_subcommand.hpp"
+#include "subcommand/batch_subcommand.hpp"
 #include "subcommand/branch_subcommand.hpp"
 #include "subcommand/checkout_subcommand.hpp"
 #include "subcommand/clone_subcommand.hpp"
+#include "subcommand/commit_graph_subcommand.hpp"
 #include "subcommand/commit_subcommand.hpp"
 #include "subcommand/config_subcommand.hpp"
 #include "subcommand/diff_subcommand.hpp"
@@ -23,31 +27,57 @@
 #include "subcommand/revlist_subcommand.hpp"
 #include "subcommand/revparse_subcommand.hpp"
 #include "subcommand/rm_subcommand.hpp"
+#include "subcommand/sparse_checkout_subcommand.hpp"
 #include "subcommand/stash_subcommand.hpp"
 #include "subcommand/status_subcommand.hpp"
 #include "subcommand/tag_subcommand.hpp"
 #include "utils/git_exception.hpp"
+#include "utils/trace.hpp"
 #include "version.hpp"
 
-int main(int argc, char** argv)
+// Build the command line interface, parse the arguments with parse and run the selected subcommand,
+// returning the exit code.
+static int run_command(const libgit2_object& lg2_obj, const std::function<void(CLI::App&)>& parse)
 {
     int exit_code = 0;
     try
     {
-        const libgit2_object lg2_obj;
         CLI::App app{"Git using C++ wrapper of libgit2"};
 
         // Top-level command options.
         auto version = app.add_flag("-v,--version", "Show version");
+        app.add_flag_callback(
+            "--timings",
+            []()
+            {
+                trace::enable();
+            },
+            "Report the time spent in each phase of the command on stderr"
+        );
 
         // Sub commands
         init_subcommand init(lg2_obj, app);
         status_subcommand status(lg2_obj, app);
         add_subcommand add(lg2_obj, app);
+        batch_subcommand batch(
+            lg2_obj,
+            app,
+            [&lg2_obj](const std::string& command_line)
+            {
+                return run_command(
+                    lg2_obj,
+                    [&command_line](CLI::App& batch_app)
+                    {
+                        batch_app.parse(command_line, /* program_name_included */ false);
+                    }
+                );
+            }
+        );
         branch_subcommand branch(lg2_obj, app);
         checkout_subcommand checkout(lg2_obj, app);
         clone_subcommand clone(lg2_obj, app);
         commit_subcommand commit(lg2_obj, app);
+        commit_graph_subcommand commit_graph(lg2_obj, app);
         config_subcommand config(lg2_obj, app);
         diff_subcommand diff(lg2_obj, app);
         fetch_subcommand fetch(lg2_obj, app);
@@ -61,12 +91,20 @@ int main(int argc, char** argv)
         revlist_subcommand revlist(lg2_obj, app);
         revparse_subcommand revparse(lg2_obj, app);
         rm_subcommand rm(lg2_obj, app);
+        sparse_checkout_subcommand sparse(lg2_obj, app);
         stash_subcommand stash(lg2_obj, app);
         tag_subcommand tag(lg2_obj, app);
 
         app.require_subcommand(/* min */ 0, /* max */ 1);
 
-        CLI11_PARSE(app, argc, argv);
+        try
+        {
+            parse(app);
+        }
+        catch (const CLI::ParseError& e)
+        {
+            return app.exit(e);
+        }
 
         if (version->count())
         {
@@ -96,3 +134,18 @@ int main(int argc, char** argv)
 
     return exit_code;
 }
+
+int main(int argc, char** argv)
+{
+    trace::enable_from_environment();
+    const libgit2_object lg2_obj;
+    const int exit_code = run_command(
+        lg2_obj,
+        [argc, argv](CLI::App& app)
+        {
+            app.parse(argc, argv);
+        }
+    );
+    trace::report();
+    return exit_code;
+}
@@ -2,6 +2,8 @@
 
 #include <git2.h>
 
+#include "../utils/parallel.hpp"
+#include "../utils/progress.hpp"
 #include "../wrapper/index_wrapper.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 
@@ -12,6 +14,8 @@ add_subcommand::add_subcommand(const libgit2_object&, CLI::App& app)
     sub->add_option("<files>", m_add_files, "Files to add");
 
     sub->add_flag("-A,--all,--no-ignore-removal", m_all_flag, "");
+    sub->add_flag("--progress", m_progress_flag, "Report the progress of hashing the files");
+    sub->add_flag("--pack", m_pack_flag, "Write the new objects in a single pack instead of loose objects");
     // sub->add_flag("-n,--dryrun", dryrun_flag, "");
     // sub->add_flag("-u,--update", update_flag, "");
     // sub->add_flag("-v,--verbose", verbose_flag, "");
@@ -31,14 +35,28 @@ void add_subcommand::run()
 
     index_wrapper index = repo.make_index();
 
+    index_add_options options;
+    // Files are hashed on several threads with git2cpp.addThreads > 1 (0 for one per core).
+    options.thread_count = resolve_thread_count(repo.get_config().get_int("git2cpp.addThreads", 1));
+    if (m_progress_flag)
+    {
+        options.progress = add_progress;
+    }
+    if (m_pack_flag || repo.get_config().get_bool("git2cpp.packNewObjects", false))
+    {
+        repo.enable_pack_writes();
+        options.shared_odb = true;
+    }
+
     if (m_all_flag)
     {
-        index.add_all();
-        index.write();
+        index.add_all(options);
     }
     else
     {
-        index.add_entries(m_add_files);
-        index.write();
+        index.add_entries(m_add_files, options);
     }
+    // The blobs are on disk before the index refers to them.
+    repo.write_pack();
+    index.write();
 }
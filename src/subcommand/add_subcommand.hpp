@@ -14,5 +14,7 @@ public:
 private:
 
     bool m_all_flag = false;
+    bool m_progress_flag = false;
+    bool m_pack_flag = false;
     std::vector<std::string> m_add_files;
 };
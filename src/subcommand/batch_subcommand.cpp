@@ -0,0 +1,150 @@
+#include "batch_subcommand.hpp"
+
+#include <iostream>
+#include <sstream>
+
+#include "../utils/git_exception.hpp"
+#include "../utils/terminal_pager.hpp"
+#include "../utils/trace.hpp"
+#include "../wrapper/repository_wrapper.hpp"
+
+batch_subcommand::batch_subcommand(const libgit2_object&, CLI::App& app, command_runner runner)
+    : m_runner(std::move(runner))
+{
+    auto* sub = app.add_subcommand("batch", "Run the commands read from stdin in a single process");
+
+    sub->add_flag("-z", m_nul_flag, "Command lines are terminated by NUL instead of newline");
+
+    sub->callback(
+        [this]()
+        {
+            this->run();
+        }
+    );
+}
+
+namespace
+{
+    // Redirect a stream to a string buffer for the lifetime of the object.
+    class stream_capture : private noncopyable_nonmovable
+    {
+    public:
+
+        explicit stream_capture(std::ostream& stream)
+            : m_stream(stream)
+            , m_previous(stream.rdbuf(&m_buffer))
+        {
+        }
+
+        ~stream_capture()
+        {
+            m_stream.rdbuf(m_previous);
+        }
+
+        std::string_view view() const
+        {
+            return m_buffer.view();
+        }
+
+    private:
+
+        std::stringbuf m_buffer;
+        std::ostream& m_stream;
+        std::streambuf* m_previous;
+    };
+
+    // Give the commands an empty stdin, so that they cannot read the command lines of the batch.
+    class empty_input : private noncopyable_nonmovable
+    {
+    public:
+
+        empty_input()
+            : m_previous(std::cin.rdbuf(&m_buffer))
+        {
+        }
+
+        ~empty_input()
+        {
+            // Setting the buffer back also clears the end of file state left by the command.
+            std::cin.rdbuf(m_previous);
+        }
+
+    private:
+
+        std::stringbuf m_buffer;
+        std::streambuf* m_previous;
+    };
+
+    class odb_sharing_guard : private noncopyable_nonmovable
+    {
+    public:
+
+        odb_sharing_guard()
+        {
+            repository_wrapper::set_odb_sharing(true);
+        }
+
+        ~odb_sharing_guard()
+        {
+            repository_wrapper::set_odb_sharing(false);
+        }
+    };
+
+    bool batch_running = false;
+
+    class batch_running_guard : private noncopyable_nonmovable
+    {
+    public:
+
+        batch_running_guard()
+        {
+            if (batch_running)
+            {
+                throw git_exception("fatal: batch cannot be nested", git2cpp_error_code::BAD_ARGUMENT);
+            }
+            batch_running = true;
+        }
+
+        ~batch_running_guard()
+        {
+            batch_running = false;
+        }
+    };
+}
+
+void batch_subcommand::run()
+{
+    batch_running_guard running;
+
+    // The output of the commands is captured, it must never be paged.
+    terminal_pager::disable();
+    odb_sharing_guard odb_sharing;
+
+    const char delimiter = m_nul_flag ? '\0' : '\n';
+    std::string command_line;
+    while (std::getline(std::cin, command_line, delimiter))
+    {
+        if (trim(command_line).empty())
+        {
+            continue;
+        }
+
+        int exit_code = 0;
+        std::string out;
+        std::string err;
+        {
+            stream_capture out_capture(std::cout);
+            stream_capture err_capture(std::cerr);
+            empty_input input;
+            {
+                trace::command_scope trace_scope;
+                exit_code = m_runner(command_line);
+                trace::report();
+            }
+            out = out_capture.view();
+            err = err_capture.view();
+        }
+
+        std::cout << exit_code << ' ' << out.size() << ' ' << err.size() << '\n' << out << err << std::flush;
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <CLI/CLI.hpp>
+
+#include "../utils/common.hpp"
+
+/**
+ * Run many commands in a single process. Command lines are read from stdin, one per line (or NUL
+ * terminated with -z), with the same quoting rules as a shell. For each of them a response frame is
+ * written to stdout:
+ *
+ *     <exit code> <stdout size> <stderr size>\n<stdout bytes><stderr bytes>
+ *
+ * The frame is flushed before the next command line is read. Process startup and libgit2
+ * initialisation are only paid once, and the repositories opened by the commands share their
+ * object database.
+ */
+class batch_subcommand
+{
+public:
+
+    // Parse and run a command line, returning its exit code.
+    using command_runner = std::function<int(const std::string& command_line)>;
+
+    explicit batch_subcommand(const libgit2_object&, CLI::App& app, command_runner runner);
+    void run();
+
+private:
+
+    command_runner m_runner;
+    bool m_nul_flag = false;
+};
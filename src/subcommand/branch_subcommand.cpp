@@ -2,6 +2,7 @@
 
 #include <iostream>
 
+#include "../utils/output_sink.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 
 branch_subcommand::branch_subcommand(const libgit2_object&, CLI::App& app)
@@ -59,15 +60,16 @@ void branch_subcommand::run_list(const repository_wrapper& repo)
     git_branch_t type = m_all_flag ? GIT_BRANCH_ALL : (m_remote_flag ? GIT_BRANCH_REMOTE : GIT_BRANCH_LOCAL);
     auto iter = repo.iterate_branches(type);
     auto br = iter.next();
+    output_sink out;
     while (br)
     {
         if (br->name() != head_name)
         {
-            std::cout << "  " << br->name() << std::endl;
+            out << "  " << br->name() << '\n';
         }
         else
         {
-            std::cout << "* " << br->name() << std::endl;
+            out << "* " << br->name() << '\n';
         }
         br = iter.next();
     }
@@ -3,9 +3,13 @@
 #include <iostream>
 #include <set>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "../subcommand/status_subcommand.hpp"
 #include "../utils/git_exception.hpp"
+#include "../utils/output_sink.hpp"
+#include "../utils/stat_cache.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 #include "../wrapper/status_wrapper.hpp"
 
@@ -30,17 +34,20 @@ checkout_subcommand::checkout_subcommand(const libgit2_object&, CLI::App& app)
     );
 }
 
-void print_no_switch(status_list_wrapper& sl)
+void print_no_switch(
+    const std::vector<std::string>& modified_paths,
+    const std::vector<std::string>& deleted_paths
+)
 {
     std::cout << "Your local changes to the following files would be overwritten by checkout:" << std::endl;
 
-    for (const auto* entry : sl.get_entry_list(GIT_STATUS_WT_MODIFIED))
+    for (const auto& path : modified_paths)
     {
-        std::cout << "\t" << entry->index_to_workdir->new_file.path << std::endl;
+        std::cout << "\t" << path << std::endl;
     }
-    for (const auto* entry : sl.get_entry_list(GIT_STATUS_WT_DELETED))
+    for (const auto& path : deleted_paths)
     {
-        std::cout << "\t" << entry->index_to_workdir->old_file.path << std::endl;
+        std::cout << "\t" << path << std::endl;
     }
 
     std::cout << "Please commit your changes or stash them before you switch branches.\nAborting" << std::endl;
@@ -88,7 +95,6 @@ void checkout_subcommand::run()
             throw std::runtime_error(buffer.str());
         }
 
-        auto sl = status_list_wrapper::status_list(repo);
         try
         {
             checkout_tree(repo, *optional_commit, m_branch_name, options);
@@ -96,29 +102,39 @@ void checkout_subcommand::run()
         }
         catch (const git_exception& e)
         {
-            if (sl.has_notstagged_header())
+            // The local changes are found from the stat data of the index entries, the worktree is
+            // only read for the racily clean ones.
+            stat_cache& stats = repo.worktree_stats();
+            const auto modified_paths = stats.changed_paths(stat_cache::file_state::modified);
+            const auto deleted_paths = stats.changed_paths(stat_cache::file_state::deleted);
+            stats.refresh();
+            if (!modified_paths.empty() || !deleted_paths.empty())
             {
-                print_no_switch(sl);
+                print_no_switch(modified_paths, deleted_paths);
             }
             throw e;
         }
 
+        // Untracked files are not listed, so they are not scanned.
+        auto sl = status_list_wrapper::tracked_status_list(repo);
+
+        output_sink out;
         if (sl.has_notstagged_header())
         {
             bool is_long = false;
             bool is_coloured = false;
             std::set<std::string> tracked_dir_set{};
-            print_notstagged(sl, tracked_dir_set, is_long, is_coloured);
+            print_notstagged(out, sl, tracked_dir_set, is_long, is_coloured);
         }
         if (sl.has_tobecommited_header())
         {
             bool is_long = false;
             bool is_coloured = false;
             std::set<std::string> tracked_dir_set{};
-            print_tobecommited(sl, tracked_dir_set, is_long, is_coloured);
+            print_tobecommited(out, sl, tracked_dir_set, is_long, is_coloured);
         }
-        std::cout << "Switched to branch '" << m_branch_name << "'" << std::endl;
-        print_tracking_info(repo, sl, true);
+        out << "Switched to branch '" << m_branch_name << "'\n";
+        print_tracking_info(out, repo, sl, true);
     }
 }
 
@@ -130,14 +146,14 @@ checkout_subcommand::create_local_branch(repository_wrapper& repo, const std::st
 }
 
 void checkout_subcommand::checkout_tree(
-    const repository_wrapper& repo,
+    repository_wrapper& repo,
     const annotated_commit_wrapper& target_annotated_commit,
     const std::string_view target_name,
     const git_checkout_options& options
 )
 {
     auto target_commit = repo.find_commit(target_annotated_commit.oid());
-    throw_if_error(git_checkout_tree(repo, target_commit, &options));
+    repo.checkout_tree(target_commit, options);
 }
 
 void checkout_subcommand::update_head(
@@ -21,7 +21,7 @@ private:
     create_local_branch(repository_wrapper& repo, const std::string_view target_name, bool force);
 
     void checkout_tree(
-        const repository_wrapper& repo,
+        repository_wrapper& repo,
         const annotated_commit_wrapper& target_annotated_commit,
         const std::string_view target_name,
         const git_checkout_options& options
@@ -1,10 +1,13 @@
 #include "../subcommand/clone_subcommand.hpp"
 
 #include <iostream>
+#include <optional>
 
 #include "../utils/credentials.hpp"
 #include "../utils/input_output.hpp"
+#include "../utils/partial_clone.hpp"
 #include "../utils/progress.hpp"
+#include "../utils/sparse_checkout.hpp"
 #include "../wasm/scope.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 
@@ -18,7 +21,17 @@ clone_subcommand::clone_subcommand(const libgit2_object&, CLI::App& app)
     // sub->add_option("--shallow-since", m_shallow_since, "<time>\ndeepen history of shallow repository based
     // on time."); sub->add_option("--shallow-exclude", m_shallow_exclude, "<ref>\ndeepen history of shallow
     // clone, excluding ref");
+    sub->add_option(
+        "--filter",
+        m_filter,
+        "Omit objects from the clone, fetched when they are needed: blob:none, blob:limit=<n>[kmg] or tree:0."
+    );
     sub->add_flag("--bare", m_bare, "Create a bare Git repository.");
+    sub->add_flag(
+        "--sparse",
+        m_sparse,
+        "Initialize the sparse-checkout file so that only the files of the root directory are checked out."
+    );
 
     sub->callback(
         [this]()
@@ -46,13 +59,33 @@ void clone_subcommand::run()
         m_depth = 0;
     }
 
+    // Partial clones are only made from local repositories, the other ones are cloned in full as
+    // with a server that does not support filters.
+    std::optional<clone_filter> filter;
+    if (!m_filter.empty())
+    {
+        filter = clone_filter::parse(m_filter);
+        if (!promisor_remote::is_local_url(m_repository))
+        {
+            std::cerr << "warning: filtering not recognized by server, ignoring" << std::endl;
+            filter.reset();
+        }
+        else if (m_depth != 0)
+        {
+            std::cerr << "warning: --filter is not supported with --depth, ignoring" << std::endl;
+            filter.reset();
+        }
+    }
+
     git_indexer_progress pd;
     git_clone_options clone_opts = GIT_CLONE_OPTIONS_INIT;
     git_checkout_options checkout_opts = GIT_CHECKOUT_OPTIONS_INIT;
     checkout_opts.checkout_strategy = GIT_CHECKOUT_SAFE;
     checkout_opts.progress_cb = checkout_progress;
     checkout_opts.progress_payload = &pd;
-    clone_opts.checkout_opts = checkout_opts;
+    // The files are checked out after the clone, by checkout_tree which may write them on several
+    // threads (git2cpp.checkoutThreads config entry).
+    clone_opts.checkout_opts.checkout_strategy = GIT_CHECKOUT_NONE;
     clone_opts.fetch_opts.callbacks.credentials = user_credentials;
     clone_opts.fetch_opts.callbacks.sideband_progress = sideband_progress;
     clone_opts.fetch_opts.callbacks.transfer_progress = fetch_progress;
@@ -72,5 +105,23 @@ void clone_subcommand::run()
     }
     std::cout << "Cloning into '" + short_name + "'..." << std::endl;
     cursor_hider ch;
-    repository_wrapper::clone(m_repository, m_directory, clone_opts);
+    auto repo = filter ? repository_wrapper::partial_clone(
+                             m_repository,
+                             m_directory,
+                             *filter,
+                             m_bare,
+                             clone_opts.fetch_opts.callbacks
+                         )
+                       : repository_wrapper::clone(m_repository, m_directory, clone_opts);
+    if (!m_bare && m_sparse)
+    {
+        sparse_checkout().store(repo.path());
+        auto config = repo.get_config();
+        config.set_entry("core.sparseCheckout", "true");
+        config.set_entry("core.sparseCheckoutCone", "true");
+    }
+    if (!m_bare && !repo.is_head_unborn())
+    {
+        repo.checkout_tree(repo.find_commit(), checkout_opts);
+    }
 }
@@ -17,7 +17,9 @@ private:
 
     std::string m_repository = {};
     std::string m_directory = {};
+    std::string m_filter = {};
     bool m_bare = false;
+    bool m_sparse = false;
     size_t m_depth = std::numeric_limits<size_t>::max();
     // std::string m_shallow_since;
     // std::vector<std::string> m_shallow_exclude;
@@ -0,0 +1,145 @@
+#include "../subcommand/commit_graph_subcommand.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <git2.h>
+
+#include "../utils/commit_graph.hpp"
+#include "../utils/git_exception.hpp"
+
+commit_graph_subcommand::commit_graph_subcommand(const libgit2_object&, CLI::App& app)
+{
+    auto* sub = app.add_subcommand("commit-graph", "Write and verify Git commit-graph files");
+    auto* write = sub->add_subcommand(
+        "write",
+        "Write a commit-graph file of the commits reachable from HEAD and all the references"
+    );
+    auto* verify = sub->add_subcommand("verify", "Read the commit-graph file and verify its contents");
+
+    write->callback(
+        [this]()
+        {
+            this->run_write();
+        }
+    );
+    verify->callback(
+        [this]()
+        {
+            this->run_verify();
+        }
+    );
+}
+
+std::string commit_graph_subcommand::objects_info_path(const repository_wrapper& repo) const
+{
+    return repo.common_path() + "objects/info";
+}
+
+void commit_graph_subcommand::run_write()
+{
+    auto directory = get_current_git_path();
+    auto repo = repository_wrapper::open(directory);
+
+    // As in git, the parents recorded in a commit-graph would not match the grafted history.
+    if (repo.is_shallow())
+    {
+        throw git_exception(
+            "fatal: cannot write a commit-graph in a shallow repository",
+            git2cpp_error_code::GENERIC_ERROR
+        );
+    }
+
+    revwalk_wrapper walker = repo.new_walker();
+    walker.push_glob("*");
+    if (!repo.is_head_unborn())
+    {
+        walker.push_head();
+    }
+
+    commit_graph::write(objects_info_path(repo), walker);
+}
+
+void commit_graph_subcommand::run_verify()
+{
+    auto directory = get_current_git_path();
+    auto repo = repository_wrapper::open(directory);
+
+    auto graph = commit_graph::open(objects_info_path(repo) + "/commit-graph");
+    if (!graph)
+    {
+        return;
+    }
+
+    const auto fail = [](const std::string& message)
+    {
+        throw git_exception("error: " + message, git2cpp_error_code::GENERIC_ERROR);
+    };
+
+    for (uint32_t pos = 0; pos < graph->size(); ++pos)
+    {
+        const git_oid oid = graph->oid(pos);
+        const std::string oid_str = git_oid_tostr_s(&oid);
+
+        if (pos > 0)
+        {
+            const git_oid previous_oid = graph->oid(pos - 1);
+            if (git_oid_cmp(&previous_oid, &oid) >= 0)
+            {
+                fail("commit-graph has incorrect OID order");
+            }
+        }
+
+        commit_wrapper commit = repo.find_commit(oid);
+
+        const git_oid tree_oid = graph->tree_oid(pos);
+        if (!git_oid_equal(&tree_oid, git_commit_tree_id(commit)))
+        {
+            fail("root tree OID for commit " + oid_str + " in commit-graph is incorrect");
+        }
+
+        const auto parents = graph->parents(pos);
+        if (parents.size() != git_commit_parentcount(commit))
+        {
+            fail("commit-graph parent list for commit " + oid_str + " has the wrong length");
+        }
+
+        uint32_t expected_generation = 1;
+        for (size_t i = 0; i < parents.size(); ++i)
+        {
+            const git_oid parent_oid = graph->oid(parents[i]);
+            if (!git_oid_equal(&parent_oid, git_commit_parent_id(commit, static_cast<unsigned int>(i))))
+            {
+                fail("commit-graph parent for " + oid_str + " is incorrect");
+            }
+            expected_generation = std::max(expected_generation, graph->generation(parents[i]) + 1);
+        }
+
+        expected_generation = std::min(expected_generation, commit_graph::generation_max);
+        if (graph->generation(pos) != expected_generation)
+        {
+            fail("commit-graph generation for commit " + oid_str + " is incorrect");
+        }
+
+        if (graph->commit_time(pos) != git_commit_time(commit))
+        {
+            fail("commit date for commit " + oid_str + " in commit-graph is incorrect");
+        }
+    }
+
+    // libgit2 has no SHA-1 of arbitrary data to check the trailing checksum with. A file with the
+    // chunks libgit2 writes must instead be the one it writes for the same commits, checksum included.
+    // The checksum of a file written by git with other chunks is not checked.
+    if (graph->has_libgit2_chunks())
+    {
+        revwalk_wrapper walker = repo.new_walker();
+        for (uint32_t pos = 0; pos < graph->size(); ++pos)
+        {
+            walker.push(graph->oid(pos));
+        }
+        if (commit_graph::dump(objects_info_path(repo), walker) != graph->content())
+        {
+            fail("the commit-graph file has incorrect checksum and is likely corrupt");
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+#include <CLI/CLI.hpp>
+
+#include "../utils/common.hpp"
+#include "../wrapper/repository_wrapper.hpp"
+
+class commit_graph_subcommand
+{
+public:
+
+    explicit commit_graph_subcommand(const libgit2_object&, CLI::App& app);
+    void run_write();
+    void run_verify();
+
+private:
+
+    std::string objects_info_path(const repository_wrapper& repo) const;
+};
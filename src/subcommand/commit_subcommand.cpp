@@ -36,5 +36,10 @@ void commit_subcommand::run()
         }
     }
 
+    // Bulk imports write the trees of the commit in a pack.
+    if (repo.get_config().get_bool("git2cpp.packNewObjects", false))
+    {
+        repo.enable_pack_writes();
+    }
     repo.create_commit(author_committer_signatures, m_commit_message, std::nullopt);
 }
@@ -1,12 +1,24 @@
 #include "../subcommand/diff_subcommand.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <optional>
+#include <sstream>
+#include <string>
 
 #include <git2.h>
 #include <termcolor/termcolor.hpp>
 
 #include "../utils/common.hpp"
+#include "../utils/diff_stats.hpp"
+#include "../utils/diff_stats_cache.hpp"
 #include "../utils/git_exception.hpp"
+#include "../utils/mapped_file.hpp"
+#include "../utils/output_sink.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/similarity_index.hpp"
+#include "../utils/trace.hpp"
 #include "../wrapper/patch_wrapper.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 
@@ -71,8 +83,41 @@ diff_subcommand::diff_subcommand(const libgit2_object&, CLI::App& app)
     );
 }
 
+// Colour the graph of the file lines ("path | 3 ++-"), made of the runs of + and - following the
+// change count after the last '|'. The summary line and the binary file lines are not coloured.
+static void write_coloured_stats(output_sink& out, std::string_view stats)
+{
+    while (!stats.empty())
+    {
+        const size_t eol = stats.find('\n');
+        const size_t line_size = eol == std::string_view::npos ? stats.size() : eol + 1;
+        const std::string_view line = stats.substr(0, line_size);
+        stats.remove_prefix(line_size);
+
+        const size_t bar = line.rfind('|');
+        size_t pos = bar == std::string_view::npos ? bar : line.find_first_not_of(" 0123456789", bar + 1);
+        if (pos == std::string_view::npos || line.find_first_not_of("+-\n", pos) != std::string_view::npos)
+        {
+            out << line;
+            continue;
+        }
+
+        out << line.substr(0, pos);
+        while (pos < line.size() && line[pos] != '\n')
+        {
+            const char c = line[pos];
+            const size_t end = std::min(line.find_first_not_of(c, pos), line.size());
+            out.write_coloured(c == '+' ? termcolor::green : termcolor::red, line.substr(pos, end - pos));
+            pos = end;
+        }
+        out << line.substr(pos);
+    }
+}
+
 void print_stats(
     const diff_wrapper& diff,
+    const repository_wrapper* repo,
+    uint32_t diff_flags,
     bool use_colour,
     bool stat_flag,
     bool shortstat_flag,
@@ -128,46 +173,60 @@ void print_stats(
         format = GIT_DIFF_STATS_INCLUDE_SUMMARY;
     }
 
-    auto stats = diff.get_stats();
-    auto buf = stats.to_buf(format, 80);
-
-    if (use_colour && stat_flag)
+    std::optional<diff_stats_cache> cache;
+    if (repo)
     {
-        // Add colors to + and - characters
-        std::string output(buf.ptr);
-        bool in_parentheses = false;
-        for (char c : output)
+        const int64_t cache_limit =
+            repo->get_config().get_int64("git2cpp.diffCacheLimit", diff_stats_cache::default_byte_limit);
+        if (cache_limit > 0)
         {
-            if (c == '(')
-            {
-                in_parentheses = true;
-                std::cout << c;
-            }
-            else if (c == ')')
-            {
-                in_parentheses = false;
-                std::cout << c;
-            }
-            else if (c == '+' && !in_parentheses)
-            {
-                std::cout << termcolor::green << '+' << termcolor::reset;
-            }
-            else if (c == '-' && !in_parentheses)
-            {
-                std::cout << termcolor::red << '-' << termcolor::reset;
-            }
-            else
-            {
-                std::cout << c;
-            }
+            cache.emplace(repo->path(), size_t(cache_limit));
         }
     }
+
+    git_repository* raw_repo = repo ? static_cast<git_repository*>(*repo) : nullptr;
+    const diff_stats stats(diff, raw_repo, diff_flags, cache ? &*cache : nullptr);
+    const std::string output = stats.to_string(format, 80);
+    if (cache)
+    {
+        cache->store();
+    }
+    output_sink out;
+
+    if (use_colour && stat_flag && out.colourize())
+    {
+        write_coloured_stats(out, output);
+    }
     else
     {
-        std::cout << buf.ptr;
+        out << output;
     }
+}
 
-    git_buf_dispose(&buf);
+struct colour_printer_payload
+{
+    output_sink& out;
+    bool use_colour;
+};
+
+// Colour of each line origin, nullptr for the lines printed without colour.
+static stream_colour_fn origin_colour(char origin)
+{
+    switch (origin)
+    {
+        case GIT_DIFF_LINE_ADDITION:
+        case GIT_DIFF_LINE_ADD_EOFNL:
+            return termcolor::green;
+        case GIT_DIFF_LINE_DELETION:
+        case GIT_DIFF_LINE_DEL_EOFNL:
+            return termcolor::red;
+        case GIT_DIFF_LINE_FILE_HDR:
+            return termcolor::bold;
+        case GIT_DIFF_LINE_HUNK_HDR:
+            return termcolor::cyan;
+        default:
+            return nullptr;
+    }
 }
 
 static int colour_printer(
@@ -177,94 +236,206 @@ static int colour_printer(
     void* payload
 )
 {
-    bool use_colour = *reinterpret_cast<bool*>(payload);
+    auto& [out, use_colour] = *reinterpret_cast<colour_printer_payload*>(payload);
 
     // Only print origin for context/addition/deletion lines
     bool print_origin = (line->origin == GIT_DIFF_LINE_CONTEXT || line->origin == GIT_DIFF_LINE_ADDITION || line->origin == GIT_DIFF_LINE_DELETION);
 
-    if (use_colour)
-    {
-        switch (line->origin)
-        {
-            case GIT_DIFF_LINE_ADDITION:
-                std::cout << termcolor::green;
-                break;
-            case GIT_DIFF_LINE_DELETION:
-                std::cout << termcolor::red;
-                break;
-            case GIT_DIFF_LINE_ADD_EOFNL:
-                std::cout << termcolor::green;
-                break;
-            case GIT_DIFF_LINE_DEL_EOFNL:
-                std::cout << termcolor::red;
-                break;
-            case GIT_DIFF_LINE_FILE_HDR:
-                std::cout << termcolor::bold;
-                break;
-            case GIT_DIFF_LINE_HUNK_HDR:
-                std::cout << termcolor::cyan;
-                break;
-            default:
-                break;
-        }
+    // The escape sequences come from the cache of the sink, and context lines are not wrapped in a
+    // pointless colour reset.
+    const stream_colour_fn colour = use_colour ? origin_colour(line->origin) : nullptr;
+    if (colour)
+    {
+        out << colour;
     }
 
     if (print_origin)
     {
-        std::cout << line->origin;
+        out << line->origin;
     }
 
-    std::cout << std::string_view(line->content, line->content_len);
+    out << std::string_view(line->content, line->content_len);
 
-    if (use_colour)
+    if (colour)
     {
-        std::cout << termcolor::reset;
+        out << termcolor::reset;
     }
 
     // Print copy/rename headers ONLY after the "diff --git" line
-    if (line->origin == GIT_DIFF_LINE_FILE_HDR)
+    if (line->origin == GIT_DIFF_LINE_FILE_HDR
+        && (delta->status == GIT_DELTA_COPIED || delta->status == GIT_DELTA_RENAMED))
+    {
+        const std::string_view kind = delta->status == GIT_DELTA_COPIED ? "copy" : "rename";
+        std::string header = "similarity index " + std::to_string(delta->similarity) + "%\n";
+        header.append(kind).append(" from ").append(delta->old_file.path).append("\n");
+        header.append(kind).append(" to ").append(delta->new_file.path).append("\n");
+        if (use_colour)
+        {
+            out.write_coloured(termcolor::bold, header);
+        }
+        else
+        {
+            out << header;
+        }
+    }
+
+    return 0;
+}
+
+namespace
+{
+    // The patches are generated by chunks of deltas, written in order once the chunk is complete.
+    constexpr size_t patch_chunk_size = 256;
+    // Below this number of deltas, starting the workers costs more than it saves.
+    constexpr size_t min_parallel_deltas = 16;
+
+    // Thrown by a worker whose diff does not have the same deltas as the main one, because the
+    // worktree changed in between.
+    struct diff_mismatch
+    {
+    };
+
+    bool same_delta(const git_diff_delta* lhs, const git_diff_delta* rhs)
     {
-        if (delta->status == GIT_DELTA_COPIED)
+        const auto same_path = [](const char* lhs_path, const char* rhs_path)
         {
-            if (use_colour)
+            if (!lhs_path || !rhs_path)
             {
-                std::cout << termcolor::bold;
+                return lhs_path == rhs_path;
             }
-            std::cout << "similarity index " << delta->similarity << "%\n";
-            std::cout << "copy from " << delta->old_file.path << "\n";
-            std::cout << "copy to " << delta->new_file.path << "\n";
-            if (use_colour)
+            return std::strcmp(lhs_path, rhs_path) == 0;
+        };
+        return lhs->status == rhs->status && same_path(lhs->old_file.path, rhs->old_file.path)
+               && same_path(lhs->new_file.path, rhs->new_file.path);
+    }
+
+    // Each worker formats the patches in its own buffer.
+    class patch_worker : private noncopyable_nonmovable
+    {
+    public:
+
+        explicit patch_worker(bool colourize)
+            : m_sink(m_stream, output_sink::default_capacity, colourize)
+        {
+        }
+
+        // Return the formatted patch of the delta at index.
+        std::string format(const diff_wrapper& diff, size_t index, bool use_colour)
+        {
+            auto patch = patch_wrapper::from_diff(diff, index);
+            if (!patch)
             {
-                std::cout << termcolor::reset;
+                return {};
             }
+            colour_printer_payload payload{m_sink, use_colour && m_sink.colourize()};
+            patch->print(colour_printer, &payload);
+            m_sink.write_buffered();
+            std::string res = std::move(m_stream).str();
+            m_stream.str({});
+            return res;
         }
-        else if (delta->status == GIT_DELTA_RENAMED)
+
+        // libgit2 repositories cannot be shared between threads, so each worker but the first one
+        // opens its own and computes the same diff again.
+        std::optional<repository_wrapper> repo;
+        std::optional<diff_wrapper> diff;
+
+    private:
+
+        std::ostringstream m_stream;
+        output_sink m_sink;
+    };
+}
+
+std::optional<std::vector<std::string>>
+diff_subcommand::find_copy_sources(repository_wrapper& repo, const diff_wrapper& diff) const
+{
+    trace::scoped_timer timer("copy source search");
+
+    // Same relation as libgit2 between the similarity of contents and the Jaccard similarity of
+    // their lines, with some slack since the signatures only estimate it.
+    const unsigned int min_similarity = m_copy_threshold * 100 / (200 - m_copy_threshold) / 2;
+    constexpr size_t max_sources_per_file = 16;
+
+    const int64_t cache_limit =
+        repo.get_config().get_int64("git2cpp.signatureCacheLimit", similarity_index::default_byte_limit);
+    similarity_index index(repo.path(), size_t(std::max(cache_limit, int64_t(0))));
+    std::vector<std::string> paths;
+    std::vector<size_t> targets;
+    const size_t count = git_diff_num_deltas(diff);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const git_diff_delta* delta = git_diff_get_delta(diff, i);
+        if (delta->status != GIT_DELTA_UNMODIFIED)
         {
-            if (use_colour)
+            paths.emplace_back(delta->old_file.path);
+            if (std::strcmp(delta->old_file.path, delta->new_file.path) != 0)
             {
-                std::cout << termcolor::bold;
+                paths.emplace_back(delta->new_file.path);
             }
-            std::cout << "similarity index " << delta->similarity << "%\n";
-            std::cout << "rename from " << delta->old_file.path << "\n";
-            std::cout << "rename to " << delta->new_file.path << "\n";
-            if (use_colour)
+            targets.push_back(i);
+        }
+        else if (auto sig = index.blob_signature(repo, delta->old_file.id))
+        {
+            index.add(uint32_t(i), *sig);
+        }
+    }
+    if (targets.empty())
+    {
+        return std::nullopt;
+    }
+
+    const char* workdir = git_repository_workdir(repo);
+    std::vector<bool> is_source(count, false);
+    for (size_t i : targets)
+    {
+        const git_diff_file& file = git_diff_get_delta(diff, i)->new_file;
+        if (file.mode != GIT_FILEMODE_BLOB && file.mode != GIT_FILEMODE_BLOB_EXECUTABLE)
+        {
+            continue;
+        }
+
+        // The new content is a blob, or a worktree file when the diff did not hash it.
+        std::optional<similarity_index::signature> sig;
+        if (file.flags & GIT_DIFF_FLAG_VALID_ID)
+        {
+            sig = index.blob_signature(repo, file.id);
+        }
+        if (!sig && workdir)
+        {
+            try
+            {
+                const mapped_file content(std::string(workdir) + file.path);
+                sig = similarity_index::content_signature(content.view());
+            }
+            catch (const git_exception&)
+            {
+                // Not a regular file, libgit2 does not use it either.
+            }
+        }
+        if (sig)
+        {
+            for (uint32_t source : index.find(*sig, min_similarity, max_sources_per_file))
             {
-                std::cout << termcolor::reset;
+                is_source[source] = true;
             }
         }
     }
+    index.store();
 
-    return 0;
-}
-
-void diff_subcommand::print_diff(diff_wrapper& diff, bool use_colour)
-{
-    if (m_stat_flag || m_shortstat_flag || m_numstat_flag || m_summary_flag)
+    for (size_t i = 0; i < count; ++i)
     {
-        print_stats(diff, use_colour, m_stat_flag, m_shortstat_flag, m_numstat_flag, m_summary_flag);
-        return;
+        if (is_source[i])
+        {
+            paths.emplace_back(git_diff_get_delta(diff, i)->old_file.path);
+        }
     }
+    trace::add("copy sources", size_t(std::count(is_source.begin(), is_source.end(), true)));
+    return paths;
+}
 
+void diff_subcommand::find_similar(diff_wrapper& diff) const
+{
     if (m_find_renames_flag || m_find_copies_flag || m_find_copies_harder_flag || m_break_rewrites_flag)
     {
         git_diff_find_options find_opts = GIT_DIFF_FIND_OPTIONS_INIT;
@@ -289,6 +460,101 @@ void diff_subcommand::print_diff(diff_wrapper& diff, bool use_colour)
         }
         diff.find_similar(&find_opts);
     }
+}
+
+void diff_subcommand::print_patches(
+    diff_wrapper& diff,
+    bool use_colour,
+    const repository_wrapper& repo,
+    const diff_factory& make_diff,
+    size_t thread_count
+)
+{
+    trace::scoped_timer timer("diff output");
+    const size_t delta_count = git_diff_num_deltas(diff);
+    trace::add("diff deltas", delta_count);
+
+    output_sink out;
+    std::vector<std::unique_ptr<patch_worker>> workers;
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        workers.push_back(std::make_unique<patch_worker>(out.colourize()));
+    }
+    const std::string repo_path = repo.path();
+
+    bool parallel = true;
+    std::vector<std::string> patches;
+    for (size_t first = 0; first < delta_count; first += patch_chunk_size)
+    {
+        const size_t chunk_size = std::min(patch_chunk_size, delta_count - first);
+        patches.assign(chunk_size, {});
+
+        const auto format_chunk = [&](size_t index, size_t worker_index)
+        {
+            patch_worker& worker = *workers[worker_index];
+            const diff_wrapper* worker_diff = &diff;
+            if (worker_index != 0)
+            {
+                if (!worker.diff)
+                {
+                    worker.repo = repository_wrapper::open(repo_path);
+                    worker.diff = make_diff(*worker.repo);
+                    find_similar(*worker.diff);
+                    if (git_diff_num_deltas(*worker.diff) != delta_count)
+                    {
+                        throw diff_mismatch();
+                    }
+                }
+                worker_diff = &*worker.diff;
+                const git_diff_delta* delta = git_diff_get_delta(diff, first + index);
+                if (!same_delta(delta, git_diff_get_delta(*worker_diff, first + index)))
+                {
+                    throw diff_mismatch();
+                }
+            }
+            patches[index] = worker.format(*worker_diff, first + index, use_colour);
+        };
+
+        try
+        {
+            parallel_for(chunk_size, parallel ? thread_count : 1, format_chunk);
+        }
+        catch (const diff_mismatch&)
+        {
+            parallel = false;
+            parallel_for(chunk_size, 1, format_chunk);
+        }
+
+        for (const auto& patch : patches)
+        {
+            out << patch;
+        }
+    }
+}
+
+void diff_subcommand::print_diff(
+    diff_wrapper& diff,
+    bool use_colour,
+    const repository_wrapper* repo,
+    const diff_factory& make_diff
+)
+{
+    if (m_stat_flag || m_shortstat_flag || m_numstat_flag || m_summary_flag)
+    {
+        print_stats(
+            diff,
+            repo,
+            m_diff_flags,
+            use_colour,
+            m_stat_flag,
+            m_shortstat_flag,
+            m_numstat_flag,
+            m_summary_flag
+        );
+        return;
+    }
+
+    find_similar(diff);
 
     git_diff_format_t format = GIT_DIFF_FORMAT_PATCH;
     if (m_name_only_flag)
@@ -304,12 +570,25 @@ void diff_subcommand::print_diff(diff_wrapper& diff, bool use_colour)
         format = GIT_DIFF_FORMAT_RAW;
     }
 
-    diff.print(format, colour_printer, &use_colour);
+    if (repo && format == GIT_DIFF_FORMAT_PATCH && git_diff_num_deltas(diff) >= min_parallel_deltas)
+    {
+        const int configured_threads = repo->get_config().get_int("git2cpp.diffThreads", 1);
+        const size_t thread_count = resolve_thread_count(configured_threads);
+        if (thread_count > 1)
+        {
+            print_patches(diff, use_colour, *repo, make_diff, thread_count);
+            return;
+        }
+    }
+
+    output_sink out;
+    colour_printer_payload payload{out, use_colour && out.colourize()};
+    diff.print(format, colour_printer, &payload);
 }
 
-diff_wrapper compute_diff_no_index(std::vector<std::string> files, git_diff_options& diffopts)
+void diff_subcommand::print_diff_no_index(git_diff_options& diffopts, bool use_colour)
 {
-    if (files.size() != 2)
+    if (m_files.size() != 2)
     {
         throw git_exception(
             "usage: git diff --no-index [<options>] <path> <path> [<pathspec>...]",
@@ -319,25 +598,50 @@ diff_wrapper compute_diff_no_index(std::vector<std::string> files, git_diff_opti
 
     git_diff_options_init(&diffopts, GIT_DIFF_OPTIONS_VERSION);
 
-    std::string file1_str = read_file(files[0]);
-    std::string file2_str = read_file(files[1]);
+    // The files are diffed in place, without being copied.
+    const mapped_file old_file(m_files[0]);
+    const mapped_file new_file(m_files[1]);
 
-    if (file1_str.empty())
+    // Identical files have no diff: most of the time their sizes already differ, otherwise a single
+    // comparison is much cheaper than the hashing and line splitting of the diff.
+    if (old_file.view() == new_file.view())
     {
-        throw git_exception("Cannot read file: " + files[0], git2cpp_error_code::GENERIC_ERROR);
+        return;
     }
-    if (file2_str.empty())
+
+    // Binary files are only reported as different, their content does not need to be looked at.
+    if (old_file.is_binary() || new_file.is_binary())
     {
-        throw git_exception("Cannot read file: " + files[1], git2cpp_error_code::GENERIC_ERROR);
+        diffopts.flags |= GIT_DIFF_FORCE_BINARY;
     }
 
-    auto patch = patch_wrapper::patch_from_files(files[0], file1_str, files[1], file2_str, &diffopts);
-    auto buf = patch.to_buf();
-    auto diff = diff_wrapper::diff_from_buffer(buf);
+    std::optional<patch_wrapper> patch;
+    {
+        trace::scoped_timer timer("diff generation");
+        patch = patch_wrapper::patch_from_files(
+            m_files[0],
+            old_file.view(),
+            m_files[1],
+            new_file.view(),
+            &diffopts
+        );
+    }
 
-    git_buf_dispose(&buf);
+    if (m_stat_flag || m_shortstat_flag || m_numstat_flag || m_summary_flag || m_name_only_flag
+        || m_name_status_flag || m_raw_flag)
+    {
+        // These formats need a git_diff, which can only be built from the patch text.
+        auto buf = patch->to_buf();
+        auto diff = diff_wrapper::diff_from_buffer(buf);
+        git_buf_dispose(&buf);
+        print_diff(diff, use_colour);
+        return;
+    }
 
-    return diff;
+    trace::scoped_timer timer("diff output");
+    output_sink out;
+    colour_printer_payload payload{out, use_colour && out.colourize()};
+    patch->print(colour_printer, &payload);
 }
 
 void diff_subcommand::run()
@@ -372,8 +676,7 @@ void diff_subcommand::run()
 
     if (m_no_index_flag)
     {
-        auto diff = compute_diff_no_index(m_files, diffopts);
-        diff_subcommand::print_diff(diff, use_colour);
+        print_diff_no_index(diffopts, use_colour);
     }
     else
     {
@@ -421,42 +724,68 @@ void diff_subcommand::run()
             diffopts.flags |= GIT_DIFF_INCLUDE_UNMODIFIED;
         }
 
-        std::optional<tree_wrapper> tree1;
-        std::optional<tree_wrapper> tree2;
-
-        if (m_files.size() >= 1)
+        m_diff_flags = diffopts.flags;
+        const diff_factory make_diff = [&diffopts, this](repository_wrapper& diff_repo)
         {
-            tree1 = repo.treeish_to_tree(m_files[0]);
-        }
-        if (m_files.size() == 2)
-        {
-            tree2 = repo.treeish_to_tree(m_files[1]);
-        }
-
-        auto diff = [&repo, &tree1, &tree2, &diffopts, this]()
+            return compute_diff(diff_repo, diffopts);
+        };
+        auto diff = make_diff(repo);
+
+        // With --find-copies-harder every unmodified file is a copy source, which libgit2 compares
+        // with every changed file. When the git2cpp.copySourceIndex config entry is true, the diff is
+        // made again with only the sources that the similarity index finds similar to one of them,
+        // the workers of print_diff use the same paths. The index only estimates the similarity, so
+        // a copy source may be missed: the entry trades exactness for speed on large trees.
+        std::optional<git_strarray_wrapper> copy_source_paths;
+        if (m_find_copies_harder_flag && repo.get_config().get_bool("git2cpp.copySourceIndex", false))
         {
-            if (tree1.has_value() && tree2.has_value())
-            {
-                return repo.diff_tree_to_tree(tree1.value(), tree2.value(), &diffopts);
-            }
-            else if (m_cached_flag)
-            {
-                if (!tree1)
-                {
-                    tree1 = repo.treeish_to_tree("HEAD");
-                }
-                return repo.diff_tree_to_index(tree1.value(), std::nullopt, &diffopts);
-            }
-            else if (tree1)
-            {
-                return repo.diff_tree_to_workdir_with_index(tree1.value(), &diffopts);
-            }
-            else
+            if (auto paths = find_copy_sources(repo, diff))
             {
-                return repo.diff_index_to_workdir(std::nullopt, &diffopts);
+                copy_source_paths.emplace(std::move(*paths));
+                diffopts.pathspec = *static_cast<git_strarray*>(*copy_source_paths);
+                diffopts.flags |= GIT_DIFF_DISABLE_PATHSPEC_MATCH;
+                diff = make_diff(repo);
             }
-        }();
+        }
+
+        // The blobs missing from a partial clone are fetched at once rather than one per patch.
+        repo.prefetch_blobs(diff);
+        diff_subcommand::print_diff(diff, use_colour, &repo, make_diff);
+    }
+}
+
+diff_wrapper diff_subcommand::compute_diff(repository_wrapper& repo, git_diff_options& diffopts) const
+{
+    std::optional<tree_wrapper> tree1;
+    std::optional<tree_wrapper> tree2;
+
+    if (m_files.size() >= 1)
+    {
+        tree1 = repo.treeish_to_tree(m_files[0]);
+    }
+    if (m_files.size() == 2)
+    {
+        tree2 = repo.treeish_to_tree(m_files[1]);
+    }
 
-        diff_subcommand::print_diff(diff, use_colour);
+    if (tree1.has_value() && tree2.has_value())
+    {
+        return repo.diff_tree_to_tree(tree1.value(), tree2.value(), &diffopts);
+    }
+    else if (m_cached_flag)
+    {
+        if (!tree1)
+        {
+            tree1 = repo.treeish_to_tree("HEAD");
+        }
+        return repo.diff_tree_to_index(tree1.value(), std::nullopt, &diffopts);
+    }
+    else if (tree1)
+    {
+        return repo.diff_tree_to_workdir_with_index(tree1.value(), &diffopts);
+    }
+    else
+    {
+        return repo.diff_index_to_workdir(std::nullopt, &diffopts);
     }
 }
@@ -1,22 +1,53 @@
 #pragma once
 
+#include <functional>
+#include <optional>
 #include <string>
 
 #include <CLI/CLI.hpp>
 
 #include "../utils/common.hpp"
 #include "../wrapper/diff_wrapper.hpp"
+#include "../wrapper/repository_wrapper.hpp"
 
 class diff_subcommand
 {
 public:
 
+    // Compute the diff in the given repository, for the workers generating the patches in parallel.
+    using diff_factory = std::function<diff_wrapper(repository_wrapper&)>;
+
     explicit diff_subcommand(const libgit2_object&, CLI::App& app);
-    void print_diff(diff_wrapper& diff, bool use_colour);
+
+    // With a repository, the patches are generated by several threads when the git2cpp.diffThreads
+    // config entry is not 1 (values less than 1 mean one thread per core), the output is the same.
+    void print_diff(
+        diff_wrapper& diff,
+        bool use_colour,
+        const repository_wrapper* repo = nullptr,
+        const diff_factory& make_diff = {}
+    );
     void run();
 
 private:
 
+    diff_wrapper compute_diff(repository_wrapper& repo, git_diff_options& diffopts) const;
+    // Paths of the changed files and of the unmodified files similar to one of them according to a
+    // similarity_index, to restrict the copy sources of --find-copies-harder. nullopt if nothing
+    // changed.
+    std::optional<std::vector<std::string>>
+    find_copy_sources(repository_wrapper& repo, const diff_wrapper& diff) const;
+    void find_similar(diff_wrapper& diff) const;
+    // Diff of two files outside of any repository, mapped in memory rather than read.
+    void print_diff_no_index(git_diff_options& diffopts, bool use_colour);
+    void print_patches(
+        diff_wrapper& diff,
+        bool use_colour,
+        const repository_wrapper& repo,
+        const diff_factory& make_diff,
+        size_t thread_count
+    );
+
     std::vector<std::string> m_files;
 
     bool m_stat_flag = false;
@@ -38,6 +69,8 @@ private:
     bool m_untracked_flag = false;
     bool m_patience_flag = false;
     bool m_minimal_flag = false;
+    // git_diff_option_t flags of the diff, once computed.
+    uint32_t m_diff_flags = 0;
 
     uint16_t m_rename_threshold = 50;
     bool m_find_renames_flag = false;
@@ -54,8 +87,13 @@ private:
     bool m_no_colour_flag = false;
 };
 
+// repo is null for a diff made outside of any repository, diff_flags are the git_diff_option_t the
+// diff was made with. The stats of blob pairs are cached in the repository, up to the
+// git2cpp.diffCacheLimit config entry (in bytes, 0 disables the cache).
 void print_stats(
     const diff_wrapper& diff,
+    const repository_wrapper* repo,
+    uint32_t diff_flags,
     bool use_colour,
     bool stat_flag,
     bool shortstat_flag,
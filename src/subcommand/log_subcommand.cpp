@@ -3,6 +3,7 @@
 #include <format>
 #include <sstream>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include <git2.h>
@@ -11,6 +12,7 @@
 #include <git2/types.h>
 #include <termcolor/termcolor.hpp>
 
+#include "../utils/output_sink.hpp"
 #include "../utils/terminal_pager.hpp"
 
 log_subcommand::log_subcommand(const libgit2_object&, CLI::App& app)
@@ -52,9 +54,9 @@ log_subcommand::log_subcommand(const libgit2_object&, CLI::App& app)
     );
 };
 
-void print_time(git_time intime, std::string prefix)
+void print_time(output_sink& out, git_time intime, std::string prefix)
 {
-    char sign, out[32];
+    char sign, buf[32];
     struct tm* intm;
     int offset, hours, minutes;
     time_t t;
@@ -76,53 +78,57 @@ void print_time(git_time intime, std::string prefix)
     t = (time_t) intime.time + (intime.offset * 60);
 
     intm = gmtime(&t);
-    strftime(out, sizeof(out), "%a %b %e %T %Y", intm);
+    strftime(buf, sizeof(buf), "%a %b %e %T %Y", intm);
 
-    std::cout << prefix << out << " " << sign << std::format("{:02d}", hours)
-              << std::format("{:02d}", minutes) << std::endl;
+    out << prefix << buf << " " << sign << std::format("{:02d}", hours) << std::format("{:02d}", minutes)
+        << '\n';
 }
 
-std::vector<std::string> get_tags_for_commit(repository_wrapper& repo, const git_oid& commit_oid)
+struct commit_refs
 {
+    std::string head_branch;
     std::vector<std::string> tags;
+    std::vector<std::string> local_branches;
+    std::vector<std::string> remote_branches;
+
+    bool has_refs() const
+    {
+        return !head_branch.empty() || !tags.empty() || !local_branches.empty() || !remote_branches.empty();
+    }
+};
+
+using commit_refs_map = std::unordered_map<git_oid, commit_refs, git_oid_hash, git_oid_equal_to>;
+
+void add_tags_to_index(repository_wrapper& repo, commit_refs_map& refs_index)
+{
     git_strarray tag_names = {0};
 
     if (git_tag_list(&tag_names, repo) != 0)
     {
-        return tags;
+        return;
     }
 
     for (size_t i = 0; i < tag_names.count; i++)
     {
         std::string tag_name = tag_names.strings[i];
-        std::string ref_name = "refs/tags/" + std::string(tag_name);
+        std::string ref_name = "refs/tags/" + tag_name;
 
         reference_wrapper tag_ref = repo.find_reference(ref_name);
         object_wrapper peeled = tag_ref.peel<object_wrapper>();
 
-        if (git_oid_equal(&peeled.oid(), &commit_oid))
-        {
-            tags.push_back(std::string(tag_name));
-        }
+        refs_index[peeled.oid()].tags.push_back(std::move(tag_name));
     }
 
     git_strarray_dispose(&tag_names);  // TODO: refactor git_strarray_wrapper to use it here
-    return tags;
 }
 
-std::vector<std::string> get_branches_for_commit(
-    repository_wrapper& repo,
-    git_branch_t type,
-    const git_oid& commit_oid,
-    const std::string exclude_branch
-)
+void add_branches_to_index(repository_wrapper& repo, git_branch_t type, commit_refs_map& refs_index)
 {
-    std::vector<std::string> branches;
-
     auto branch_iter = repo.iterate_branches(type);
     while (auto branch = branch_iter.next())
     {
         const git_oid* branch_target = nullptr;
+        git_oid resolved_target;
         git_reference* ref = branch.value();
 
         if (git_reference_type(ref) == GIT_REFERENCE_DIRECT)
@@ -134,82 +140,70 @@ std::vector<std::string> get_branches_for_commit(
             git_reference* resolved = nullptr;
             if (git_reference_resolve(&resolved, ref) == 0)
             {
-                branch_target = git_reference_target(resolved);
+                git_oid_cpy(&resolved_target, git_reference_target(resolved));
+                branch_target = &resolved_target;
                 git_reference_free(resolved);
             }
         }
 
-        if (branch_target && git_oid_equal(branch_target, &commit_oid))
+        if (!branch_target)
         {
-            std::string branch_name(branch->name());
-            if (type == GIT_BRANCH_LOCAL)
-            {
-                if (branch_name != exclude_branch)
-                {
-                    branches.push_back(branch_name);
-                }
-            }
-            else
+            continue;
+        }
+
+        commit_refs& refs = refs_index[*branch_target];
+        std::string branch_name(branch->name());
+        if (type == GIT_BRANCH_LOCAL)
+        {
+            // The checked out branch is already displayed as "HEAD -> <branch>"
+            if (branch_name != refs.head_branch)
             {
-                branches.push_back(branch_name);
+                refs.local_branches.push_back(std::move(branch_name));
             }
         }
+        else
+        {
+            refs.remote_branches.push_back(std::move(branch_name));
+        }
     }
-
-    return branches;
 }
 
-struct commit_refs
-{
-    std::string head_branch;
-    std::vector<std::string> tags;
-    std::vector<std::string> local_branches;
-    std::vector<std::string> remote_branches;
-
-    bool has_refs() const
-    {
-        return !head_branch.empty() || !tags.empty() || !local_branches.empty() || !remote_branches.empty();
-    }
-};
-
-commit_refs get_refs_for_commit(repository_wrapper& repo, const git_oid& commit_oid)
+// Collects the decorations of every commit pointed to by HEAD, a tag or a branch, so that
+// the log walk only needs a lookup per commit instead of listing all the references again.
+commit_refs_map build_refs_index(repository_wrapper& repo)
 {
-    commit_refs refs;
+    commit_refs_map refs_index;
 
     if (!repo.is_head_unborn())
     {
         auto head = repo.head();
-        auto head_taget = head.target();
-        if (git_oid_equal(head_taget, &commit_oid))
-        {
-            refs.head_branch = head.short_name();
-        }
+        refs_index[*head.target()].head_branch = head.short_name();
     }
 
-    refs.tags = get_tags_for_commit(repo, commit_oid);
-    refs.local_branches = get_branches_for_commit(repo, GIT_BRANCH_LOCAL, commit_oid, refs.head_branch);
-    refs.remote_branches = get_branches_for_commit(repo, GIT_BRANCH_REMOTE, commit_oid, "");
+    add_tags_to_index(repo, refs_index);
+    add_branches_to_index(repo, GIT_BRANCH_LOCAL, refs_index);
+    add_branches_to_index(repo, GIT_BRANCH_REMOTE, refs_index);
 
-    return refs;
+    return refs_index;
 }
 
-void print_refs(const commit_refs& refs)
+void print_refs(output_sink& out, const commit_refs& refs)
 {
     if (!refs.has_refs())
     {
         return;
     }
 
-    std::cout << termcolor::yellow;
-    std::cout << " (";
+    out << termcolor::yellow;
+    out << " (";
 
     bool first = true;
 
     if (!refs.head_branch.empty())
     {
-        std::cout << termcolor::bold << termcolor::cyan << "HEAD" << termcolor::reset << termcolor::yellow
-                  << " -> " << termcolor::reset << termcolor::bold << termcolor::green << refs.head_branch
-                  << termcolor::reset << termcolor::yellow;
+        out << termcolor::bold << termcolor::cyan << "HEAD" << termcolor::reset << termcolor::yellow << " -> "
+            << termcolor::reset << termcolor::bold << termcolor::green << refs.head_branch << termcolor::reset
+            << termcolor::yellow;
         first = false;
     }
 
@@ -217,9 +211,9 @@ void print_refs(const commit_refs& refs)
     {
         if (!first)
         {
-            std::cout << ", ";
+            out << ", ";
         }
-        std::cout << termcolor::bold << "tag: " << tag << termcolor::reset << termcolor::yellow;
+        out << termcolor::bold << "tag: " << tag << termcolor::reset << termcolor::yellow;
         first = false;
     }
 
@@ -227,9 +221,9 @@ void print_refs(const commit_refs& refs)
     {
         if (!first)
         {
-            std::cout << ", ";
+            out << ", ";
         }
-        std::cout << termcolor::bold << termcolor::red << remote << termcolor::reset << termcolor::yellow;
+        out << termcolor::bold << termcolor::red << remote << termcolor::reset << termcolor::yellow;
         first = false;
     }
 
@@ -237,16 +231,16 @@ void print_refs(const commit_refs& refs)
     {
         if (!first)
         {
-            std::cout << ", ";
+            out << ", ";
         }
-        std::cout << termcolor::bold << termcolor::green << local << termcolor::reset << termcolor::yellow;
+        out << termcolor::bold << termcolor::green << local << termcolor::reset << termcolor::yellow;
         first = false;
     }
 
-    std::cout << ")" << termcolor::reset;
+    out << ")" << termcolor::reset;
 }
 
-void log_subcommand::print_commit(repository_wrapper& repo, const commit_wrapper& commit)
+void log_subcommand::print_commit(output_sink& out, const commit_wrapper& commit, const commit_refs& refs)
 {
     const bool abbrev_commit = (m_abbrev_commit_flag || m_oneline_flag) && !m_no_abbrev_commit_flag;
     const bool oneline = (m_format_flag == "oneline") || m_oneline_flag;
@@ -258,8 +252,6 @@ void log_subcommand::print_commit(repository_wrapper& repo, const commit_wrapper
         sha = sha.substr(0, m_abbrev);
     }
 
-    commit_refs refs = get_refs_for_commit(repo, commit.oid());
-
     std::string message = commit.message();
     while (!message.empty() && message.back() == '\n')
     {
@@ -274,11 +266,11 @@ void log_subcommand::print_commit(repository_wrapper& repo, const commit_wrapper
             std::getline(s, subject);
         }
 
-        std::cout << termcolor::yellow << sha << termcolor::reset;
-        print_refs(refs);
+        out << termcolor::yellow << sha << termcolor::reset;
+        print_refs(out, refs);
         if (!subject.empty())
         {
-            std::cout << " " << subject;
+            out << " " << subject;
         }
         return;
     }
@@ -287,29 +279,29 @@ void log_subcommand::print_commit(repository_wrapper& repo, const commit_wrapper
     signature_wrapper committer = signature_wrapper::get_commit_committer(commit);
 
     stream_colour_fn colour = termcolor::yellow;
-    std::cout << colour << "commit " << sha << termcolor::reset;
+    out << colour << "commit " << sha << termcolor::reset;
 
-    print_refs(refs);
+    print_refs(out, refs);
 
-    std::cout << termcolor::reset << std::endl;
+    out << termcolor::reset << '\n';
 
     if (m_format_flag == "fuller")
     {
-        std::cout << "Author:\t    " << author.name() << " " << author.email() << std::endl;
-        print_time(author.when(), "AuthorDate: ");
-        std::cout << "Commit:\t    " << committer.name() << " " << committer.email() << std::endl;
-        print_time(committer.when(), "CommitDate: ");
+        out << "Author:\t    " << author.name() << " " << author.email() << '\n';
+        print_time(out, author.when(), "AuthorDate: ");
+        out << "Commit:\t    " << committer.name() << " " << committer.email() << '\n';
+        print_time(out, committer.when(), "CommitDate: ");
     }
     else
     {
-        std::cout << "Author:\t" << author.name() << " " << author.email() << std::endl;
+        out << "Author:\t" << author.name() << " " << author.email() << '\n';
         if (m_format_flag == "full")
         {
-            std::cout << "Commit:\t" << committer.name() << " " << committer.email() << std::endl;
+            out << "Commit:\t" << committer.name() << " " << committer.email() << '\n';
         }
         else
         {
-            print_time(author.when(), "Date:\t");
+            print_time(out, author.when(), "Date:\t");
         }
     }
 
@@ -317,9 +309,9 @@ void log_subcommand::print_commit(repository_wrapper& repo, const commit_wrapper
     std::string line;
     while (std::getline(message_stream, line))
     {
-        std::cout << "\n    " << line;
+        out << "\n    " << line;
     }
-    std::cout << std::endl;
+    out << '\n';
 }
 
 void log_subcommand::run()
@@ -337,20 +329,33 @@ void log_subcommand::run()
     revwalk_wrapper walker = repo.new_walker();
     walker.push_head();
 
+    const commit_refs_map refs_index = build_refs_index(repo);
+    const commit_refs no_refs;
+
     terminal_pager pager;
+    output_sink out;
 
+    // Commits are only walked when the pager needs more lines to display. The pager only redirects cout
+    // whilst the producer runs, so each commit is handed over to cout before returning.
     std::size_t i = 0;
     git_oid commit_oid;
-    while (!walker.next(commit_oid) && i < m_max_count_flag)
-    {
-        if (i != 0)
+    pager.show(
+        [&]()
         {
-            std::cout << std::endl;
+            if (i >= m_max_count_flag || walker.next(commit_oid))
+            {
+                return false;
+            }
+            if (i != 0)
+            {
+                out << '\n';
+            }
+            commit_wrapper commit = repo.find_commit(commit_oid);
+            auto refs_it = refs_index.find(commit_oid);
+            print_commit(out, commit, refs_it != refs_index.end() ? refs_it->second : no_refs);
+            out.write_buffered();
+            ++i;
+            return true;
         }
-        commit_wrapper commit = repo.find_commit(commit_oid);
-        print_commit(repo, commit);
-        ++i;
-    }
-
-    pager.show();
+    );
 }
@@ -8,6 +8,9 @@
 #include "../wrapper/commit_wrapper.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 
+struct commit_refs;
+class output_sink;
+
 class log_subcommand
 {
 public:
@@ -17,7 +20,7 @@ public:
 
 private:
 
-    void print_commit(repository_wrapper& repo, const commit_wrapper& commit);
+    void print_commit(output_sink& out, const commit_wrapper& commit, const commit_refs& refs);
 
     std::string m_format_flag;
     int m_max_count_flag = std::numeric_limits<int>::max();
@@ -1,14 +1,38 @@
 #include "revlist_subcommand.hpp"
 
+#include <string_view>
+#include <unordered_set>
+
+#include <git2.h>
+
+#include "../utils/git_exception.hpp"
+#include "../utils/output_sink.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 #include "../wrapper/revwalk_wrapper.hpp"
 
+using oid_set = std::unordered_set<git_oid, git_oid_hash, git_oid_equal_to>;
+
 revlist_subcommand::revlist_subcommand(const libgit2_object&, CLI::App& app)
 {
     auto* sub = app.add_subcommand("rev-list", "Lists commit objects in reverse chronological order");
 
-    sub->add_option("<commit>", m_commit, "");
+    sub->add_option(
+        "<commit>",
+        m_commits,
+        "Commits to list the ancestors of. ^<commit> excludes the ancestors of <commit>, <a>..<b> lists the "
+        "ancestors of <b> that are not ancestors of <a>, <a>...<b> the ancestors of either but not of both"
+    );
     sub->add_option("-n,--max-count", m_max_count_flag, "Limit the output to <number> commits.");
+    sub->add_flag(
+        "--count",
+        m_count_flag,
+        "Print the number of objects that would be listed instead of the objects"
+    );
+    sub->add_flag(
+        "--objects",
+        m_objects_flag,
+        "Also list the trees and blobs reachable from the listed commits, with their path"
+    );
 
     sub->callback(
         [this]()
@@ -18,9 +42,154 @@ revlist_subcommand::revlist_subcommand(const libgit2_object&, CLI::App& app)
     );
 }
 
+namespace
+{
+    git_oid resolve_commit(const repository_wrapper& repo, std::string_view spec)
+    {
+        // An empty side of a range means HEAD, as in "main.." or "..main".
+        const std::string rev = spec.empty() ? "HEAD" : std::string(spec);
+        auto obj = repo.revparse_single(rev);
+        if (!obj)
+        {
+            throw git_exception("bad revision '" + rev + "'", git2cpp_error_code::BAD_ARGUMENT);
+        }
+
+        git_object* commit = nullptr;
+        throw_if_error(git_object_peel(&commit, *obj, GIT_OBJECT_COMMIT));
+        git_oid oid = *git_object_id(commit);
+        git_object_free(commit);
+        return oid;
+    }
+
+    // Push the commits to list and hide the ones to exclude, returning the hidden commits.
+    std::vector<git_oid>
+    push_specs(const repository_wrapper& repo, revwalk_wrapper& walker, const std::vector<std::string>& specs)
+    {
+        std::vector<git_oid> hidden;
+        const auto hide = [&](const git_oid& oid)
+        {
+            walker.hide(oid);
+            hidden.push_back(oid);
+        };
+
+        for (std::string_view spec : specs)
+        {
+            if (spec.starts_with('^'))
+            {
+                hide(resolve_commit(repo, spec.substr(1)));
+            }
+            else if (auto pos = spec.find("..."); pos != std::string_view::npos)
+            {
+                git_oid lhs = resolve_commit(repo, spec.substr(0, pos));
+                git_oid rhs = resolve_commit(repo, spec.substr(pos + 3));
+                walker.push(lhs);
+                walker.push(rhs);
+
+                git_oidarray bases = {nullptr, 0};
+                int error = git_merge_bases(&bases, repo, &lhs, &rhs);
+                if (error != GIT_ENOTFOUND)
+                {
+                    throw_if_error(error);
+                }
+                for (size_t i = 0; i < bases.count; ++i)
+                {
+                    hide(bases.ids[i]);
+                }
+                git_oidarray_dispose(&bases);
+            }
+            else if (auto pos = spec.find(".."); pos != std::string_view::npos)
+            {
+                hide(resolve_commit(repo, spec.substr(0, pos)));
+                walker.push(resolve_commit(repo, spec.substr(pos + 2)));
+            }
+            else
+            {
+                walker.push(resolve_commit(repo, spec));
+            }
+        }
+        return hidden;
+    }
+
+    void mark_tree_seen(repository_wrapper& repo, const git_oid& tree_oid, oid_set& seen)
+    {
+        if (!seen.insert(tree_oid).second)
+        {
+            return;
+        }
+
+        tree_wrapper tree = repo.tree_lookup(&tree_oid);
+        for (size_t i = 0; i < git_tree_entrycount(tree); ++i)
+        {
+            const git_tree_entry* entry = git_tree_entry_byindex(tree, i);
+            if (git_tree_entry_type(entry) == GIT_OBJECT_TREE)
+            {
+                mark_tree_seen(repo, *git_tree_entry_id(entry), seen);
+            }
+            else if (git_tree_entry_type(entry) == GIT_OBJECT_BLOB)
+            {
+                seen.insert(*git_tree_entry_id(entry));
+            }
+        }
+    }
+
+    // Count the objects of the tree not seen yet, writing them to out unless it is null. Blobs are
+    // never loaded, and trees only once.
+    size_t list_tree_objects(
+        repository_wrapper& repo,
+        const git_oid& tree_oid,
+        std::string& path,
+        oid_set& seen,
+        output_sink* out
+    )
+    {
+        if (!seen.insert(tree_oid).second)
+        {
+            return 0;
+        }
+        if (out)
+        {
+            out->write_oid(tree_oid) << ' ' << path << '\n';
+        }
+
+        size_t count = 1;
+        const size_t path_size = path.size();
+        tree_wrapper tree = repo.tree_lookup(&tree_oid);
+        for (size_t i = 0; i < git_tree_entrycount(tree); ++i)
+        {
+            const git_tree_entry* entry = git_tree_entry_byindex(tree, i);
+            const git_object_t type = git_tree_entry_type(entry);
+            if (type != GIT_OBJECT_TREE && type != GIT_OBJECT_BLOB)
+            {
+                // Submodule commits are not part of this repository.
+                continue;
+            }
+
+            if (path_size != 0)
+            {
+                path += '/';
+            }
+            path += git_tree_entry_name(entry);
+            if (type == GIT_OBJECT_TREE)
+            {
+                count += list_tree_objects(repo, *git_tree_entry_id(entry), path, seen, out);
+            }
+            else if (seen.insert(*git_tree_entry_id(entry)).second)
+            {
+                if (out)
+                {
+                    out->write_oid(*git_tree_entry_id(entry)) << ' ' << path << '\n';
+                }
+                ++count;
+            }
+            path.resize(path_size);
+        }
+        return count;
+    }
+}
+
 void revlist_subcommand::run()
 {
-    if (m_commit.empty())
+    if (m_commits.empty())
     {
         throw std::runtime_error("usage: git rev-list [<options>] <commit>... [--] [<path>...]");  // TODO:
                                                                                                    // add help
@@ -29,25 +198,50 @@ void revlist_subcommand::run()
 
     auto directory = get_current_git_path();
     auto repo = repository_wrapper::open(directory);
-    git_oid start_commit_oid;
-    int not_sha1 = git_oid_fromstrp(&start_commit_oid, m_commit.c_str());
-    if (not_sha1)
-    {
-        commit_wrapper start_commit = repo.find_commit(m_commit);
-        start_commit_oid = start_commit.oid();
-    }
 
     revwalk_wrapper walker = repo.new_walker();
-    walker.push(start_commit_oid);
+    const std::vector<git_oid> hidden = push_specs(repo, walker, m_commits);
+
+    // Output is block-buffered, and with --count nothing is formatted but the total.
+    output_sink out;
+    output_sink* listing = m_count_flag ? nullptr : &out;
 
-    std::size_t i = 0;
+    std::vector<git_oid> commits;
+    size_t count = 0;
     git_oid commit_oid;
-    char buf[GIT_OID_SHA1_HEXSIZE + 1];
-    while (!walker.next(commit_oid) && i < m_max_count_flag)
+    while (count < size_t(m_max_count_flag) && !walker.next(commit_oid))
+    {
+        if (listing)
+        {
+            listing->write_oid(commit_oid) << '\n';
+        }
+        if (m_objects_flag)
+        {
+            commits.push_back(commit_oid);
+        }
+        ++count;
+    }
+
+    if (m_objects_flag)
+    {
+        // Objects reachable from the excluded commits are not listed.
+        oid_set seen;
+        for (const auto& oid : hidden)
+        {
+            const git_oid tree_oid = *git_commit_tree_id(repo.find_commit(oid));
+            mark_tree_seen(repo, tree_oid, seen);
+        }
+
+        std::string path;
+        for (const auto& oid : commits)
+        {
+            const git_oid tree_oid = *git_commit_tree_id(repo.find_commit(oid));
+            count += list_tree_objects(repo, tree_oid, path, seen, listing);
+        }
+    }
+
+    if (m_count_flag)
     {
-        git_oid_fmt(buf, &commit_oid);
-        buf[GIT_OID_SHA1_HEXSIZE] = '\0';
-        std::cout << buf << std::endl;
-        ++i;
+        out << count << '\n';
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <CLI/CLI.hpp>
 
@@ -15,6 +16,8 @@ public:
 
 private:
 
-    std::string m_commit;
+    std::vector<std::string> m_commits;
     int m_max_count_flag = std::numeric_limits<int>::max();
+    bool m_count_flag = false;
+    bool m_objects_flag = false;
 };
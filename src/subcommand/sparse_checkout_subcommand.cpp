@@ -0,0 +1,128 @@
+#include "../subcommand/sparse_checkout_subcommand.hpp"
+
+#include <iostream>
+
+#include "../utils/git_exception.hpp"
+
+sparse_checkout_subcommand::sparse_checkout_subcommand(const libgit2_object&, CLI::App& app)
+{
+    auto* sub =
+        app.add_subcommand("sparse-checkout", "Reduce your working tree to a subset of tracked files");
+    auto* init = sub->add_subcommand("init", "Check out the files of the root directory only");
+    auto* set = sub->add_subcommand("set", "Check out the files of the given directories only");
+    auto* add = sub->add_subcommand("add", "Add directories to the sparse checkout");
+    auto* list = sub->add_subcommand("list", "List the directories of the sparse checkout");
+    auto* disable = sub->add_subcommand("disable", "Check out every file again");
+    sub->require_subcommand(1);
+
+    set->add_option("<directory>", m_directories, "Directories to check out");
+    add->add_option("<directory>", m_directories, "Directories to check out")->required();
+
+    init->callback(
+        [this]()
+        {
+            this->run_init();
+        }
+    );
+    set->callback(
+        [this]()
+        {
+            this->run_set();
+        }
+    );
+    add->callback(
+        [this]()
+        {
+            this->run_add();
+        }
+    );
+    list->callback(
+        [this]()
+        {
+            this->run_list();
+        }
+    );
+    disable->callback(
+        [this]()
+        {
+            this->run_disable();
+        }
+    );
+}
+
+void sparse_checkout_subcommand::run_init()
+{
+    auto repo = repository_wrapper::open(get_current_git_path());
+    // Like git, the existing patterns are kept.
+    const auto existing = sparse_checkout::load(repo);
+    enable(repo, existing ? *existing : sparse_checkout());
+}
+
+void sparse_checkout_subcommand::run_set()
+{
+    auto repo = repository_wrapper::open(get_current_git_path());
+    enable(repo, sparse_checkout(m_directories));
+}
+
+void sparse_checkout_subcommand::run_add()
+{
+    auto repo = repository_wrapper::open(get_current_git_path());
+    auto sparse = sparse_checkout::load(repo);
+    if (!sparse)
+    {
+        throw git_exception("fatal: no sparse-checkout to add to", git2cpp_error_code::BAD_ARGUMENT);
+    }
+    sparse->add(m_directories);
+    enable(repo, *sparse);
+}
+
+void sparse_checkout_subcommand::run_list()
+{
+    auto repo = repository_wrapper::open(get_current_git_path());
+    const auto sparse = sparse_checkout::load(repo);
+    if (!sparse)
+    {
+        throw git_exception("fatal: this worktree is not sparse", git2cpp_error_code::BAD_ARGUMENT);
+    }
+    for (const auto& directory : sparse->directories())
+    {
+        std::cout << directory << std::endl;
+    }
+}
+
+void sparse_checkout_subcommand::run_disable()
+{
+    auto repo = repository_wrapper::open(get_current_git_path());
+    repo.get_config().set_entry("core.sparseCheckout", "false");
+    update_worktree(repo, nullptr);
+}
+
+void sparse_checkout_subcommand::enable(repository_wrapper& repo, const sparse_checkout& sparse)
+{
+    if (repo.is_bare())
+    {
+        throw git_exception(
+            "fatal: this operation must be run in a work tree",
+            git2cpp_error_code::BAD_ARGUMENT
+        );
+    }
+    sparse.store(repo.path());
+    auto config = repo.get_config();
+    config.set_entry("core.sparseCheckout", "true");
+    config.set_entry("core.sparseCheckoutCone", "true");
+    update_worktree(repo, &sparse);
+}
+
+void sparse_checkout_subcommand::update_worktree(repository_wrapper& repo, const sparse_checkout* sparse)
+{
+    const auto left_paths = apply_sparse_checkout(repo, sparse);
+    if (!left_paths.empty())
+    {
+        std::cerr << "warning: The following paths are not up to date and were left despite sparse patterns:"
+                  << std::endl;
+        for (const auto& path : left_paths)
+        {
+            std::cerr << "\t" << path << std::endl;
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+
+#include "../utils/common.hpp"
+#include "../utils/sparse_checkout.hpp"
+#include "../wrapper/repository_wrapper.hpp"
+
+class sparse_checkout_subcommand
+{
+public:
+
+    explicit sparse_checkout_subcommand(const libgit2_object&, CLI::App& app);
+    void run_init();
+    void run_set();
+    void run_add();
+    void run_list();
+    void run_disable();
+
+private:
+
+    void enable(repository_wrapper& repo, const sparse_checkout& sparse);
+    void update_worktree(repository_wrapper& repo, const sparse_checkout* sparse);
+
+    std::vector<std::string> m_directories;
+};
@@ -167,5 +167,14 @@ void stash_subcommand::run_show()
     {
         m_stat_flag = true;
     }
-    print_stats(diff, use_colour, m_stat_flag, m_shortstat_flag, m_numstat_flag, m_summary_flag);
+    print_stats(
+        diff,
+        &repo,
+        diff_opts.flags,
+        use_colour,
+        m_stat_flag,
+        m_shortstat_flag,
+        m_numstat_flag,
+        m_summary_flag
+    );
 }
@@ -8,6 +8,8 @@
 #include <git2.h>
 #include <termcolor/termcolor.hpp>
 
+#include "../utils/output_sink.hpp"
+
 status_subcommand::status_subcommand(const libgit2_object&, CLI::App& app)
 {
     auto* sub = app.add_subcommand(
@@ -129,22 +131,28 @@ std::vector<print_entry> get_entries_to_print(
     return entries_to_print;
 }
 
-void print_entries(std::vector<print_entry> entries_to_print, bool is_long, stream_colour_fn colour)
+void print_entries(
+    output_sink& out,
+    std::vector<print_entry> entries_to_print,
+    bool is_long,
+    stream_colour_fn colour
+)
 {
     for (auto e : entries_to_print)
     {
         if (is_long)
         {
-            std::cout << colour << e.status << e.item << termcolor::reset << std::endl;
+            out << colour << e.status << e.item << termcolor::reset << '\n';
         }
         else
         {
-            std::cout << colour << e.status << termcolor::reset << e.item << std::endl;
+            out << colour << e.status << termcolor::reset << e.item << '\n';
         }
     }
 }
 
 void print_not_tracked(
+    output_sink& out,
     const std::vector<print_entry>& entries_to_print,
     const std::set<std::string>& tracked_dir_set,
     std::set<std::string>& untracked_dir_set,
@@ -180,10 +188,10 @@ void print_not_tracked(
             not_tracked_entries_to_print.push_back(e);
         }
     }
-    print_entries(not_tracked_entries_to_print, is_long, colour);
+    print_entries(out, not_tracked_entries_to_print, is_long, colour);
 }
 
-void print_tracking_info(repository_wrapper& repo, status_list_wrapper& sl, bool is_long)
+void print_tracking_info(output_sink& out, repository_wrapper& repo, status_list_wrapper& sl, bool is_long)
 {
     auto tracking_info = repo.get_tracking_info();
 
@@ -193,76 +201,79 @@ void print_tracking_info(repository_wrapper& repo, status_list_wrapper& sl, bool
         {
             if (tracking_info.ahead > 0 && tracking_info.behind == 0)
             {
-                std::cout << "Your branch is ahead of '" << tracking_info.upstream_name << "' by "
-                          << tracking_info.ahead << " commit" << (tracking_info.ahead > 1 ? "s" : "") << "."
-                          << std::endl;
-                std::cout << "  (use \"git push\" to publish your local commits)" << std::endl;
+                out << "Your branch is ahead of '" << tracking_info.upstream_name << "' by "
+                    << tracking_info.ahead << " commit" << (tracking_info.ahead > 1 ? "s" : "") << "."
+                    << '\n';
+                out << "  (use \"git push\" to publish your local commits)" << '\n';
             }
             else if (tracking_info.ahead == 0 && tracking_info.behind > 0)
             {
-                std::cout << "Your branch is behind '" << tracking_info.upstream_name << "' by "
-                          << tracking_info.behind << " commit" << (tracking_info.behind > 1 ? "s" : "") << "."
-                          << std::endl;
-                std::cout << "  (use \"git pull\" to update your local branch)" << std::endl;
+                out << "Your branch is behind '" << tracking_info.upstream_name << "' by "
+                    << tracking_info.behind << " commit" << (tracking_info.behind > 1 ? "s" : "") << "."
+                    << '\n';
+                out << "  (use \"git pull\" to update your local branch)" << '\n';
             }
             else if (tracking_info.ahead > 0 && tracking_info.behind > 0)
             {
-                std::cout << "Your branch and '" << tracking_info.upstream_name << "' have diverged,"
-                          << std::endl;
-                std::cout << "and have " << tracking_info.ahead << " and " << tracking_info.behind
-                          << " different commit"
-                          << ((tracking_info.ahead + tracking_info.behind) > 2 ? "s" : "")
-                          << " each, respectively." << std::endl;
-                std::cout << "  (use \"git pull\" to merge the remote branch into yours)" << std::endl;
+                out << "Your branch and '" << tracking_info.upstream_name << "' have diverged," << '\n';
+                out << "and have " << tracking_info.ahead << " and " << tracking_info.behind
+                    << " different commit" << ((tracking_info.ahead + tracking_info.behind) > 2 ? "s" : "")
+                    << " each, respectively." << '\n';
+                out << "  (use \"git pull\" to merge the remote branch into yours)" << '\n';
             }
             else  // ahead == 0 && behind == 0
             {
-                std::cout << "Your branch is up to date with '" << tracking_info.upstream_name << "'."
-                          << std::endl;
+                out << "Your branch is up to date with '" << tracking_info.upstream_name << "'." << '\n';
             }
-            std::cout << std::endl;
+            out << '\n';
         }
 
         if (repo.is_head_unborn())
         {
-            std::cout << "No commit yet\n" << std::endl;
+            out << "No commit yet\n" << '\n';
         }
 
         if (sl.has_unmerged_header())
         {
-            std::cout << "You have unmerged paths.\n  (fix conflicts and run \"git commit\")\n  (use \"git merge --abort\" to abort the merge)\n"
-                      << std::endl;
+            out << "You have unmerged paths.\n  (fix conflicts and run \"git commit\")\n  (use \"git merge --abort\" to abort the merge)\n"
+                << '\n';
         }
     }
     else
     {
         if (tracking_info.has_upstream)
         {
-            std::cout << "..." << tracking_info.upstream_name;
+            out << "..." << tracking_info.upstream_name;
 
             if (tracking_info.ahead > 0 || tracking_info.behind > 0)
             {
-                std::cout << " [";
+                out << " [";
                 if (tracking_info.ahead > 0)
                 {
-                    std::cout << "ahead " << tracking_info.ahead;
+                    out << "ahead " << tracking_info.ahead;
                 }
                 if (tracking_info.behind > 0)
                 {
                     if (tracking_info.ahead > 0)
                     {
-                        std::cout << ", ";
+                        out << ", ";
                     }
-                    std::cout << "behind " << tracking_info.behind;
+                    out << "behind " << tracking_info.behind;
                 }
-                std::cout << "]";
+                out << "]";
             }
-            std::cout << std::endl;
+            out << '\n';
         }
     }
 }
 
-void print_tobecommited(status_list_wrapper& sl, std::set<std::string> tracked_dir_set, bool is_long, bool is_coloured)
+void print_tobecommited(
+    output_sink& out,
+    status_list_wrapper& sl,
+    std::set<std::string> tracked_dir_set,
+    bool is_long,
+    bool is_coloured
+)
 {
     stream_colour_fn colour;
     if (is_coloured)
@@ -276,36 +287,51 @@ void print_tobecommited(status_list_wrapper& sl, std::set<std::string> tracked_d
 
     if (is_long)
     {
-        std::cout << tobecommited_header;
+        out << tobecommited_header;
     }
-    print_entries(get_entries_to_print(GIT_STATUS_INDEX_NEW, sl, true, is_long, &tracked_dir_set), is_long, colour);
     print_entries(
+        out,
+        get_entries_to_print(GIT_STATUS_INDEX_NEW, sl, true, is_long, &tracked_dir_set),
+        is_long,
+        colour
+    );
+    print_entries(
+        out,
         get_entries_to_print(GIT_STATUS_INDEX_MODIFIED, sl, true, is_long, &tracked_dir_set),
         is_long,
         colour
     );
     print_entries(
+        out,
         get_entries_to_print(GIT_STATUS_INDEX_DELETED, sl, true, is_long, &tracked_dir_set),
         is_long,
         colour
     );
     print_entries(
+        out,
         get_entries_to_print(GIT_STATUS_INDEX_RENAMED, sl, true, is_long, &tracked_dir_set),
         is_long,
         colour
     );
     print_entries(
+        out,
         get_entries_to_print(GIT_STATUS_INDEX_TYPECHANGE, sl, true, is_long, &tracked_dir_set),
         is_long,
         colour
     );
     if (is_long)
     {
-        std::cout << std::endl;
+        out << '\n';
     }
 }
 
-void print_notstagged(status_list_wrapper& sl, std::set<std::string> tracked_dir_set, bool is_long, bool is_coloured)
+void print_notstagged(
+    output_sink& out,
+    status_list_wrapper& sl,
+    std::set<std::string> tracked_dir_set,
+    bool is_long,
+    bool is_coloured
+)
 {
     stream_colour_fn colour;
     if (is_coloured)
@@ -319,35 +345,40 @@ void print_notstagged(status_list_wrapper& sl, std::set<std::string> tracked_dir
 
     if (is_long)
     {
-        std::cout << notstagged_header;
+        out << notstagged_header;
     }
     print_entries(
+        out,
         get_entries_to_print(GIT_STATUS_WT_MODIFIED, sl, false, is_long, &tracked_dir_set),
         is_long,
         colour
     );
     print_entries(
+        out,
         get_entries_to_print(GIT_STATUS_WT_DELETED, sl, false, is_long, &tracked_dir_set),
         is_long,
         colour
     );
     print_entries(
+        out,
         get_entries_to_print(GIT_STATUS_WT_TYPECHANGE, sl, false, is_long, &tracked_dir_set),
         is_long,
         colour
     );
     print_entries(
+        out,
         get_entries_to_print(GIT_STATUS_WT_RENAMED, sl, false, is_long, &tracked_dir_set),
         is_long,
         colour
     );
     if (is_long)
     {
-        std::cout << std::endl;
+        out << '\n';
     }
 }
 
 void print_unmerged(
+    output_sink& out,
     status_list_wrapper& sl,
     std::set<std::string> tracked_dir_set,
     std::set<std::string> untracked_dir_set,
@@ -367,9 +398,10 @@ void print_unmerged(
 
     if (is_long)
     {
-        std::cout << unmerged_header;
+        out << unmerged_header;
     }
     print_not_tracked(
+        out,
         get_entries_to_print(GIT_STATUS_CONFLICTED, sl, false, is_long),
         tracked_dir_set,
         untracked_dir_set,
@@ -378,11 +410,12 @@ void print_unmerged(
     );
     if (is_long)
     {
-        std::cout << std::endl;
+        out << '\n';
     }
 }
 
 void print_untracked(
+    output_sink& out,
     status_list_wrapper& sl,
     std::set<std::string> tracked_dir_set,
     std::set<std::string> untracked_dir_set,
@@ -402,9 +435,10 @@ void print_untracked(
 
     if (is_long)
     {
-        std::cout << untracked_header;
+        out << untracked_header;
     }
     print_not_tracked(
+        out,
         get_entries_to_print(GIT_STATUS_WT_NEW, sl, false, is_long),
         tracked_dir_set,
         untracked_dir_set,
@@ -413,7 +447,7 @@ void print_untracked(
     );
     if (is_long)
     {
-        std::cout << std::endl;
+        out << '\n';
     }
 }
 
@@ -427,6 +461,7 @@ void status_run(status_subcommand_options options)
     auto directory = get_current_git_path();
     auto repo = repository_wrapper::open(directory);
     auto sl = status_list_wrapper::status_list(repo);
+    output_sink out;
 
     std::set<std::string> tracked_dir_set{};
     std::set<std::string> untracked_dir_set{};
@@ -453,34 +488,34 @@ void status_run(status_subcommand_options options)
     auto branch_name = repo.head_short_name();
     if (is_long)
     {
-        std::cout << "On branch " << branch_name << std::endl;
+        out << "On branch " << branch_name << '\n';
     }
     else if (options.m_branch_flag)
     {
-        std::cout << "## " << branch_name << std::endl;
+        out << "## " << branch_name << '\n';
     }
     bool is_coloured = true;
-    print_tracking_info(repo, sl, is_long);
+    print_tracking_info(out, repo, sl, is_long);
 
     if (sl.has_tobecommited_header())
     {
-        print_tobecommited(sl, tracked_dir_set, is_long, is_coloured);
+        print_tobecommited(out, sl, tracked_dir_set, is_long, is_coloured);
     }
 
     if (sl.has_notstagged_header())
     {
-        print_notstagged(sl, tracked_dir_set, is_long, is_coloured);
+        print_notstagged(out, sl, tracked_dir_set, is_long, is_coloured);
     }
 
     // TODO: check if should be printed before "not stagged" files
     if (sl.has_unmerged_header())
     {
-        print_unmerged(sl, tracked_dir_set, untracked_dir_set, is_long, is_coloured);
+        print_unmerged(out, sl, tracked_dir_set, untracked_dir_set, is_long, is_coloured);
     }
 
     if (sl.has_untracked_header())
     {
-        print_untracked(sl, tracked_dir_set, untracked_dir_set, is_long, is_coloured);
+        print_untracked(out, sl, tracked_dir_set, untracked_dir_set, is_long, is_coloured);
     }
 
     // TODO: check if this message should be displayed even if there are untracked files
@@ -490,11 +525,11 @@ void status_run(status_subcommand_options options)
             || sl.has_untracked_header()
         ))
     {
-        std::cout << treeclean_message << std::endl;
+        out << treeclean_message << '\n';
     }
 
     if (is_long & !sl.has_tobecommited_header() && (sl.has_notstagged_header() || sl.has_untracked_header()))
     {
-        std::cout << nothingtocommit_message << std::endl;
+        out << nothingtocommit_message << '\n';
     }
 }
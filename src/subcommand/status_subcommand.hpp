@@ -3,6 +3,7 @@
 #include <CLI/CLI.hpp>
 
 #include "../utils/common.hpp"
+#include "../utils/output_sink.hpp"
 #include "../wrapper/status_wrapper.hpp"
 
 struct status_subcommand_options
@@ -24,7 +25,19 @@ private:
     status_subcommand_options m_options;
 };
 
-void print_tobecommited(status_list_wrapper& sl, std::set<std::string> tracked_dir_set, bool is_long, bool is_coloured);
-void print_notstagged(status_list_wrapper& sl, std::set<std::string> tracked_dir_set, bool is_long, bool is_coloured);
-void print_tracking_info(repository_wrapper& repo, status_list_wrapper& sl, bool is_long);
+void print_tobecommited(
+    output_sink& out,
+    status_list_wrapper& sl,
+    std::set<std::string> tracked_dir_set,
+    bool is_long,
+    bool is_coloured
+);
+void print_notstagged(
+    output_sink& out,
+    status_list_wrapper& sl,
+    std::set<std::string> tracked_dir_set,
+    bool is_long,
+    bool is_coloured
+);
+void print_tracking_info(output_sink& out, repository_wrapper& repo, status_list_wrapper& sl, bool is_long);
 void status_run(status_subcommand_options fl = {});
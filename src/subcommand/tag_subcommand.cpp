@@ -1,7 +1,11 @@
 #include "../subcommand/tag_subcommand.hpp"
 
+#include <string_view>
+
 #include <git2.h>
 
+#include "../utils/output_sink.hpp"
+
 tag_subcommand::tag_subcommand(const libgit2_object&, CLI::App& app)
 {
     auto* sub = app.add_subcommand("tag", "Create, list, delete or verify tags");
@@ -27,8 +31,19 @@ tag_subcommand::tag_subcommand(const libgit2_object&, CLI::App& app)
     );
 }
 
+// Tag listing: Print a tag name left-aligned in a 16 characters column
+void print_name(output_sink& out, std::string_view name)
+{
+    constexpr size_t column_width = 16;
+    out << name;
+    if (name.size() < column_width)
+    {
+        out << std::string(column_width - name.size(), ' ');
+    }
+}
+
 // Tag listing: Print individual message lines
-void print_list_lines(const std::string& message, int num_lines)
+void print_list_lines(output_sink& out, const std::string& message, int num_lines)
 {
     if (message.empty())
     {
@@ -38,12 +53,12 @@ void print_list_lines(const std::string& message, int num_lines)
     auto lines = split_input_at_newlines(message);
 
     // header
-    std::cout << lines[0];
+    out << lines[0];
 
     // other lines
     if (num_lines <= 1 || lines.size() <= 2)
     {
-        std::cout << std::endl;
+        out << '\n';
     }
     else
     {
@@ -51,60 +66,60 @@ void print_list_lines(const std::string& message, int num_lines)
         {
             if (i < num_lines)
             {
-                std::cout << "\n\t\t" << lines[i];
+                out << "\n\t\t" << lines[i];
             }
         }
     }
 }
 
 // Tag listing: Print an actual tag object
-void print_tag(git_tag* tag, int num_lines)
+void print_tag(output_sink& out, git_tag* tag, int num_lines)
 {
-    std::cout << std::left << std::setw(16) << git_tag_name(tag);
+    print_name(out, git_tag_name(tag));
 
     if (num_lines)
     {
         std::string msg = git_tag_message(tag);
         if (!msg.empty())
         {
-            print_list_lines(msg, num_lines);
+            print_list_lines(out, msg, num_lines);
         }
         else
         {
-            std::cout << std::endl;
+            out << '\n';
         }
     }
     else
     {
-        std::cout << std::endl;
+        out << '\n';
     }
 }
 
 // Tag listing: Print a commit (target of a lightweight tag)
-void print_commit(git_commit* commit, std::string name, int num_lines)
+void print_commit(output_sink& out, git_commit* commit, std::string name, int num_lines)
 {
-    std::cout << std::left << std::setw(16) << name;
+    print_name(out, name);
 
     if (num_lines)
     {
         std::string msg = git_commit_message(commit);
         if (!msg.empty())
         {
-            print_list_lines(msg, num_lines);
+            print_list_lines(out, msg, num_lines);
         }
         else
         {
-            std::cout << std::endl;
+            out << '\n';
         }
     }
     else
     {
-        std::cout << std::endl;
+        out << '\n';
     }
 }
 
 // Tag listing: Lookup tags based on ref name and dispatch to print
-void each_tag(repository_wrapper& repo, const std::string& name, int num_lines)
+void each_tag(output_sink& out, repository_wrapper& repo, const std::string& name, int num_lines)
 {
     auto obj = repo.revparse_single(name);
 
@@ -113,18 +128,18 @@ void each_tag(repository_wrapper& repo, const std::string& name, int num_lines)
         switch (git_object_type(obj.value()))
         {
             case GIT_OBJECT_TAG:
-                print_tag(obj.value(), num_lines);
+                print_tag(out, obj.value(), num_lines);
                 break;
             case GIT_OBJECT_COMMIT:
-                print_commit(obj.value(), name, num_lines);
+                print_commit(out, obj.value(), name, num_lines);
                 break;
             default:
-                std::cout << name << std::endl;
+                out << name << '\n';
         }
     }
     else
     {
-        std::cout << name << std::endl;
+        out << name << '\n';
     }
 }
 
@@ -133,9 +148,10 @@ void tag_subcommand::list_tags(repository_wrapper& repo)
     std::string pattern = m_tag_name.empty() ? "*" : m_tag_name;
     auto tag_names = repo.tag_list_match(pattern);
 
+    output_sink out;
     for (const auto& tag_name : tag_names)
     {
-        each_tag(repo, tag_name, m_num_lines);
+        each_tag(out, repo, tag_name, m_num_lines);
     }
 }
 
@@ -0,0 +1,332 @@
+#include "commit_graph.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <git2/sys/commit_graph.h>
+
+#include "git_exception.hpp"
+
+// File format: https://git-scm.com/docs/gitformat-commit-graph
+static constexpr uint32_t graph_signature = 0x43475048;  // "CGPH"
+static constexpr uint32_t chunk_oid_fanout = 0x4f494446;  // "OIDF"
+static constexpr uint32_t chunk_oid_lookup = 0x4f49444c;  // "OIDL"
+static constexpr uint32_t chunk_commit_data = 0x43444154;  // "CDAT"
+static constexpr uint32_t chunk_extra_edges = 0x45444745;  // "EDGE"
+
+static constexpr size_t header_size = 8;
+static constexpr size_t chunk_entry_size = 12;
+static constexpr size_t hash_size = 20;
+static constexpr size_t fanout_size = 256 * 4;
+static constexpr size_t commit_data_size = hash_size + 16;
+
+static constexpr uint32_t parent_none = 0x70000000;
+static constexpr uint32_t parent_octopus = 0x80000000;
+static constexpr uint32_t last_edge = 0x80000000;
+
+static uint32_t read_be32(const unsigned char* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static uint64_t read_be64(const unsigned char* p)
+{
+    return (uint64_t(read_be32(p)) << 32) | read_be32(p + 4);
+}
+
+static git_exception corrupt_graph()
+{
+    return git_exception("error: commit-graph file is corrupt", git2cpp_error_code::GENERIC_ERROR);
+}
+
+struct commit_graph_writer_deleter
+{
+    void operator()(git_commit_graph_writer* writer) const
+    {
+        git_commit_graph_writer_free(writer);
+    }
+};
+
+using commit_graph_writer_ptr = std::unique_ptr<git_commit_graph_writer, commit_graph_writer_deleter>;
+
+static commit_graph_writer_ptr new_writer(const std::string& objects_info_dir, git_revwalk* walk)
+{
+    git_commit_graph_writer* writer = nullptr;
+    throw_if_error(git_commit_graph_writer_new(&writer, objects_info_dir.c_str(), nullptr));
+    commit_graph_writer_ptr result(writer);
+    throw_if_error(git_commit_graph_writer_add_revwalk(writer, walk));
+    return result;
+}
+
+void commit_graph::write(const std::string& objects_info_dir, git_revwalk* walk)
+{
+    std::filesystem::create_directories(objects_info_dir);
+    auto writer = new_writer(objects_info_dir, walk);
+    throw_if_error(git_commit_graph_writer_commit(writer.get()));
+}
+
+std::string commit_graph::dump(const std::string& objects_info_dir, git_revwalk* walk)
+{
+    auto writer = new_writer(objects_info_dir, walk);
+    git_buf buf = GIT_BUF_INIT;
+    const int error = git_commit_graph_writer_dump(&buf, writer.get());
+    std::string content = error == 0 ? std::string(buf.ptr, buf.size) : std::string();
+    git_buf_dispose(&buf);
+    throw_if_error(error);
+    return content;
+}
+
+std::unique_ptr<commit_graph> commit_graph::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            return nullptr;
+        }
+        throw git_exception("error: could not open " + path, git2cpp_error_code::FILESYSTEM_ERROR);
+    }
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        throw git_exception("error: could not read " + path, git2cpp_error_code::FILESYSTEM_ERROR);
+    }
+
+    const size_t size = static_cast<size_t>(st.st_size);
+    try
+    {
+        return std::unique_ptr<commit_graph>(new commit_graph(static_cast<const unsigned char*>(data), size));
+    }
+    catch (...)
+    {
+        munmap(data, size);
+        throw;
+    }
+}
+
+commit_graph::commit_graph(const unsigned char* data, size_t data_size)
+    : m_data(data)
+    , m_size(data_size)
+    , m_fanout(nullptr)
+    , m_oid_lookup(nullptr)
+    , m_commit_data(nullptr)
+    , m_extra_edges(nullptr)
+    , m_extra_edges_count(0)
+    , m_libgit2_chunks(false)
+{
+    if (m_size < header_size + chunk_entry_size + hash_size || read_be32(m_data) != graph_signature
+        || m_data[4] != 1 || m_data[5] != 1 || m_data[7] != 0)
+    {
+        throw corrupt_graph();
+    }
+
+    const size_t chunk_count = m_data[6];
+    const size_t chunks_end = m_size - hash_size;
+    if (header_size + (chunk_count + 1) * chunk_entry_size > chunks_end)
+    {
+        throw corrupt_graph();
+    }
+
+    // The chunks libgit2 writes, in its order. The extra edges are only there for octopus merges.
+    static constexpr uint32_t libgit2_chunks[] = {
+        chunk_oid_fanout,
+        chunk_oid_lookup,
+        chunk_commit_data,
+        chunk_extra_edges
+    };
+    m_libgit2_chunks = chunk_count == 3 || chunk_count == 4;
+
+    size_t oid_lookup_size = 0;
+    size_t commit_data_bytes = 0;
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        const unsigned char* entry = m_data + header_size + i * chunk_entry_size;
+        m_libgit2_chunks = m_libgit2_chunks && i < 4 && read_be32(entry) == libgit2_chunks[i];
+        const uint64_t offset = read_be64(entry + 4);
+        const uint64_t next_offset = read_be64(entry + chunk_entry_size + 4);
+        if (offset > next_offset || next_offset > chunks_end)
+        {
+            throw corrupt_graph();
+        }
+
+        const size_t chunk_size = static_cast<size_t>(next_offset - offset);
+        switch (read_be32(entry))
+        {
+            case chunk_oid_fanout:
+                if (chunk_size != fanout_size)
+                {
+                    throw corrupt_graph();
+                }
+                m_fanout = m_data + offset;
+                break;
+            case chunk_oid_lookup:
+                m_oid_lookup = m_data + offset;
+                oid_lookup_size = chunk_size;
+                break;
+            case chunk_commit_data:
+                m_commit_data = m_data + offset;
+                commit_data_bytes = chunk_size;
+                break;
+            case chunk_extra_edges:
+                m_extra_edges = m_data + offset;
+                m_extra_edges_count = chunk_size / 4;
+                break;
+        }
+    }
+
+    if (!m_fanout || !m_oid_lookup || !m_commit_data || oid_lookup_size < size() * hash_size
+        || commit_data_bytes < size() * commit_data_size)
+    {
+        throw corrupt_graph();
+    }
+}
+
+commit_graph::~commit_graph()
+{
+    munmap(const_cast<unsigned char*>(m_data), m_size);
+}
+
+size_t commit_graph::size() const
+{
+    return read_be32(m_fanout + 255 * 4);
+}
+
+std::optional<uint32_t> commit_graph::find(const git_oid& oid) const
+{
+    const unsigned char first_byte = oid.id[0];
+    uint32_t low = first_byte == 0 ? 0 : read_be32(m_fanout + (first_byte - 1) * 4);
+    uint32_t high = std::min<uint32_t>(read_be32(m_fanout + first_byte * 4), size());
+
+    while (low < high)
+    {
+        const uint32_t middle = low + (high - low) / 2;
+        const int cmp = std::memcmp(m_oid_lookup + middle * hash_size, oid.id, hash_size);
+        if (cmp == 0)
+        {
+            return middle;
+        }
+        else if (cmp < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return std::nullopt;
+}
+
+git_oid commit_graph::oid(uint32_t pos) const
+{
+    if (pos >= size())
+    {
+        throw corrupt_graph();
+    }
+    git_oid oid;
+    git_oid_fromraw(&oid, m_oid_lookup + size_t(pos) * hash_size);
+    return oid;
+}
+
+git_oid commit_graph::tree_oid(uint32_t pos) const
+{
+    git_oid oid;
+    git_oid_fromraw(&oid, commit_data_at(pos));
+    return oid;
+}
+
+std::vector<uint32_t> commit_graph::parents(uint32_t pos) const
+{
+    const unsigned char* data = commit_data_at(pos);
+    std::vector<uint32_t> parents;
+
+    const uint32_t first_parent = read_be32(data + hash_size);
+    const uint32_t second_parent = read_be32(data + hash_size + 4);
+
+    // Parent positions come from the file, a corrupt one must not index past the commits.
+    const auto push_parent = [this, &parents](uint32_t parent)
+    {
+        if (parent >= size())
+        {
+            throw corrupt_graph();
+        }
+        parents.push_back(parent);
+    };
+
+    if (first_parent == parent_none)
+    {
+        return parents;
+    }
+    push_parent(first_parent);
+
+    if (second_parent == parent_none)
+    {
+        return parents;
+    }
+    if (!(second_parent & parent_octopus))
+    {
+        push_parent(second_parent);
+        return parents;
+    }
+
+    for (size_t edge = second_parent & ~parent_octopus;; ++edge)
+    {
+        if (edge >= m_extra_edges_count)
+        {
+            throw corrupt_graph();
+        }
+        const uint32_t value = read_be32(m_extra_edges + edge * 4);
+        push_parent(value & ~last_edge);
+        if (value & last_edge)
+        {
+            break;
+        }
+    }
+    return parents;
+}
+
+uint32_t commit_graph::generation(uint32_t pos) const
+{
+    return read_be32(commit_data_at(pos) + hash_size + 8) >> 2;
+}
+
+int64_t commit_graph::commit_time(uint32_t pos) const
+{
+    const unsigned char* data = commit_data_at(pos) + hash_size + 8;
+    return static_cast<int64_t>((uint64_t(read_be32(data) & 0x3) << 32) | read_be32(data + 4));
+}
+
+bool commit_graph::has_libgit2_chunks() const
+{
+    return m_libgit2_chunks;
+}
+
+std::string_view commit_graph::content() const
+{
+    return std::string_view(reinterpret_cast<const char*>(m_data), m_size);
+}
+
+const unsigned char* commit_graph::commit_data_at(uint32_t pos) const
+{
+    if (pos >= size())
+    {
+        throw corrupt_graph();
+    }
+    return m_commit_data + size_t(pos) * commit_data_size;
+}
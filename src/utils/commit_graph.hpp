@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <git2.h>
+
+#include "common.hpp"
+
+/**
+ * Reader of the git commit-graph file (objects/info/commit-graph), a table of the commits of a
+ * repository sorted by oid, holding for each of them its root tree, its parents, its commit date
+ * and its generation number. Writing the file is left to libgit2's commit-graph writer.
+ *
+ * libgit2 reads this file when it exists, so that revision walks (log, rev-list) and ahead/behind
+ * computations get the parents and dates of commits without inflating commit objects.
+ *
+ * Only single-file SHA-1 commit-graphs are handled, split commit-graph chains are ignored.
+ */
+class commit_graph : private noncopyable_nonmovable
+{
+public:
+
+    // Number of commits beyond which the generation number is not stored anymore.
+    static constexpr uint32_t generation_max = 0x3FFFFFFF;
+
+    // Write the commit-graph file of objects_info_dir with the commits of walk and their ancestors.
+    static void write(const std::string& objects_info_dir, git_revwalk* walk);
+
+    // Content of the file write would produce, without writing it.
+    static std::string dump(const std::string& objects_info_dir, git_revwalk* walk);
+
+    // Return nullptr if there is no commit-graph file at path. Throws if the file is invalid.
+    static std::unique_ptr<commit_graph> open(const std::string& path);
+
+    ~commit_graph();
+
+    size_t size() const;
+
+    // Position of the commit in the graph, if it is in it.
+    std::optional<uint32_t> find(const git_oid& oid) const;
+
+    // The accessors throw if pos, or a parent position read from the file, is out of range.
+    git_oid oid(uint32_t pos) const;
+    git_oid tree_oid(uint32_t pos) const;
+    std::vector<uint32_t> parents(uint32_t pos) const;
+    uint32_t generation(uint32_t pos) const;
+    int64_t commit_time(uint32_t pos) const;
+
+    // Whether the file only has the chunks libgit2 writes. git can add others, such as generation
+    // data or changed-path Bloom filters.
+    bool has_libgit2_chunks() const;
+
+    // Content of the file, trailing checksum included.
+    std::string_view content() const;
+
+private:
+
+    commit_graph(const unsigned char* data, size_t data_size);
+
+    const unsigned char* commit_data_at(uint32_t pos) const;
+
+    const unsigned char* m_data;
+    size_t m_size;
+    const unsigned char* m_fanout;
+    const unsigned char* m_oid_lookup;
+    const unsigned char* m_commit_data;
+    const unsigned char* m_extra_edges;
+    size_t m_extra_edges_count;
+    bool m_libgit2_chunks;
+};
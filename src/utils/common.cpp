@@ -1,12 +1,11 @@
 #include "common.hpp"
 
+#include <algorithm>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <map>
 #include <ranges>
 #include <regex>
-#include <sstream>
 
 #include <git2.h>
 #include <unistd.h>
@@ -16,6 +15,12 @@
 libgit2_object::libgit2_object()
 {
     git_libgit2_init();
+    // Partial clones are recorded by the partialclone repository extension, see promisor_remote.
+    const char* extensions[] = {"partialclone"};
+    git_libgit2_opts(GIT_OPT_SET_EXTENSIONS, extensions, size_t(1));
+    // libgit2 caches the commits and trees it parses, but not the trees of more than 4 KiB by
+    // default: the root trees of large repositories, looked up again by every walk over the history.
+    git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_TREE, size_t(1024 * 1024));
 }
 
 libgit2_object::~libgit2_object()
@@ -113,18 +118,6 @@ size_t git_strarray_wrapper::size()
     return m_patterns.size();
 }
 
-std::string read_file(const std::string& path)
-{
-    std::ifstream file(path, std::ios::binary);
-    if (!file)
-    {
-        throw git_exception("error: Could not access " + path, git2cpp_error_code::GENERIC_ERROR);
-    }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-
 std::vector<std::string> split_input_at_newlines(std::string_view str)
 {
     auto split = str | std::ranges::views::split('\n')
@@ -137,6 +130,13 @@ std::vector<std::string> split_input_at_newlines(std::string_view str)
     return std::vector<std::string>{split.begin(), split.end()};
 }
 
+bool is_binary_content(std::string_view content)
+{
+    constexpr size_t binary_check_size = 8000;
+    return !content.empty()
+           && std::memchr(content.data(), '\0', std::min(content.size(), binary_check_size)) != nullptr;
+}
+
 std::string trim(const std::string& str)
 {
     auto s = std::regex_replace(str, std::regex("^\\s+"), "");
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <git2.h>
@@ -40,6 +43,26 @@ status_messages get_status_msg(git_status_t);
 
 using stream_colour_fn = std::ostream& (*) (std::ostream&);
 
+// Hash and equality functors allowing git_oid to be used as a key of unordered containers.
+// Object ids are uniformly distributed, so their leading bytes make a good hash.
+struct git_oid_hash
+{
+    std::size_t operator()(const git_oid& oid) const noexcept
+    {
+        std::size_t hash;
+        std::memcpy(&hash, oid.id, sizeof(hash));
+        return hash;
+    }
+};
+
+struct git_oid_equal_to
+{
+    bool operator()(const git_oid& lhs, const git_oid& rhs) const noexcept
+    {
+        return git_oid_equal(&lhs, &rhs) != 0;
+    }
+};
+
 class git_strarray_wrapper
 {
 public:
@@ -73,9 +96,10 @@ private:
     void init_str_array();
 };
 
-std::string read_file(const std::string& path);
-
 std::vector<std::string> split_input_at_newlines(std::string_view str);
 
+// Same heuristic as git and libgit2: content is binary if it has a NUL byte in its first 8000 bytes.
+bool is_binary_content(std::string_view content);
+
 // Remove whitespace from start and end of a string.
 std::string trim(const std::string& str);
@@ -0,0 +1,724 @@
+#include "diff_stats.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "diff_stats_cache.hpp"
+#include "git_exception.hpp"
+#include "mapped_file.hpp"
+#include "trace.hpp"
+
+namespace
+{
+    // xdiff, the diff engine of libgit2, finds the minimal diff while the edit distance is below 256,
+    // its heuristics may then give other counts: larger edits are left to it.
+    constexpr size_t max_edit_distance = 256;
+
+    // Default max_size of git_diff_options, larger files are binary for libgit2.
+    constexpr git_object_size_t max_text_size = 512 * 1024 * 1024;
+
+    // The common head and tail are compared by blocks, then byte by byte in the first block that
+    // differs.
+    constexpr size_t compare_block_size = 4096;
+
+    // Options for which lines are not compared byte for byte, or the diff is not minimal.
+    constexpr uint32_t inexact_flags = GIT_DIFF_IGNORE_WHITESPACE | GIT_DIFF_IGNORE_WHITESPACE_CHANGE
+                                       | GIT_DIFF_IGNORE_WHITESPACE_EOL | GIT_DIFF_IGNORE_BLANK_LINES
+                                       | GIT_DIFF_PATIENCE;
+
+    // How the binary deltas are told apart from the text ones.
+    enum class binary_rule
+    {
+        content,
+        text,
+        binary
+    };
+
+    // Options changing the stats of a blob pair.
+    constexpr uint32_t cache_key_flags = inexact_flags | GIT_DIFF_FORCE_TEXT | GIT_DIFF_FORCE_BINARY
+                                         | GIT_DIFF_MINIMAL;
+
+    struct blob_deleter
+    {
+        void operator()(git_blob* blob) const
+        {
+            git_blob_free(blob);
+        }
+    };
+
+    struct patch_deleter
+    {
+        void operator()(git_patch* patch) const
+        {
+            git_patch_free(patch);
+        }
+    };
+
+    // Content of one side of a delta, from the object database or from the worktree.
+    class side_content
+    {
+    public:
+
+        // Return false if the content must go through libgit2 to be compared (filters, symbolic
+        // links, submodules, ...). An absent side is empty.
+        bool load(git_repository* repo, const git_diff_file& file)
+        {
+            if (file.mode == 0)
+            {
+                return true;
+            }
+            if (file.mode != GIT_FILEMODE_BLOB && file.mode != GIT_FILEMODE_BLOB_EXECUTABLE)
+            {
+                return false;
+            }
+
+            if (file.flags & GIT_DIFF_FLAG_VALID_ID)
+            {
+                git_blob* blob = nullptr;
+                if (git_blob_lookup(&blob, repo, &file.id) < 0)
+                {
+                    return false;
+                }
+                m_blob.reset(blob);
+                m_view = std::string_view(
+                    static_cast<const char*>(git_blob_rawcontent(blob)),
+                    static_cast<size_t>(git_blob_rawsize(blob))
+                );
+                return true;
+            }
+
+            // Worktree file not hashed by the diff, it can be read as is if no filter applies.
+            const char* workdir = git_repository_workdir(repo);
+            git_filter_list* filters = nullptr;
+            if (!workdir)
+            {
+                return false;
+            }
+            const int error = git_filter_list_load(
+                &filters,
+                repo,
+                nullptr,
+                file.path,
+                GIT_FILTER_TO_ODB,
+                GIT_FILTER_DEFAULT
+            );
+            if (error < 0)
+            {
+                return false;
+            }
+            if (filters)
+            {
+                git_filter_list_free(filters);
+                return false;
+            }
+            try
+            {
+                m_file.emplace(std::string(workdir) + file.path);
+            }
+            catch (const git_exception&)
+            {
+                return false;
+            }
+            m_view = m_file->view();
+            return true;
+        }
+
+        std::string_view view() const
+        {
+            return m_view;
+        }
+
+    private:
+
+        std::unique_ptr<git_blob, blob_deleter> m_blob;
+        std::optional<mapped_file> m_file;
+        std::string_view m_view;
+    };
+
+    size_t count_lines(std::string_view text)
+    {
+        size_t lines = 0;
+        const char* pos = text.data();
+        const char* end = pos + text.size();
+        while (pos != end && (pos = static_cast<const char*>(std::memchr(pos, '\n', size_t(end - pos)))))
+        {
+            ++lines;
+            ++pos;
+        }
+        return lines + (!text.empty() && text.back() != '\n' ? 1 : 0);
+    }
+
+    // Size of the common head of old_text and new_text, made of whole lines.
+    size_t common_head(std::string_view old_text, std::string_view new_text)
+    {
+        const size_t size = std::min(old_text.size(), new_text.size());
+        size_t n = 0;
+        while (n + compare_block_size <= size
+               && std::memcmp(old_text.data() + n, new_text.data() + n, compare_block_size) == 0)
+        {
+            n += compare_block_size;
+        }
+        while (n < size && old_text[n] == new_text[n])
+        {
+            ++n;
+        }
+
+        if (n == old_text.size() && n == new_text.size())
+        {
+            return n;
+        }
+        const size_t eol = n == 0 ? std::string_view::npos : old_text.rfind('\n', n - 1);
+        return eol == std::string_view::npos ? 0 : eol + 1;
+    }
+
+    // Size of the common tail of old_text and new_text, made of whole lines. Both texts start at the
+    // beginning of a line.
+    size_t common_tail(std::string_view old_text, std::string_view new_text)
+    {
+        const size_t size = std::min(old_text.size(), new_text.size());
+        const char* old_end = old_text.data() + old_text.size();
+        const char* new_end = new_text.data() + new_text.size();
+        size_t n = 0;
+        while (n + compare_block_size <= size)
+        {
+            const size_t start = n + compare_block_size;
+            if (std::memcmp(old_end - start, new_end - start, compare_block_size) != 0)
+            {
+                break;
+            }
+            n = start;
+        }
+        while (n < size && old_end[-ptrdiff_t(n) - 1] == new_end[-ptrdiff_t(n) - 1])
+        {
+            ++n;
+        }
+
+        const auto starts_line = [n](std::string_view text)
+        {
+            return n == text.size() || text[text.size() - n - 1] == '\n';
+        };
+        if (starts_line(old_text) && starts_line(new_text))
+        {
+            return n;
+        }
+        // Otherwise the tail starts after its first newline.
+        const std::string_view tail = old_text.substr(old_text.size() - n);
+        const size_t eol = tail.find('\n');
+        return eol == std::string_view::npos ? 0 : n - eol - 1;
+    }
+
+    std::vector<std::string_view> split_lines(std::string_view text)
+    {
+        std::vector<std::string_view> lines;
+        while (!text.empty())
+        {
+            const size_t eol = text.find('\n');
+            const size_t size = eol == std::string_view::npos ? text.size() : eol + 1;
+            lines.push_back(text.substr(0, size));
+            text.remove_prefix(size);
+        }
+        return lines;
+    }
+
+    // Edit distance (insertions plus deletions) between a and b with the greedy algorithm of Myers,
+    // nullopt if it is larger than max_distance.
+    std::optional<size_t>
+    edit_distance(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, size_t max_distance)
+    {
+        const ptrdiff_t n = ptrdiff_t(a.size());
+        const ptrdiff_t m = ptrdiff_t(b.size());
+        const ptrdiff_t max_d = std::min(ptrdiff_t(max_distance), n + m);
+        const ptrdiff_t offset = max_d + 1;
+        // Furthest x reached on each diagonal k = x - y.
+        std::vector<ptrdiff_t> furthest(size_t(2 * max_d + 3), 0);
+        for (ptrdiff_t d = 0; d <= max_d; ++d)
+        {
+            for (ptrdiff_t k = -d; k <= d; k += 2)
+            {
+                ptrdiff_t x = (k == -d || (k != d && furthest[offset + k - 1] < furthest[offset + k + 1]))
+                                  ? furthest[offset + k + 1]
+                                  : furthest[offset + k - 1] + 1;
+                ptrdiff_t y = x - k;
+                while (x < n && y < m && a[size_t(x)] == b[size_t(y)])
+                {
+                    ++x;
+                    ++y;
+                }
+                furthest[offset + k] = x;
+                if (x >= n && y >= m)
+                {
+                    return size_t(d);
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Lines inserted and deleted from old_text to new_text, nullopt if the edit is too large to be
+    // sure to count like libgit2.
+    std::optional<std::pair<size_t, size_t>>
+    count_changes(std::string_view old_text, std::string_view new_text)
+    {
+        const size_t head = common_head(old_text, new_text);
+        old_text.remove_prefix(head);
+        new_text.remove_prefix(head);
+        const size_t tail = common_tail(old_text, new_text);
+        old_text.remove_suffix(tail);
+        new_text.remove_suffix(tail);
+
+        const auto old_lines = split_lines(old_text);
+        const auto new_lines = split_lines(new_text);
+        if (old_lines.empty() || new_lines.empty())
+        {
+            return std::make_pair(new_lines.size(), old_lines.size());
+        }
+
+        // Equal lines get the same id, and the lines only present on one side are dropped since
+        // they cannot be common lines.
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::vector<uint32_t> old_ids;
+        std::vector<uint8_t> in_old;
+        old_ids.reserve(old_lines.size());
+        for (const auto& line : old_lines)
+        {
+            const auto [it, inserted] = ids.emplace(line, uint32_t(ids.size()));
+            old_ids.push_back(it->second);
+        }
+        std::vector<uint8_t> in_new(ids.size(), 0);
+        std::vector<uint32_t> new_ids;
+        new_ids.reserve(new_lines.size());
+        for (const auto& line : new_lines)
+        {
+            const auto it = ids.find(line);
+            if (it != ids.end())
+            {
+                in_new[it->second] = 1;
+                new_ids.push_back(it->second);
+            }
+        }
+        std::erase_if(
+            old_ids,
+            [&in_new](uint32_t id)
+            {
+                return !in_new[id];
+            }
+        );
+
+        const auto distance = edit_distance(old_ids, new_ids, max_edit_distance);
+        if (!distance)
+        {
+            return std::nullopt;
+        }
+        const size_t common = (old_ids.size() + new_ids.size() - *distance) / 2;
+        return std::make_pair(new_lines.size() - common, old_lines.size() - common);
+    }
+
+    // Same rules as libgit2: diff options first, then what is known of the delta, then the diff
+    // attribute, and the content last. A set diff attribute forces text as the text driver of libgit2
+    // does. nullopt when a custom diff driver decides.
+    std::optional<binary_rule>
+    binary_by_options(git_repository* repo, const git_diff_delta& delta, uint32_t flags)
+    {
+        if (flags & GIT_DIFF_FORCE_TEXT)
+        {
+            return binary_rule::text;
+        }
+        if ((flags & GIT_DIFF_FORCE_BINARY) || (delta.flags & GIT_DIFF_FLAG_BINARY))
+        {
+            return binary_rule::binary;
+        }
+        if (delta.flags & GIT_DIFF_FLAG_NOT_BINARY)
+        {
+            return binary_rule::text;
+        }
+
+        const char* value = nullptr;
+        const char* path = delta.new_file.path ? delta.new_file.path : delta.old_file.path;
+        if (git_attr_get(&value, repo, GIT_ATTR_CHECK_FILE_THEN_INDEX, path, "diff") < 0)
+        {
+            return std::nullopt;
+        }
+        if (GIT_ATTR_IS_FALSE(value))
+        {
+            return binary_rule::binary;
+        }
+        if (GIT_ATTR_IS_TRUE(value))
+        {
+            return binary_rule::text;
+        }
+        if (GIT_ATTR_IS_UNSPECIFIED(value))
+        {
+            return binary_rule::content;
+        }
+        return std::nullopt;
+    }
+
+    bool is_countable(const git_diff_delta& delta)
+    {
+        return delta.status == GIT_DELTA_ADDED || delta.status == GIT_DELTA_DELETED
+               || delta.status == GIT_DELTA_MODIFIED;
+    }
+
+    // Blob pairs only, the content of the worktree may change without its id being known.
+    std::optional<diff_stats_cache::key>
+    make_cache_key(const git_diff_delta& delta, uint32_t flags, binary_rule rule)
+    {
+        const auto is_blob = [](const git_diff_file& file)
+        {
+            return file.mode == 0
+                   || ((file.mode == GIT_FILEMODE_BLOB || file.mode == GIT_FILEMODE_BLOB_EXECUTABLE)
+                       && (file.flags & GIT_DIFF_FLAG_VALID_ID));
+        };
+        if (!is_blob(delta.old_file) || !is_blob(delta.new_file))
+        {
+            return std::nullopt;
+        }
+        uint32_t key_flags = flags & cache_key_flags;
+        if (rule == binary_rule::text)
+        {
+            key_flags |= GIT_DIFF_FORCE_TEXT;
+        }
+        else if (rule == binary_rule::binary)
+        {
+            key_flags |= GIT_DIFF_FORCE_BINARY;
+        }
+        return diff_stats_cache::key{delta.old_file.id, delta.new_file.id, key_flags};
+    }
+
+    std::optional<diff_stats::file_stats>
+    count_delta(git_repository* repo, const git_diff_delta& delta, binary_rule rule)
+    {
+        side_content old_content;
+        side_content new_content;
+        if (!old_content.load(repo, delta.old_file) || !new_content.load(repo, delta.new_file))
+        {
+            return std::nullopt;
+        }
+
+        diff_stats::file_stats stats;
+        stats.old_size = old_content.view().size();
+        stats.new_size = new_content.view().size();
+        stats.binary = rule == binary_rule::binary
+                       || (rule == binary_rule::content
+                           && (stats.old_size > max_text_size || stats.new_size > max_text_size
+                               || is_binary_content(old_content.view())
+                               || is_binary_content(new_content.view())));
+        if (stats.binary)
+        {
+            return stats;
+        }
+
+        if (delta.status == GIT_DELTA_ADDED)
+        {
+            stats.insertions = count_lines(new_content.view());
+        }
+        else if (delta.status == GIT_DELTA_DELETED)
+        {
+            stats.deletions = count_lines(old_content.view());
+        }
+        else
+        {
+            const auto changes = count_changes(old_content.view(), new_content.view());
+            if (!changes)
+            {
+                return std::nullopt;
+            }
+            std::tie(stats.insertions, stats.deletions) = *changes;
+        }
+        return stats;
+    }
+
+    diff_stats::file_stats count_delta_with_patch(git_diff* diff, size_t index)
+    {
+        git_patch* raw_patch = nullptr;
+        throw_if_error(git_patch_from_diff(&raw_patch, diff, index));
+        std::unique_ptr<git_patch, patch_deleter> patch(raw_patch);
+
+        diff_stats::file_stats stats;
+        const git_diff_delta* delta = git_diff_get_delta(diff, index);
+        if (patch)
+        {
+            throw_if_error(git_patch_line_stats(nullptr, &stats.insertions, &stats.deletions, patch.get()));
+            delta = git_patch_get_delta(patch.get());
+        }
+        stats.binary = (delta->flags & GIT_DIFF_FLAG_BINARY) != 0;
+        stats.old_size = delta->old_file.size;
+        stats.new_size = delta->new_file.size;
+        return stats;
+    }
+
+    size_t digits_for_value(size_t value)
+    {
+        size_t count = 1;
+        for (size_t place = 10; value >= place; place *= 10)
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    // Length of the leading directories old_path and new_path have in common, with the last slash.
+    size_t common_dir_length(std::string_view old_path, std::string_view new_path)
+    {
+        size_t length = 0;
+        for (size_t i = 0; i < old_path.size() && i < new_path.size(); ++i)
+        {
+            if (old_path[i] != new_path[i])
+            {
+                break;
+            }
+            if (old_path[i] == '/')
+            {
+                length = i + 1;
+            }
+        }
+        return length;
+    }
+
+    std::string_view plural(size_t count)
+    {
+        return count == 1 ? "" : "s";
+    }
+
+    const char* const rename_separator = " => ";
+}
+
+diff_stats::diff_stats(git_diff* diff, git_repository* repo, uint32_t diff_flags, diff_stats_cache* cache)
+    : m_diff(diff)
+{
+    trace::scoped_timer timer("diff stats");
+
+    const bool exact = repo && !(diff_flags & inexact_flags);
+    const size_t count = git_diff_num_deltas(diff);
+    m_files.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const git_diff_delta* delta = git_diff_get_delta(diff, i);
+        // How the delta is known to be binary according to the options and attributes, nullopt when
+        // the delta can only be counted by libgit2.
+        std::optional<binary_rule> rule;
+        if (repo && is_countable(*delta))
+        {
+            rule = binary_by_options(repo, *delta, diff_flags);
+        }
+
+        std::optional<file_stats> stats;
+        std::optional<diff_stats_cache::key> cache_key;
+        if (cache && rule)
+        {
+            cache_key = make_cache_key(*delta, diff_flags, *rule);
+        }
+        if (cache_key)
+        {
+            stats = cache->find(*cache_key);
+        }
+        const bool cached = stats.has_value();
+
+        if (!stats && exact && rule)
+        {
+            stats = count_delta(repo, *delta, *rule);
+        }
+        if (!stats)
+        {
+            trace::add("diff stats patches");
+            stats = count_delta_with_patch(diff, i);
+        }
+        if (cache_key && !cached)
+        {
+            cache->insert(*cache_key, *stats);
+        }
+        m_files.push_back(*stats);
+
+        size_t name_length = std::strlen(delta->new_file.path);
+        if (delta->old_file.path && std::strcmp(delta->old_file.path, delta->new_file.path) != 0)
+        {
+            name_length += std::strlen(delta->old_file.path);
+            ++m_renames;
+        }
+        m_insertions += stats->insertions;
+        m_deletions += stats->deletions;
+        m_max_name = std::max(m_max_name, name_length);
+        m_max_filestat = std::max(m_max_filestat, stats->insertions + stats->deletions);
+    }
+    m_max_digits = digits_for_value(m_max_filestat + 1);
+}
+
+const diff_stats::file_stats& diff_stats::file(size_t index) const
+{
+    return m_files[index];
+}
+
+size_t diff_stats::insertions() const
+{
+    return m_insertions;
+}
+
+size_t diff_stats::deletions() const
+{
+    return m_deletions;
+}
+
+std::string diff_stats::to_string(git_diff_stats_format_t format, size_t width) const
+{
+    std::string out;
+
+    if (format & GIT_DIFF_STATS_NUMBER)
+    {
+        for (size_t i = 0; i < m_files.size(); ++i)
+        {
+            const file_stats& stats = m_files[i];
+            std::string insertions = stats.binary ? "-" : std::to_string(stats.insertions);
+            std::string deletions = stats.binary ? "-" : std::to_string(stats.deletions);
+            insertions.resize(std::max<size_t>(insertions.size(), 8), ' ');
+            deletions.resize(std::max<size_t>(deletions.size(), 8), ' ');
+            out.append(insertions).append(deletions).append(git_diff_get_delta(m_diff, i)->new_file.path);
+            out.push_back('\n');
+        }
+    }
+
+    if (format & GIT_DIFF_STATS_FULL)
+    {
+        if (width > 0)
+        {
+            // Room left for the graph, with at least 7 columns.
+            constexpr size_t min_scale = 7;
+            if (width > m_max_name + m_max_digits + 5)
+            {
+                width -= m_max_name + m_max_digits + 5;
+            }
+            width = std::max(width, min_scale);
+        }
+        if (width > m_max_filestat)
+        {
+            width = 0;
+        }
+        for (size_t i = 0; i < m_files.size(); ++i)
+        {
+            append_full(out, i, width);
+        }
+    }
+
+    if (format & (GIT_DIFF_STATS_FULL | GIT_DIFF_STATS_SHORT))
+    {
+        out += " " + std::to_string(m_files.size()) + " file";
+        out.append(plural(m_files.size())).append(" changed");
+        if (m_insertions || m_deletions == 0)
+        {
+            out += ", " + std::to_string(m_insertions) + " insertion";
+            out.append(plural(m_insertions)).append("(+)");
+        }
+        if (m_deletions || m_insertions == 0)
+        {
+            out += ", " + std::to_string(m_deletions) + " deletion";
+            out.append(plural(m_deletions)).append("(-)");
+        }
+        out.push_back('\n');
+    }
+
+    if (format & GIT_DIFF_STATS_INCLUDE_SUMMARY)
+    {
+        char line[64];
+        for (size_t i = 0; i < m_files.size(); ++i)
+        {
+            const git_diff_delta* delta = git_diff_get_delta(m_diff, i);
+            if (delta->old_file.mode == delta->new_file.mode)
+            {
+                continue;
+            }
+            if (delta->old_file.mode == 0)
+            {
+                std::snprintf(line, sizeof(line), " create mode %06o ", delta->new_file.mode);
+                out.append(line).append(delta->new_file.path);
+            }
+            else if (delta->new_file.mode == 0)
+            {
+                std::snprintf(line, sizeof(line), " delete mode %06o ", delta->old_file.mode);
+                out.append(line).append(delta->old_file.path);
+            }
+            else
+            {
+                std::snprintf(
+                    line,
+                    sizeof(line),
+                    " mode change %06o => %06o ",
+                    delta->old_file.mode,
+                    delta->new_file.mode
+                );
+                out.append(line).append(delta->new_file.path);
+            }
+            out.push_back('\n');
+        }
+    }
+
+    return out;
+}
+
+void diff_stats::append_full(std::string& out, size_t index, size_t width) const
+{
+    const git_diff_delta* delta = git_diff_get_delta(m_diff, index);
+    const file_stats& stats = m_files[index];
+    const std::string_view old_path = delta->old_file.path ? delta->old_file.path : "";
+    const std::string_view new_path = delta->new_file.path ? delta->new_file.path : "";
+
+    size_t padding;
+    out.push_back(' ');
+    if (!old_path.empty() && !new_path.empty() && old_path != new_path)
+    {
+        padding = m_max_name - old_path.size() - new_path.size();
+        const size_t common = common_dir_length(old_path, new_path);
+        if (common)
+        {
+            out.append(old_path.substr(0, common)).append("{").append(old_path.substr(common));
+            out.append(rename_separator).append(new_path.substr(common)).append("}");
+        }
+        else
+        {
+            out.append(old_path).append(rename_separator).append(new_path);
+        }
+    }
+    else
+    {
+        const std::string_view path = new_path.empty() ? old_path : new_path;
+        out.append(path);
+        padding = m_max_name - path.size();
+        if (m_renames > 0)
+        {
+            padding += std::strlen(rename_separator);
+        }
+    }
+    out.append(padding, ' ').append(" | ");
+
+    if (stats.binary)
+    {
+        out += "Bin " + std::to_string(stats.old_size) + " -> " + std::to_string(stats.new_size) + " bytes\n";
+        return;
+    }
+
+    const std::string total = std::to_string(stats.insertions + stats.deletions);
+    out.append(m_max_digits > total.size() ? m_max_digits - total.size() : 0, ' ').append(total);
+    if (stats.insertions || stats.deletions)
+    {
+        out.push_back(' ');
+        if (width == 0)
+        {
+            out.append(stats.insertions, '+').append(stats.deletions, '-');
+        }
+        else
+        {
+            const size_t changes = stats.insertions + stats.deletions;
+            const size_t full = (changes * width + m_max_filestat / 2) / m_max_filestat;
+            const size_t plus = full * stats.insertions / changes;
+            const size_t minus = full - plus;
+            out.append(std::max<size_t>(plus, 1), '+').append(std::max<size_t>(minus, 1), '-');
+        }
+    }
+    out.push_back('\n');
+}
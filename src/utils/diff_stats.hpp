@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <git2.h>
+
+class diff_stats_cache;
+
+/**
+ * Line statistics of a diff, behind --stat, --shortstat, --numstat and --summary, formatted like
+ * git_diff_stats_to_buf.
+ *
+ * libgit2 generates the complete patch of every delta only to count its lines. Here the lines of
+ * added and deleted files are counted with a newline scan, and modified files are compared after
+ * their common head and tail have been skipped with memcmp, so only the changed region is split into
+ * lines, and no hunk nor line is built. The deltas that cannot be counted exactly this way (worktree
+ * content going through filters, submodules, custom diff drivers, whitespace options, large
+ * rewrites, ...) are left to libgit2.
+ */
+class diff_stats
+{
+public:
+
+    struct file_stats
+    {
+        size_t insertions = 0;
+        size_t deletions = 0;
+        bool binary = false;
+        git_object_size_t old_size = 0;
+        git_object_size_t new_size = 0;
+    };
+
+    // repo is null for a diff that does not come from a repository (parsed from a patch), in which
+    // case libgit2 counts every delta. diff_flags are the git_diff_option_t the diff was made with.
+    // The stats of blob pairs are looked up in the cache, if any, and added to it.
+    diff_stats(git_diff* diff, git_repository* repo, uint32_t diff_flags, diff_stats_cache* cache = nullptr);
+
+    const file_stats& file(size_t index) const;
+    size_t insertions() const;
+    size_t deletions() const;
+
+    std::string to_string(git_diff_stats_format_t format, size_t width) const;
+
+private:
+
+    void append_full(std::string& out, size_t index, size_t width) const;
+
+    git_diff* m_diff;
+    std::vector<file_stats> m_files;
+    size_t m_insertions = 0;
+    size_t m_deletions = 0;
+    size_t m_renames = 0;
+    size_t m_max_name = 0;
+    size_t m_max_filestat = 0;
+    size_t m_max_digits = 0;
+};
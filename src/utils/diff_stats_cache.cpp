@@ -0,0 +1,151 @@
+#include "diff_stats_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "trace.hpp"
+
+static constexpr const char* cache_signature = "git2cpp diff stats cache 1";
+
+namespace
+{
+    // Fixed size records, in the byte order of the machine since the cache is local.
+    struct record
+    {
+        git_oid old_id;
+        git_oid new_id;
+        uint32_t flags;
+        uint32_t binary;
+        uint64_t insertions;
+        uint64_t deletions;
+        uint64_t old_size;
+        uint64_t new_size;
+        uint64_t last_use;
+    };
+}
+
+size_t diff_stats_cache::key_hash::operator()(const key& k) const noexcept
+{
+    const git_oid_hash hash;
+    return hash(k.old_id) ^ (hash(k.new_id) * 31) ^ k.flags;
+}
+
+bool diff_stats_cache::key_equal_to::operator()(const key& lhs, const key& rhs) const noexcept
+{
+    const git_oid_equal_to equal;
+    return lhs.flags == rhs.flags && equal(lhs.old_id, rhs.old_id) && equal(lhs.new_id, rhs.new_id);
+}
+
+diff_stats_cache::diff_stats_cache(const std::string& git_dir, size_t byte_limit)
+    : m_path((std::filesystem::path(git_dir) / "git2cpp" / "diff-stats-cache").string())
+    , m_byte_limit(byte_limit)
+{
+    // A missing or truncated cache is not an error, the stats are just computed again.
+    std::ifstream file(m_path, std::ios::binary);
+    std::string line;
+    uint64_t generation = 0;
+    if (!std::getline(file, line) || line != cache_signature || !(file >> generation) || file.get() != '\n')
+    {
+        return;
+    }
+    m_generation = generation + 1;
+
+    record r;
+    while (file.read(reinterpret_cast<char*>(&r), sizeof(r)))
+    {
+        diff_stats::file_stats stats;
+        stats.insertions = r.insertions;
+        stats.deletions = r.deletions;
+        stats.binary = r.binary != 0;
+        stats.old_size = r.old_size;
+        stats.new_size = r.new_size;
+        m_entries.emplace(key{r.old_id, r.new_id, r.flags}, entry{stats, r.last_use});
+    }
+}
+
+std::optional<diff_stats::file_stats> diff_stats_cache::find(const key& k)
+{
+    const auto it = m_entries.find(k);
+    if (it == m_entries.end())
+    {
+        return std::nullopt;
+    }
+    trace::add("diff stats cache hits");
+    if (it->second.last_use != m_generation)
+    {
+        // The recency of the entry has to be stored for the eviction to drop the least recently used.
+        it->second.last_use = m_generation;
+        m_modified = true;
+    }
+    return it->second.stats;
+}
+
+void diff_stats_cache::insert(const key& k, const diff_stats::file_stats& stats)
+{
+    m_entries.insert_or_assign(k, entry{stats, m_generation});
+    m_modified = true;
+}
+
+void diff_stats_cache::store() const
+{
+    if (!m_modified)
+    {
+        return;
+    }
+
+    // The most recently used entries are kept.
+    std::vector<record> records;
+    records.reserve(m_entries.size());
+    for (const auto& [k, e] : m_entries)
+    {
+        records.push_back(
+            {k.old_id,
+             k.new_id,
+             k.flags,
+             e.stats.binary ? 1u : 0u,
+             e.stats.insertions,
+             e.stats.deletions,
+             e.stats.old_size,
+             e.stats.new_size,
+             e.last_use}
+        );
+    }
+    const size_t max_records = m_byte_limit / sizeof(record);
+    if (records.size() > max_records)
+    {
+        std::nth_element(
+            records.begin(),
+            records.begin() + ptrdiff_t(max_records),
+            records.end(),
+            [](const record& lhs, const record& rhs)
+            {
+                return lhs.last_use > rhs.last_use;
+            }
+        );
+        trace::add("diff stats cache evictions", records.size() - max_records);
+        records.resize(max_records);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), ec);
+    const std::string lock_path = m_path + ".lock";
+    {
+        std::ofstream file(lock_path, std::ios::binary | std::ios::trunc);
+        file << cache_signature << '\n' << m_generation << '\n';
+        file.write(
+            reinterpret_cast<const char*>(records.data()),
+            std::streamsize(records.size() * sizeof(record))
+        );
+
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(lock_path, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(lock_path, m_path, ec);
+}
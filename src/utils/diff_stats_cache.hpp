@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include <git2.h>
+
+#include "common.hpp"
+#include "diff_stats.hpp"
+
+/**
+ * Line statistics of blob pairs computed by previous commands, stored in the git directory
+ * (git2cpp/diff-stats-cache). Entries are keyed by the ids of the two blobs (null for an added or
+ * deleted file) and the diff options changing the counts. Blobs are immutable, so an entry never
+ * becomes stale.
+ *
+ * The file is kept under a byte limit (git2cpp.diffCacheLimit config entry) by dropping the entries
+ * that were used the longest time ago, in number of commands. A limit of 0 disables the cache.
+ */
+class diff_stats_cache : private noncopyable_nonmovable
+{
+public:
+
+    static constexpr int64_t default_byte_limit = 4 * 1024 * 1024;
+
+    struct key
+    {
+        git_oid old_id;
+        git_oid new_id;
+        uint32_t flags;
+    };
+
+    diff_stats_cache(const std::string& git_dir, size_t byte_limit);
+
+    std::optional<diff_stats::file_stats> find(const key& k);
+    void insert(const key& k, const diff_stats::file_stats& stats);
+
+    // Write the cache if entries were added or found, so that the uses of the entries found are
+    // stored. The cache is only an optimization, it is not an error if it cannot be written.
+    void store() const;
+
+private:
+
+    struct key_hash
+    {
+        size_t operator()(const key& k) const noexcept;
+    };
+
+    struct key_equal_to
+    {
+        bool operator()(const key& lhs, const key& rhs) const noexcept;
+    };
+
+    struct entry
+    {
+        diff_stats::file_stats stats;
+        uint64_t last_use;
+    };
+
+    std::string m_path;
+    size_t m_byte_limit;
+    uint64_t m_generation = 1;
+    bool m_modified = false;
+    std::unordered_map<key, entry, key_hash, key_equal_to> m_entries;
+};
@@ -0,0 +1,68 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "git_exception.hpp"
+
+mapped_file::mapped_file(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw git_exception("error: Could not access " + path, git2cpp_error_code::GENERIC_ERROR);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        throw git_exception("error: Could not access " + path, git2cpp_error_code::GENERIC_ERROR);
+    }
+
+    // Empty files cannot be mapped, and do not need to be.
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size > 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            throw git_exception("error: Could not map " + path, git2cpp_error_code::GENERIC_ERROR);
+        }
+        // The diff reads the content from start to end.
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+    if (m_data)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+
+const char* mapped_file::data() const
+{
+    return m_data;
+}
+
+size_t mapped_file::size() const
+{
+    return m_size;
+}
+
+std::string_view mapped_file::view() const
+{
+    return std::string_view(m_data, m_size);
+}
+
+bool mapped_file::is_binary() const
+{
+    return is_binary_content(view());
+}
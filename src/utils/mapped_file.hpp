@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "common.hpp"
+
+/**
+ * Read-only memory mapping of a whole file. The pages are backed by the file itself, so mapping a
+ * large file neither copies it nor counts it against the memory of the process until it is read,
+ * and the kernel can drop the pages already read.
+ */
+class mapped_file : private noncopyable_nonmovable
+{
+public:
+
+    // Throws a git_exception if the file cannot be opened or mapped.
+    explicit mapped_file(const std::string& path);
+    ~mapped_file();
+
+    const char* data() const;
+    size_t size() const;
+    std::string_view view() const;
+
+    // See is_binary_content.
+    bool is_binary() const;
+
+private:
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
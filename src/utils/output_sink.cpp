@@ -0,0 +1,113 @@
+#include "output_sink.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <termcolor/termcolor.hpp>
+
+#include "trace.hpp"
+
+output_sink::output_sink(std::ostream& stream, size_t capacity)
+    : output_sink(stream, capacity, &stream == &std::cout && isatty(fileno(stdout)))
+{
+}
+
+output_sink::output_sink(std::ostream& stream, size_t capacity, bool colourize)
+    : m_stream(stream)
+    , m_capacity(capacity)
+    , m_colourize(colourize)
+{
+    m_buffer.reserve(capacity);
+}
+
+output_sink::~output_sink()
+{
+    flush();
+}
+
+output_sink& output_sink::operator<<(std::string_view str)
+{
+    if (m_buffer.size() + str.size() > m_capacity)
+    {
+        write_buffered();
+    }
+    if (str.size() >= m_capacity)
+    {
+        m_stream.write(str.data(), std::streamsize(str.size()));
+        trace::add("output bytes", str.size());
+    }
+    else
+    {
+        m_buffer.append(str);
+    }
+    return *this;
+}
+
+output_sink& output_sink::operator<<(char c)
+{
+    if (m_buffer.size() == m_capacity)
+    {
+        write_buffered();
+    }
+    m_buffer.push_back(c);
+    return *this;
+}
+
+output_sink& output_sink::operator<<(stream_colour_fn colour)
+{
+    if (!m_colourize)
+    {
+        return *this;
+    }
+
+    // Only a handful of colours are used by a command, a linear search is the fastest.
+    for (const auto& [fn, escape] : m_colour_escapes)
+    {
+        if (fn == colour)
+        {
+            return *this << std::string_view(escape);
+        }
+    }
+
+    std::ostringstream colour_stream;
+    colour_stream << termcolor::colorize;
+    colour(colour_stream);
+    const auto& entry = m_colour_escapes.emplace_back(colour, std::move(colour_stream).str());
+    return *this << std::string_view(entry.second);
+}
+
+output_sink& output_sink::write_coloured(stream_colour_fn colour, std::string_view text)
+{
+    if (!m_colourize)
+    {
+        return *this << text;
+    }
+    return *this << colour << text << termcolor::reset;
+}
+
+bool output_sink::colourize() const
+{
+    return m_colourize;
+}
+
+output_sink& output_sink::write_oid(const git_oid& oid)
+{
+    char buf[GIT_OID_SHA1_HEXSIZE];
+    git_oid_fmt(buf, &oid);
+    return *this << std::string_view(buf, sizeof(buf));
+}
+
+void output_sink::write_buffered()
+{
+    trace::add("output bytes", m_buffer.size());
+    m_stream.write(m_buffer.data(), std::streamsize(m_buffer.size()));
+    m_buffer.clear();
+}
+
+void output_sink::flush()
+{
+    write_buffered();
+    m_stream.flush();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <git2.h>
+
+#include "common.hpp"
+
+/**
+ * Block-buffered writer to an output stream (cout by default), used by the subcommands that can
+ * produce a lot of output. Unlike std::endl, a '\n' does not flush: the buffer is only written to
+ * the stream when it is full, when write_buffered() or flush() is called and on destruction. Output
+ * redirected to a file or a pipe is then written with a few large writes instead of one per line.
+ *
+ * Nothing should be written directly to the stream while a sink holds buffered data, or the output
+ * would be reordered.
+ */
+class output_sink : private noncopyable_nonmovable
+{
+public:
+
+    static constexpr size_t default_capacity = 64 * 1024;
+
+    explicit output_sink(std::ostream& stream = std::cout, size_t capacity = default_capacity);
+
+    // Write the colours or not whatever the stream is, for instance to format output in a buffer
+    // that is later written to another sink.
+    output_sink(std::ostream& stream, size_t capacity, bool colourize);
+
+    ~output_sink();
+
+    output_sink& operator<<(std::string_view str);
+    output_sink& operator<<(char c);
+
+    template <std::integral T>
+    output_sink& operator<<(T value);
+
+    // Colour manipulator such as termcolor::red, only written if the stream is a terminal (same
+    // rule as termcolor itself). The escape sequence of each manipulator is computed once.
+    output_sink& operator<<(stream_colour_fn colour);
+
+    // Write text in the given colour, followed by a reset if colours are written.
+    output_sink& write_coloured(stream_colour_fn colour, std::string_view text);
+
+    bool colourize() const;
+
+    // Hexadecimal form of oid.
+    output_sink& write_oid(const git_oid& oid);
+
+    // Write the buffered output to the stream without flushing the stream, for instance before the
+    // stream is redirected.
+    void write_buffered();
+
+    // Write the buffered output to the stream and flush it. Only needed for interactive output,
+    // such as progress reports, as it is done on destruction.
+    void flush();
+
+private:
+
+    std::ostream& m_stream;
+    std::string m_buffer;
+    size_t m_capacity;
+    bool m_colourize;
+    std::vector<std::pair<stream_colour_fn, std::string>> m_colour_escapes;
+};
+
+template <std::integral T>
+output_sink& output_sink::operator<<(T value)
+{
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    return *this << std::string_view(buf, size_t(res.ptr - buf));
+}
@@ -0,0 +1,84 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+#ifndef EMSCRIPTEN
+#    include <thread>
+#endif
+
+size_t resolve_thread_count(int configured)
+{
+#ifdef EMSCRIPTEN
+    (void) configured;
+    return 1;
+#else
+    if (configured < 1)
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+    return static_cast<size_t>(configured);
+#endif
+}
+
+void parallel_for(size_t count, size_t thread_count, const std::function<void(size_t, size_t)>& fn)
+{
+#ifdef EMSCRIPTEN
+    thread_count = 1;
+#endif
+    thread_count = std::min(thread_count, count);
+    if (thread_count <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            fn(i, 0);
+        }
+        return;
+    }
+
+#ifndef EMSCRIPTEN
+    std::atomic<size_t> next_index = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr first_exception;
+    std::mutex exception_mutex;
+
+    const auto worker = [&](size_t worker_index)
+    {
+        for (size_t i = next_index++; i < count && !failed; i = next_index++)
+        {
+            try
+            {
+                fn(i, worker_index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!failed.exchange(true))
+                {
+                    first_exception = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i)
+    {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (first_exception)
+    {
+        std::rethrow_exception(first_exception);
+    }
+#endif
+}
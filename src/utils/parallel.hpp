@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// Number of worker threads for a configured value, where values less than 1 mean one thread per
+// logical core. Always 1 when built without thread support (EMSCRIPTEN).
+size_t resolve_thread_count(int configured);
+
+// Call fn(index, worker) for every index in [0, count) using up to thread_count threads, the calling
+// thread included as worker 0. worker is the index of the thread in [0, thread_count), so that
+// per-thread resources can be kept between calls. Indices are handed out in increasing order. If
+// fn throws, no new index is started and the first exception is rethrown once all the threads have
+// stopped.
+void parallel_for(size_t count, size_t thread_count, const std::function<void(size_t, size_t)>& fn);
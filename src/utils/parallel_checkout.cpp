@@ -0,0 +1,487 @@
+#include "parallel_checkout.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "git_exception.hpp"
+#include "parallel.hpp"
+#include "sparse_checkout.hpp"
+#include "stat_cache.hpp"
+#include "trace.hpp"
+
+namespace
+{
+    struct object_deleter
+    {
+        void operator()(git_object* object) const
+        {
+            git_object_free(object);
+        }
+    };
+
+    struct index_deleter
+    {
+        void operator()(git_index* index) const
+        {
+            git_index_free(index);
+        }
+    };
+
+    struct diff_deleter
+    {
+        void operator()(git_diff* diff) const
+        {
+            git_diff_free(diff);
+        }
+    };
+
+    struct blob_deleter
+    {
+        void operator()(git_blob* blob) const
+        {
+            git_blob_free(blob);
+        }
+    };
+
+    struct filter_list_deleter
+    {
+        void operator()(git_filter_list* filters) const
+        {
+            git_filter_list_free(filters);
+        }
+    };
+
+    struct repository_deleter
+    {
+        void operator()(git_repository* repo) const
+        {
+            git_repository_free(repo);
+        }
+    };
+
+    struct planned_write
+    {
+        std::string path;
+        git_oid id;
+        uint32_t mode;
+    };
+
+    git_index_time index_time(const struct timespec& time)
+    {
+        return {static_cast<int32_t>(time.tv_sec), static_cast<uint32_t>(time.tv_nsec)};
+    }
+
+    git_index_entry make_index_entry(const planned_write& write, const struct stat& st)
+    {
+        git_index_entry entry = {};
+#ifdef __APPLE__
+        entry.ctime = index_time(st.st_ctimespec);
+        entry.mtime = index_time(st.st_mtimespec);
+#else
+        entry.ctime = index_time(st.st_ctim);
+        entry.mtime = index_time(st.st_mtim);
+#endif
+        entry.dev = static_cast<uint32_t>(st.st_dev);
+        entry.ino = static_cast<uint32_t>(st.st_ino);
+        entry.uid = static_cast<uint32_t>(st.st_uid);
+        entry.gid = static_cast<uint32_t>(st.st_gid);
+        entry.file_size = static_cast<uint32_t>(st.st_size);
+        entry.mode = write.mode;
+        entry.id = write.id;
+        entry.path = write.path.c_str();
+        return entry;
+    }
+
+    bool config_bool(git_config* config, const char* name, bool default_value)
+    {
+        int value = 0;
+        return git_config_get_bool(&value, config, name) == 0 ? value != 0 : default_value;
+    }
+
+    bool has_supported_options(const git_checkout_options& opts)
+    {
+        return opts.checkout_strategy == GIT_CHECKOUT_SAFE && opts.paths.count == 0 && !opts.baseline
+               && !opts.baseline_index && !opts.target_directory && !opts.notify_cb && !opts.perfdata_cb
+               && opts.dir_mode == 0 && opts.file_mode == 0 && opts.file_open_flags == 0;
+    }
+
+    // Files whose checkout changes how the other ones are checked out or that are not plain files.
+    bool is_supported_file(const git_diff_file& file, bool symlinks)
+    {
+        if (file.mode == GIT_FILEMODE_COMMIT || (file.mode == GIT_FILEMODE_LINK && !symlinks))
+        {
+            return false;
+        }
+        const std::string_view path = file.path;
+        return path != ".gitattributes" && !path.ends_with("/.gitattributes");
+    }
+
+    bool matches_index(git_index* index, const git_diff_file& file)
+    {
+        const git_index_entry* entry = git_index_get_bypath(index, file.path, 0);
+        return entry && entry->mode == file.mode && git_oid_equal(&entry->id, &file.id);
+    }
+
+    std::string parent_directory(const std::string& path)
+    {
+        const size_t pos = path.rfind('/');
+        return pos == std::string::npos ? std::string() : path.substr(0, pos);
+    }
+
+    bool write_all(int fd, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t written = ::write(fd, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    void remove_file(const std::string& full_path, const std::string& path)
+    {
+        if (::unlink(full_path.c_str()) != 0 && errno != ENOENT)
+        {
+            throw git_exception("could not remove '" + path + "'", git2cpp_error_code::FILESYSTEM_ERROR);
+        }
+    }
+
+    // Write the blob of write to the worktree, through the filters of the repository (line endings,
+    // ident) for regular files, and return the stat data of the file.
+    struct stat
+    write_file(git_repository* repo, const std::string& workdir, const planned_write& write, bool filter)
+    {
+        git_blob* raw_blob = nullptr;
+        throw_if_error(git_blob_lookup(&raw_blob, repo, &write.id));
+        std::unique_ptr<git_blob, blob_deleter> blob(raw_blob);
+        const char* data = static_cast<const char*>(git_blob_rawcontent(blob.get()));
+        const size_t size = static_cast<size_t>(git_blob_rawsize(blob.get()));
+
+        const std::string full_path = workdir + write.path;
+        remove_file(full_path, write.path);
+        bool written = false;
+        if (write.mode == GIT_FILEMODE_LINK)
+        {
+            written = ::symlink(std::string(data, size).c_str(), full_path.c_str()) == 0;
+        }
+        else
+        {
+            git_filter_list* raw_filters = nullptr;
+            if (filter)
+            {
+                throw_if_error(git_filter_list_load(
+                    &raw_filters,
+                    repo,
+                    blob.get(),
+                    write.path.c_str(),
+                    GIT_FILTER_TO_WORKTREE,
+                    GIT_FILTER_DEFAULT
+                ));
+            }
+            std::unique_ptr<git_filter_list, filter_list_deleter> filters(raw_filters);
+            git_buf filtered = GIT_BUF_INIT;
+            if (filters)
+            {
+                throw_if_error(git_filter_list_apply_to_blob(&filtered, filters.get(), blob.get()));
+                data = filtered.ptr;
+            }
+
+            // The permissions are those of libgit2, the umask applies.
+            const int fd = ::open(
+                full_path.c_str(),
+                O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                write.mode == GIT_FILEMODE_BLOB_EXECUTABLE ? 0755 : 0644
+            );
+            if (fd >= 0)
+            {
+                written = write_all(fd, data, filters ? filtered.size : size);
+                written = ::close(fd) == 0 && written;
+            }
+            git_buf_dispose(&filtered);
+        }
+
+        struct stat st;
+        if (!written || ::lstat(full_path.c_str(), &st) != 0)
+        {
+            throw git_exception("could not write '" + write.path + "'", git2cpp_error_code::FILESYSTEM_ERROR);
+        }
+        return st;
+    }
+}
+
+bool parallel_checkout(
+    git_repository* repo,
+    const git_object* target,
+    const git_checkout_options& opts,
+    size_t thread_count,
+    const sparse_checkout* sparse
+)
+{
+    if (!has_supported_options(opts) || git_repository_is_bare(repo))
+    {
+        return false;
+    }
+
+    bool symlinks = true;
+    git_config* config = nullptr;
+    if (git_repository_config_snapshot(&config, repo) == 0)
+    {
+        const bool ignore_case = config_bool(config, "core.ignorecase", false);
+        symlinks = config_bool(config, "core.symlinks", true);
+        git_config_free(config);
+        if (ignore_case)
+        {
+            return false;
+        }
+    }
+
+    trace::scoped_timer timer("parallel checkout");
+
+    git_index* raw_index = nullptr;
+    throw_if_error(git_repository_index(&raw_index, repo));
+    std::unique_ptr<git_index, index_deleter> index(raw_index);
+    throw_if_error(git_index_read(index.get(), false));
+    if (git_index_has_conflicts(index.get()))
+    {
+        return false;
+    }
+
+    git_object* raw_object = nullptr;
+    throw_if_error(git_object_peel(&raw_object, target, GIT_OBJECT_TREE));
+    std::unique_ptr<git_object, object_deleter> new_tree(raw_object);
+
+    // Without an index file, every file of the target is checked out (libgit2 recreates the missing
+    // files of HEAD in that case).
+    std::unique_ptr<git_object, object_deleter> old_tree;
+    struct stat index_stat;
+    const char* index_path = git_index_path(index.get());
+    if (index_path && ::lstat(index_path, &index_stat) == 0)
+    {
+        if (git_repository_head_unborn(repo) != 0)
+        {
+            return false;
+        }
+        throw_if_error(git_revparse_single(&raw_object, repo, "HEAD^{tree}"));
+        old_tree.reset(raw_object);
+    }
+
+    git_diff* raw_diff = nullptr;
+    throw_if_error(git_diff_tree_to_tree(
+        &raw_diff,
+        repo,
+        reinterpret_cast<git_tree*>(old_tree.get()),
+        reinterpret_cast<git_tree*>(new_tree.get()),
+        nullptr
+    ));
+    std::unique_ptr<git_diff, diff_deleter> diff(raw_diff);
+
+    // Plan the removals and writes, giving up on any file libgit2 would refuse to overwrite. The
+    // entries of the files outside of the sparse checkout must already have the skip-worktree flag.
+    const auto is_included = [sparse](const char* path)
+    {
+        return !sparse || sparse->includes(path);
+    };
+    stat_cache stats(repo);
+    std::vector<std::string> removals;
+    std::vector<planned_write> writes;
+    std::vector<std::string> added_paths;
+    const size_t delta_count = git_diff_num_deltas(diff.get());
+    for (size_t i = 0; i < delta_count; ++i)
+    {
+        const git_diff_delta* delta = git_diff_get_delta(diff.get(), i);
+        switch (delta->status)
+        {
+            case GIT_DELTA_DELETED:
+            {
+                const auto state = stats.state(delta->old_file.path);
+                const bool unmodified = state == stat_cache::file_state::unmodified
+                                        || state == stat_cache::file_state::deleted;
+                if (!is_supported_file(delta->old_file, symlinks)
+                    || !matches_index(index.get(), delta->old_file) || !unmodified
+                    || stats.is_skipped(delta->old_file.path) == is_included(delta->old_file.path))
+                {
+                    return false;
+                }
+                removals.push_back(delta->old_file.path);
+                break;
+            }
+            case GIT_DELTA_MODIFIED:
+            {
+                if (!is_supported_file(delta->old_file, symlinks)
+                    || !is_supported_file(delta->new_file, symlinks)
+                    || !matches_index(index.get(), delta->old_file)
+                    || stats.state(delta->old_file.path) != stat_cache::file_state::unmodified
+                    || stats.is_skipped(delta->old_file.path) == is_included(delta->old_file.path))
+                {
+                    return false;
+                }
+                writes.push_back({delta->new_file.path, delta->new_file.id, delta->new_file.mode});
+                break;
+            }
+            case GIT_DELTA_ADDED:
+            {
+                if (!is_supported_file(delta->new_file, symlinks))
+                {
+                    return false;
+                }
+                writes.push_back({delta->new_file.path, delta->new_file.id, delta->new_file.mode});
+                added_paths.push_back(delta->new_file.path);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // The files outside of the sparse checkout, moved after the other ones, are only added to the
+    // index.
+    const auto skipped_begin = std::stable_partition(
+        writes.begin(),
+        writes.end(),
+        [&is_included](const planned_write& write)
+        {
+            return is_included(write.path.c_str());
+        }
+    );
+    const size_t write_count = static_cast<size_t>(skipped_begin - writes.begin());
+
+    // Added files and their directories must not replace anything that is not removed before.
+    const std::unordered_set<std::string> removed(removals.begin(), removals.end());
+    const auto is_free = [&](const std::string& path)
+    {
+        return removed.contains(path) || (!stats.is_tracked(path) && !stats.worktree_mode(path));
+    };
+    std::set<std::string> directories;
+    for (const auto& path : added_paths)
+    {
+        if (!is_free(path))
+        {
+            return false;
+        }
+        if (!is_included(path.c_str()))
+        {
+            continue;
+        }
+        for (std::string dir = parent_directory(path); !dir.empty(); dir = parent_directory(dir))
+        {
+            if (!directories.insert(dir).second)
+            {
+                break;
+            }
+            if (stats.worktree_mode(dir) != uint32_t(GIT_FILEMODE_TREE) && !is_free(dir))
+            {
+                return false;
+            }
+        }
+    }
+
+    const std::string workdir = git_repository_workdir(repo);
+    const size_t total = removals.size() + write_count;
+    size_t completed = 0;
+    std::mutex progress_mutex;
+    const auto report = [&](const char* path)
+    {
+        if (opts.progress_cb)
+        {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            opts.progress_cb(path, path ? ++completed : completed, total, opts.progress_payload);
+        }
+    };
+    report(nullptr);
+
+    // Removals, then the directories they leave empty, deepest first.
+    std::set<std::string, std::greater<>> emptied_directories;
+    for (const auto& path : removals)
+    {
+        remove_file(workdir + path, path);
+        throw_if_error(git_index_remove(index.get(), path.c_str(), 0));
+        for (std::string dir = parent_directory(path); !dir.empty(); dir = parent_directory(dir))
+        {
+            emptied_directories.insert(dir);
+        }
+        report(path.c_str());
+    }
+    for (const auto& dir : emptied_directories)
+    {
+        ::rmdir((workdir + dir).c_str());
+    }
+
+    // Parents come first in the lexicographic order.
+    for (const auto& dir : directories)
+    {
+        if (::mkdir((workdir + dir).c_str(), 0777) != 0 && errno != EEXIST)
+        {
+            throw git_exception(
+                "could not create directory '" + dir + "'",
+                git2cpp_error_code::FILESYSTEM_ERROR
+            );
+        }
+    }
+
+    // libgit2 repositories cannot be shared between threads, so each worker but the calling thread
+    // opens its own.
+    const std::string repo_path = git_repository_path(repo);
+    const bool filter = opts.disable_filters == 0;
+    std::vector<std::unique_ptr<git_repository, repository_deleter>> worker_repos(
+        std::max<size_t>(thread_count, 1)
+    );
+    std::vector<git_index_entry> entries(writes.size());
+    parallel_for(
+        write_count,
+        worker_repos.size(),
+        [&](size_t i, size_t worker)
+        {
+            git_repository* worker_repo = repo;
+            if (worker != 0)
+            {
+                auto& opened = worker_repos[worker];
+                if (!opened)
+                {
+                    git_repository* raw_repo = nullptr;
+                    throw_if_error(git_repository_open(&raw_repo, repo_path.c_str()));
+                    opened.reset(raw_repo);
+                }
+                worker_repo = opened.get();
+            }
+            const struct stat st = write_file(worker_repo, workdir, writes[i], filter);
+            entries[i] = make_index_entry(writes[i], st);
+            report(writes[i].path.c_str());
+        }
+    );
+    trace::add("checkout files written", write_count);
+    for (size_t i = write_count; i < writes.size(); ++i)
+    {
+        entries[i].mode = writes[i].mode;
+        entries[i].id = writes[i].id;
+        entries[i].path = writes[i].path.c_str();
+        entries[i].flags_extended = GIT_INDEX_ENTRY_SKIP_WORKTREE;
+    }
+
+    for (const auto& entry : entries)
+    {
+        throw_if_error(git_index_add(index.get(), &entry));
+    }
+    throw_if_error(git_index_write(index.get()));
+    return true;
+}
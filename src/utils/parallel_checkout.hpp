@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+#include <git2.h>
+
+class sparse_checkout;
+
+/**
+ * Check out the tree of target as git_checkout_tree does with a GIT_CHECKOUT_SAFE strategy, with the
+ * blobs inflated and the files written by up to thread_count threads.
+ *
+ * The file operations are planned first from the diff between the HEAD tree and the target tree
+ * (every file of the target when there is no index file yet, as after a clone): a deleted or changed
+ * file must be unmodified in the worktree and in the index, and an added file must not exist. The
+ * deleted files are then removed, the directories of the new files created parents first, the files
+ * written in parallel, and the index updated and written. The progress callback of opts is called
+ * once per file, like libgit2 does. With sparse, the files outside of its patterns are not written,
+ * their index entries get the skip-worktree flag.
+ *
+ * Returns false, without changing anything, when the checkout is not one that is handled here: other
+ * strategies or options, conflicts, a file that would be overwritten, submodules, .gitattributes
+ * changes, case-insensitive worktrees or links without core.symlinks. The caller then checks out with
+ * libgit2, which handles all of them.
+ */
+bool parallel_checkout(
+    git_repository* repo,
+    const git_object* target,
+    const git_checkout_options& opts,
+    size_t thread_count,
+    const sparse_checkout* sparse = nullptr
+);
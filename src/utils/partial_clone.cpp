@@ -0,0 +1,630 @@
+#include "partial_clone.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <unordered_set>
+#include <utility>
+
+#include <git2/sys/odb_backend.h>
+
+#include "git_exception.hpp"
+#include "sparse_checkout.hpp"
+#include "trace.hpp"
+
+namespace
+{
+    using oid_set = std::unordered_set<git_oid, git_oid_hash, git_oid_equal_to>;
+
+    struct config_deleter
+    {
+        void operator()(git_config* config) const
+        {
+            git_config_free(config);
+        }
+    };
+
+    struct packbuilder_deleter
+    {
+        void operator()(git_packbuilder* builder) const
+        {
+            git_packbuilder_free(builder);
+        }
+    };
+
+    struct reference_deleter
+    {
+        void operator()(git_reference* ref) const
+        {
+            git_reference_free(ref);
+        }
+    };
+
+    struct revwalk_deleter
+    {
+        void operator()(git_revwalk* walk) const
+        {
+            git_revwalk_free(walk);
+        }
+    };
+
+    struct tree_deleter
+    {
+        void operator()(git_tree* tree) const
+        {
+            git_tree_free(tree);
+        }
+    };
+
+    using reference_ptr = std::unique_ptr<git_reference, reference_deleter>;
+    using tree_ptr = std::unique_ptr<git_tree, tree_deleter>;
+
+    std::string local_path(std::string_view url)
+    {
+        constexpr std::string_view file_scheme = "file://";
+        if (url.starts_with(file_scheme))
+        {
+            url.remove_prefix(file_scheme.size());
+        }
+        return std::string(url);
+    }
+
+    tree_ptr lookup_tree(git_repository* repo, const git_oid& id)
+    {
+        git_tree* tree = nullptr;
+        throw_if_error(git_tree_lookup(&tree, repo, &id));
+        return tree_ptr(tree);
+    }
+
+    void refresh_odb(git_repository* repo)
+    {
+        git_odb* odb = nullptr;
+        throw_if_error(git_repository_odb(&odb, repo));
+        const int error = git_odb_refresh(odb);
+        git_odb_free(odb);
+        throw_if_error(error);
+    }
+
+    // Insert the tree and, unless the filter omits them, its subtrees and blobs.
+    void insert_tree(
+        git_packbuilder* builder,
+        git_repository* source,
+        git_odb* source_odb,
+        const git_oid& id,
+        const clone_filter& filter,
+        oid_set& inserted
+    )
+    {
+        if (!inserted.insert(id).second)
+        {
+            return;
+        }
+        throw_if_error(git_packbuilder_insert(builder, &id, nullptr));
+
+        const tree_ptr tree = lookup_tree(source, id);
+        for (size_t i = 0, count = git_tree_entrycount(tree.get()); i < count; ++i)
+        {
+            const git_tree_entry* entry = git_tree_entry_byindex(tree.get(), i);
+            const git_oid& entry_id = *git_tree_entry_id(entry);
+            if (git_tree_entry_type(entry) == GIT_OBJECT_TREE)
+            {
+                insert_tree(builder, source, source_odb, entry_id, filter, inserted);
+            }
+            else if (git_tree_entry_type(entry) == GIT_OBJECT_BLOB && filter.includes_blobs()
+                     && inserted.insert(entry_id).second)
+            {
+                size_t size = 0;
+                git_object_t type = GIT_OBJECT_INVALID;
+                throw_if_error(git_odb_read_header(&size, &type, source_odb, &entry_id));
+                if (filter.includes_blob(size))
+                {
+                    throw_if_error(git_packbuilder_insert(builder, &entry_id, nullptr));
+                }
+            }
+        }
+    }
+}
+
+// clone_filter
+
+clone_filter clone_filter::parse(std::string_view spec)
+{
+    clone_filter res;
+    res.m_spec = spec;
+    constexpr std::string_view limit_prefix = "blob:limit=";
+    if (spec == "blob:none")
+    {
+        return res;
+    }
+    if (spec == "tree:0")
+    {
+        res.m_trees = false;
+        return res;
+    }
+    if (spec.starts_with(limit_prefix))
+    {
+        std::string_view value = spec.substr(limit_prefix.size());
+        git_object_size_t unit = 1;
+        if (!value.empty() && std::isalpha(static_cast<unsigned char>(value.back())))
+        {
+            switch (std::tolower(static_cast<unsigned char>(value.back())))
+            {
+                case 'k':
+                    unit = 1024;
+                    break;
+                case 'm':
+                    unit = 1024 * 1024;
+                    break;
+                case 'g':
+                    unit = 1024 * 1024 * 1024;
+                    break;
+                default:
+                    unit = 0;
+                    break;
+            }
+            value.remove_suffix(1);
+        }
+        const char* end = value.data() + value.size();
+        auto [ptr, ec] = std::from_chars(value.data(), end, res.m_blob_limit);
+        if (ec == std::errc() && ptr == end && unit != 0
+            && res.m_blob_limit <= std::numeric_limits<git_object_size_t>::max() / unit)
+        {
+            res.m_blob_limit *= unit;
+            return res;
+        }
+    }
+    throw git_exception("fatal: invalid filter-spec '" + res.m_spec + "'", git2cpp_error_code::BAD_ARGUMENT);
+}
+
+const std::string& clone_filter::spec() const
+{
+    return m_spec;
+}
+
+bool clone_filter::includes_trees() const
+{
+    return m_trees;
+}
+
+bool clone_filter::includes_blobs() const
+{
+    return m_blob_limit > 0;
+}
+
+bool clone_filter::includes_blob(git_object_size_t size) const
+{
+    return size < m_blob_limit;
+}
+
+// promisor_remote
+
+struct promisor_remote::backend
+{
+    git_odb_backend parent;
+    std::shared_ptr<promisor_remote> remote;
+
+    static promisor_remote& remote_of(git_odb_backend* b)
+    {
+        return *reinterpret_cast<backend*>(b)->remote;
+    }
+
+    static int read(void** data_p, size_t* len_p, git_object_t* type_p, git_odb_backend* b, const git_oid* id)
+    {
+        git_odb_object* object = nullptr;
+        if (int error = remote_of(b).fetch_one(*id, &object); error < 0)
+        {
+            return error;
+        }
+        const size_t size = git_odb_object_size(object);
+        void* data = git_odb_backend_data_alloc(b, size + 1);
+        if (!data)
+        {
+            git_odb_object_free(object);
+            return GIT_ERROR;
+        }
+        std::memcpy(data, git_odb_object_data(object), size);
+        static_cast<char*>(data)[size] = '\0';
+        *data_p = data;
+        *len_p = size;
+        *type_p = git_odb_object_type(object);
+        git_odb_object_free(object);
+        return 0;
+    }
+
+    static int read_header(size_t* len_p, git_object_t* type_p, git_odb_backend* b, const git_oid* id)
+    {
+        return git_odb_read_header(len_p, type_p, remote_of(b).p_source_odb, id);
+    }
+
+    static void free(git_odb_backend* b)
+    {
+        delete reinterpret_cast<backend*>(b);
+    }
+};
+
+std::shared_ptr<promisor_remote> promisor_remote::load(git_repository* repo)
+{
+    git_config* raw_config = nullptr;
+    if (git_repository_config_snapshot(&raw_config, repo) < 0)
+    {
+        return nullptr;
+    }
+    std::unique_ptr<git_config, config_deleter> config(raw_config);
+
+    const char* name = nullptr;
+    if (git_config_get_string(&name, config.get(), "extensions.partialclone") < 0)
+    {
+        return nullptr;
+    }
+    const std::string url_entry = "remote." + std::string(name) + ".url";
+    const char* url = nullptr;
+    if (git_config_get_string(&url, config.get(), url_entry.c_str()) < 0 || !is_local_url(url))
+    {
+        return nullptr;
+    }
+
+    // A remote that cannot be opened anymore is not an error until a missing object is read.
+    try
+    {
+        return std::make_shared<promisor_remote>(repo, url);
+    }
+    catch (const git_exception&)
+    {
+        return nullptr;
+    }
+}
+
+bool promisor_remote::is_local_url(std::string_view url)
+{
+    if (url.starts_with("file://"))
+    {
+        return true;
+    }
+    std::error_code ec;
+    return url.find("://") == std::string_view::npos && std::filesystem::is_directory(url, ec);
+}
+
+void promisor_remote::clone(
+    git_repository* repo,
+    const std::string& name,
+    const std::string& url,
+    const clone_filter& filter,
+    git_indexer_progress_cb progress_cb,
+    void* progress_payload
+)
+{
+    trace::scoped_timer timer("partial clone");
+    promisor_remote remote(repo, url);
+    git_repository* source = remote.p_source;
+
+    git_packbuilder* raw_builder = nullptr;
+    throw_if_error(git_packbuilder_new(&raw_builder, source));
+    std::unique_ptr<git_packbuilder, packbuilder_deleter> builder(raw_builder);
+    git_packbuilder_set_threads(builder.get(), 0);
+
+    // Branches and tags of the remote, the commits are inserted from the walk of all of them.
+    std::vector<std::pair<std::string, git_oid>> refs;
+    git_reference_iterator* iter = nullptr;
+    throw_if_error(git_reference_iterator_new(&iter, source));
+    git_reference* raw_ref = nullptr;
+    int error = 0;
+    while ((error = git_reference_next(&raw_ref, iter)) == 0)
+    {
+        reference_ptr ref(raw_ref);
+        const std::string ref_name = git_reference_name(ref.get());
+        if (git_reference_type(ref.get()) == GIT_REFERENCE_DIRECT
+            && (ref_name.starts_with("refs/heads/") || ref_name.starts_with("refs/tags/")))
+        {
+            refs.emplace_back(ref_name, *git_reference_target(ref.get()));
+        }
+    }
+    git_reference_iterator_free(iter);
+    if (error != GIT_ITEROVER)
+    {
+        throw_if_error(error);
+    }
+
+    git_revwalk* raw_walk = nullptr;
+    throw_if_error(git_revwalk_new(&raw_walk, source));
+    std::unique_ptr<git_revwalk, revwalk_deleter> walk(raw_walk);
+    oid_set inserted;
+    for (const auto& [ref_name, id] : refs)
+    {
+        // The annotated tags are inserted along with their target when it is not a commit.
+        git_oid target = id;
+        git_object_t type = GIT_OBJECT_INVALID;
+        size_t size = 0;
+        throw_if_error(git_odb_read_header(&size, &type, remote.p_source_odb, &target));
+        while (type == GIT_OBJECT_TAG)
+        {
+            throw_if_error(git_packbuilder_insert(builder.get(), &target, nullptr));
+            git_tag* tag = nullptr;
+            throw_if_error(git_tag_lookup(&tag, source, &target));
+            target = *git_tag_target_id(tag);
+            type = git_tag_target_type(tag);
+            git_tag_free(tag);
+        }
+        if (type == GIT_OBJECT_COMMIT)
+        {
+            throw_if_error(git_revwalk_push(walk.get(), &target));
+        }
+        else if (inserted.insert(target).second)
+        {
+            throw_if_error(git_packbuilder_insert(builder.get(), &target, nullptr));
+        }
+    }
+
+    git_oid commit_id;
+    while ((error = git_revwalk_next(&commit_id, walk.get())) == 0)
+    {
+        throw_if_error(git_packbuilder_insert(builder.get(), &commit_id, nullptr));
+        if (filter.includes_trees())
+        {
+            git_commit* commit = nullptr;
+            throw_if_error(git_commit_lookup(&commit, source, &commit_id));
+            const git_oid tree_id = *git_commit_tree_id(commit);
+            git_commit_free(commit);
+            insert_tree(builder.get(), source, remote.p_source_odb, tree_id, filter, inserted);
+        }
+    }
+    if (error != GIT_ITEROVER)
+    {
+        throw_if_error(error);
+    }
+
+    const std::string pack_dir = remote.m_objects_dir + "/pack";
+    throw_if_error(git_packbuilder_write(builder.get(), pack_dir.c_str(), 0, progress_cb, progress_payload));
+    trace::add("partial clone objects", git_packbuilder_object_count(builder.get()));
+    refresh_odb(repo);
+
+    const std::string log_message = "clone: from " + url;
+    for (const auto& [ref_name, id] : refs)
+    {
+        const std::string local_name = ref_name.starts_with("refs/heads/")
+                                           ? "refs/remotes/" + name + "/" + ref_name.substr(11)
+                                           : ref_name;
+        git_reference* created = nullptr;
+        throw_if_error(git_reference_create(&created, repo, local_name.c_str(), &id, 1, log_message.c_str()));
+        git_reference_free(created);
+    }
+
+    // HEAD is the branch of the HEAD of the remote, tracking it.
+    git_reference* raw_head = nullptr;
+    throw_if_error(git_reference_lookup(&raw_head, source, "HEAD"));
+    reference_ptr head(raw_head);
+    if (git_reference_type(head.get()) == GIT_REFERENCE_SYMBOLIC)
+    {
+        const std::string head_target = git_reference_symbolic_target(head.get());
+        const auto branch = std::find_if(
+            refs.begin(),
+            refs.end(),
+            [&head_target](const auto& ref)
+            {
+                return ref.first == head_target;
+            }
+        );
+        if (branch != refs.end())
+        {
+            const std::string branch_name = head_target.substr(11);
+            const std::string tracking_name = "refs/remotes/" + name + "/" + branch_name;
+            git_reference* created = nullptr;
+            const git_oid& branch_id = branch->second;
+            throw_if_error(
+                git_reference_create(&created, repo, head_target.c_str(), &branch_id, 1, log_message.c_str())
+            );
+            reference_ptr local_branch(created);
+            throw_if_error(git_branch_set_upstream(local_branch.get(), (name + "/" + branch_name).c_str()));
+            const std::string remote_head = "refs/remotes/" + name + "/HEAD";
+            throw_if_error(git_reference_symbolic_create(
+                &created,
+                repo,
+                remote_head.c_str(),
+                tracking_name.c_str(),
+                1,
+                log_message.c_str()
+            ));
+            git_reference_free(created);
+        }
+        throw_if_error(git_repository_set_head(repo, head_target.c_str()));
+    }
+    else
+    {
+        throw_if_error(git_repository_set_head_detached(repo, git_reference_target(head.get())));
+    }
+
+    git_config* raw_config = nullptr;
+    throw_if_error(git_repository_config(&raw_config, repo));
+    std::unique_ptr<git_config, config_deleter> config(raw_config);
+    throw_if_error(git_config_set_bool(config.get(), ("remote." + name + ".promisor").c_str(), 1));
+    throw_if_error(git_config_set_string(
+        config.get(),
+        ("remote." + name + ".partialclonefilter").c_str(),
+        filter.spec().c_str()
+    ));
+    throw_if_error(git_config_set_int32(config.get(), "core.repositoryformatversion", 1));
+    throw_if_error(git_config_set_string(config.get(), "extensions.partialclone", name.c_str()));
+}
+
+promisor_remote::promisor_remote(git_repository* repo, const std::string& url)
+    : m_objects_dir(std::string(git_repository_commondir(repo)) + "objects")
+{
+    int error = git_repository_open(&p_source, local_path(url).c_str());
+    if (error == 0)
+    {
+        error = git_repository_odb(&p_source_odb, p_source);
+    }
+    if (error == 0)
+    {
+        error = git_odb_open(&p_local_odb, m_objects_dir.c_str());
+    }
+    if (error < 0)
+    {
+        close();
+        throw_if_error(error);
+    }
+}
+
+promisor_remote::~promisor_remote()
+{
+    close();
+}
+
+void promisor_remote::close()
+{
+    git_odb_free(p_local_odb);
+    git_odb_free(p_source_odb);
+    git_repository_free(p_source);
+    p_local_odb = nullptr;
+    p_source_odb = nullptr;
+    p_source = nullptr;
+}
+
+void promisor_remote::add_backend(git_repository* repo)
+{
+    git_odb* odb = nullptr;
+    throw_if_error(git_repository_odb(&odb, repo));
+    auto* b = new backend{};
+    int error = git_odb_init_backend(&b->parent, GIT_ODB_BACKEND_VERSION);
+    if (error == 0)
+    {
+        b->parent.read = backend::read;
+        b->parent.read_header = backend::read_header;
+        b->parent.free = backend::free;
+        b->remote = shared_from_this();
+        // Tried after the backends of the repository, which have a higher priority.
+        error = git_odb_add_backend(odb, &b->parent, 0);
+    }
+    git_odb_free(odb);
+    if (error < 0)
+    {
+        delete b;
+        throw_if_error(error);
+    }
+}
+
+bool promisor_remote::is_missing(const git_oid& id) const
+{
+    return git_odb_exists_ext(p_local_odb, &id, GIT_ODB_LOOKUP_NO_REFRESH) == 0;
+}
+
+int promisor_remote::fetch_one(const git_oid& id, git_odb_object** object)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (int error = git_odb_read(object, p_source_odb, &id); error < 0)
+    {
+        return error;
+    }
+    git_oid written;
+    const int error = git_odb_write(
+        &written,
+        p_local_odb,
+        git_odb_object_data(*object),
+        git_odb_object_size(*object),
+        git_odb_object_type(*object)
+    );
+    if (error < 0)
+    {
+        git_odb_object_free(*object);
+        *object = nullptr;
+        return error;
+    }
+    trace::add("promisor objects fetched");
+    return 0;
+}
+
+void promisor_remote::fetch(git_repository* repo, const std::vector<git_oid>& ids)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    oid_set wanted;
+    for (const auto& id : ids)
+    {
+        if (is_missing(id) && git_odb_exists(p_source_odb, &id))
+        {
+            wanted.insert(id);
+        }
+    }
+    if (wanted.empty())
+    {
+        return;
+    }
+
+    trace::scoped_timer timer("promisor fetch");
+    git_packbuilder* raw_builder = nullptr;
+    throw_if_error(git_packbuilder_new(&raw_builder, p_source));
+    std::unique_ptr<git_packbuilder, packbuilder_deleter> builder(raw_builder);
+    git_packbuilder_set_threads(builder.get(), 0);
+    for (const auto& id : wanted)
+    {
+        throw_if_error(git_packbuilder_insert(builder.get(), &id, nullptr));
+    }
+    const std::string pack_dir = m_objects_dir + "/pack";
+    throw_if_error(git_packbuilder_write(builder.get(), pack_dir.c_str(), 0, nullptr, nullptr));
+    throw_if_error(git_odb_refresh(p_local_odb));
+    refresh_odb(repo);
+    trace::add("promisor objects fetched", wanted.size());
+}
+
+void promisor_remote::prefetch_tree(
+    git_repository* repo,
+    const git_oid& tree_id,
+    const sparse_checkout* sparse
+)
+{
+    trace::scoped_timer timer("promisor prefetch");
+    // The trees are fetched one level at a time, then all the blobs at once.
+    std::vector<std::pair<git_oid, std::string>> level = {{tree_id, ""}};
+    std::vector<git_oid> blobs;
+    while (!level.empty())
+    {
+        std::vector<git_oid> ids;
+        for (const auto& [id, prefix] : level)
+        {
+            ids.push_back(id);
+        }
+        fetch(repo, ids);
+
+        std::vector<std::pair<git_oid, std::string>> next;
+        for (const auto& [id, prefix] : level)
+        {
+            const tree_ptr tree = lookup_tree(repo, id);
+            for (size_t i = 0, count = git_tree_entrycount(tree.get()); i < count; ++i)
+            {
+                const git_tree_entry* entry = git_tree_entry_byindex(tree.get(), i);
+                const git_oid& entry_id = *git_tree_entry_id(entry);
+                const std::string path = prefix + git_tree_entry_name(entry);
+                if (git_tree_entry_type(entry) == GIT_OBJECT_TREE)
+                {
+                    next.emplace_back(entry_id, path + "/");
+                }
+                else if (git_tree_entry_type(entry) == GIT_OBJECT_BLOB && (!sparse || sparse->includes(path))
+                         && is_missing(entry_id))
+                {
+                    blobs.push_back(entry_id);
+                }
+            }
+        }
+        level = std::move(next);
+    }
+    fetch(repo, blobs);
+}
+
+void promisor_remote::prefetch_diff(git_repository* repo, git_diff* diff)
+{
+    std::vector<git_oid> blobs;
+    for (size_t i = 0, count = git_diff_num_deltas(diff); i < count; ++i)
+    {
+        const git_diff_delta* delta = git_diff_get_delta(diff, i);
+        for (const git_diff_file* file : {&delta->old_file, &delta->new_file})
+        {
+            if ((file->flags & GIT_DIFF_FLAG_VALID_ID) != 0 && file->mode != GIT_FILEMODE_COMMIT
+                && !git_oid_is_zero(&file->id) && is_missing(file->id))
+            {
+                blobs.push_back(file->id);
+            }
+        }
+    }
+    fetch(repo, blobs);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <git2.h>
+
+#include "common.hpp"
+
+class sparse_checkout;
+
+/**
+ * Filter of a partial clone, in the format of clone --filter: blob:none omits every blob,
+ * blob:limit=<n>[kmg] the blobs of at least n bytes, and tree:0 every tree and blob.
+ */
+class clone_filter
+{
+public:
+
+    // Throws a git_exception for the other filters.
+    static clone_filter parse(std::string_view spec);
+
+    const std::string& spec() const;
+    bool includes_trees() const;
+    // Whether some blobs are included, includes_blob tells which ones.
+    bool includes_blobs() const;
+    bool includes_blob(git_object_size_t size) const;
+
+private:
+
+    clone_filter() = default;
+
+    std::string m_spec;
+    bool m_trees = true;
+    git_object_size_t m_blob_limit = 0;
+};
+
+/**
+ * Remote from which the objects omitted by a partial clone are fetched, recorded as in git by the
+ * extensions.partialclone, remote.<name>.promisor and remote.<name>.partialclonefilter config
+ * entries. Only the remotes in a local repository (a path or a file:// URL) are supported: the
+ * objects are read from its object database and written to a pack of the clone.
+ *
+ * The objects needed by a command are fetched in a single pack by the prefetch functions, before
+ * the command reads them. The other ones are fetched one by one when they are read, by an object
+ * database backend tried after the ones of the repository.
+ */
+class promisor_remote
+    : public std::enable_shared_from_this<promisor_remote>
+    , private noncopyable_nonmovable
+{
+public:
+
+    // Remote of repo if it is a partial clone of a local repository, nullptr otherwise.
+    static std::shared_ptr<promisor_remote> load(git_repository* repo);
+
+    // Whether url is the one of a repository on this machine.
+    static bool is_local_url(std::string_view url);
+
+    // Fill the repository at repo, just initialized with a remote name at url, with the objects of
+    // the branches and tags of url except the ones omitted by filter, then create the remote
+    // tracking branches, the tags and the branch of the HEAD of url, and record the remote as the
+    // promisor remote of the clone.
+    static void clone(
+        git_repository* repo,
+        const std::string& name,
+        const std::string& url,
+        const clone_filter& filter,
+        git_indexer_progress_cb progress_cb,
+        void* progress_payload
+    );
+
+    promisor_remote(git_repository* repo, const std::string& url);
+    ~promisor_remote();
+
+    // Add the backend fetching the missing objects to the object database of repo.
+    void add_backend(git_repository* repo);
+
+    // Fetch the objects of ids that are missing from repo and that the remote has.
+    void fetch(git_repository* repo, const std::vector<git_oid>& ids);
+    // Fetch the missing trees of the tree at tree_id and the missing blobs checked out with sparse.
+    void prefetch_tree(git_repository* repo, const git_oid& tree_id, const sparse_checkout* sparse);
+    // Fetch the missing blobs of the deltas of diff.
+    void prefetch_diff(git_repository* repo, git_diff* diff);
+
+private:
+
+    struct backend;
+
+    void close();
+    bool is_missing(const git_oid& id) const;
+    // Copy the object from the remote as a loose object, for the backend.
+    int fetch_one(const git_oid& id, git_odb_object** object);
+
+    std::string m_objects_dir;
+    git_repository* p_source = nullptr;
+    git_odb* p_source_odb = nullptr;
+    // Object database of the clone without the backend, to find the missing objects.
+    git_odb* p_local_odb = nullptr;
+    std::mutex m_mutex;
+};
@@ -4,10 +4,13 @@
 #include <iostream>
 #include <string_view>
 
+#include "../utils/trace.hpp"
+
 int sideband_progress(const char* str, int len, void*)
 {
-    printf("remote: %.*s", len, str);
-    fflush(stdout);
+    trace::add("sideband bytes", uint64_t(len));
+    // Through std::cout rather than stdio, so that batch captures it with the rest of the output.
+    std::cout << "remote: " << std::string_view(str, size_t(len)) << std::flush;
     return 0;
 }
 
@@ -20,6 +23,8 @@ int fetch_progress(const git_indexer_progress* stats, void* payload)
     // same payload and needs the data to be up do date.
     auto* pr = reinterpret_cast<git_indexer_progress*>(payload);
     *pr = *stats;
+    trace::set_max("bytes received", stats->received_bytes);
+    trace::set_max("objects received", stats->received_objects);
 
     if (done)
     {
@@ -58,6 +63,20 @@ int fetch_progress(const git_indexer_progress* stats, void* payload)
     return 0;
 }
 
+void add_progress(size_t current, size_t total)
+{
+    const size_t percent = total > 0 ? (100 * current / total) : 100;
+    std::cout << "Hashing objects: " << std::setw(4) << percent << "% (" << current << "/" << total << ")";
+    if (current == total)
+    {
+        std::cout << ", done." << std::endl;
+    }
+    else
+    {
+        std::cout << '\r';
+    }
+}
+
 void checkout_progress(const char* path, size_t cur, size_t tot, void* payload)
 {
     static bool done = false;
@@ -126,6 +145,7 @@ int update_refs(const char* refname, const git_oid* a, const git_oid* b, git_ref
 
 int push_transfer_progress(unsigned int current, unsigned int total, size_t bytes, void*)
 {
+    trace::set_max("bytes sent", bytes);
     if (total > 0)
     {
         int percent = (100 * current) / total;
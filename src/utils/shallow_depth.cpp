@@ -0,0 +1,134 @@
+#include "shallow_depth.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "common.hpp"
+#include "git_exception.hpp"
+#include "trace.hpp"
+
+static constexpr const char* memo_signature = "git2cpp shallow depth 1";
+
+namespace
+{
+    using oid_set = std::unordered_set<git_oid, git_oid_hash, git_oid_equal_to>;
+
+    std::string to_hex(const git_oid& id)
+    {
+        char hex[GIT_OID_SHA1_HEXSIZE + 1];
+        git_oid_tostr(hex, sizeof(hex), &id);
+        return hex;
+    }
+
+    // A missing or invalid memo is not an error, the depth is just computed again.
+    std::optional<size_t> read_memo(const std::string& path, const std::string& key)
+    {
+        std::ifstream file(path);
+        std::string line;
+        size_t depth = 0;
+        if (!std::getline(file, line) || line != memo_signature || !std::getline(file, line) || line != key
+            || !(file >> depth))
+        {
+            return std::nullopt;
+        }
+        return depth;
+    }
+
+    // The memo is only an optimization, it is not an error if it cannot be written.
+    void write_memo(const std::string& path, const std::string& key, size_t depth)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        const std::string lock_path = path + ".lock";
+        {
+            std::ofstream file(lock_path, std::ios::trunc);
+            file << memo_signature << '\n' << key << '\n' << depth << '\n';
+            if (!file)
+            {
+                file.close();
+                std::filesystem::remove(lock_path, ec);
+                return;
+            }
+        }
+        std::filesystem::rename(lock_path, path, ec);
+    }
+}
+
+size_t shallow_depth(git_repository* repo, const git_oid& head)
+{
+    trace::scoped_timer timer("shallow depth");
+    const std::filesystem::path git_dir = git_repository_path(repo);
+    std::string content;
+    {
+        std::ifstream file(git_dir / "shallow", std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    oid_set boundaries;
+    std::istringstream lines(content);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        git_oid id;
+        if (!line.empty() && git_oid_fromstrp(&id, line.c_str()) == 0)
+        {
+            boundaries.insert(id);
+        }
+    }
+    if (boundaries.empty())
+    {
+        return 0u;
+    }
+
+    git_oid content_id;
+    throw_if_error(git_odb_hash(&content_id, content.data(), content.size(), GIT_OBJECT_BLOB));
+    const std::string key = to_hex(head) + ' ' + to_hex(content_id);
+    const std::string memo_path = (git_dir / "git2cpp" / "shallow-depth").string();
+    if (const auto depth = read_memo(memo_path, key))
+    {
+        trace::add("shallow depth memo hits");
+        return *depth;
+    }
+
+    // The first level at which a commit is found is its shortest distance to head. The parents of
+    // the boundaries are not followed: they are not in the repository.
+    size_t depth = 1u;
+    size_t found = 0u;
+    oid_set visited = {head};
+    std::vector<git_oid> level = {head};
+    for (size_t distance = 1u; !level.empty() && found < boundaries.size(); ++distance)
+    {
+        std::vector<git_oid> next;
+        for (const auto& id : level)
+        {
+            if (boundaries.contains(id))
+            {
+                depth = distance;
+                ++found;
+                continue;
+            }
+            git_commit* commit = nullptr;
+            throw_if_error(git_commit_lookup(&commit, repo, &id));
+            for (unsigned int i = 0; i < git_commit_parentcount(commit); ++i)
+            {
+                const git_oid& parent = *git_commit_parent_id(commit, i);
+                if (visited.insert(parent).second)
+                {
+                    next.push_back(parent);
+                }
+            }
+            git_commit_free(commit);
+        }
+        trace::add("shallow depth commits walked", level.size());
+        level = std::move(next);
+    }
+
+    write_memo(memo_path, key, depth);
+    return depth;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+#include <git2.h>
+
+/**
+ * Depth of the history of a shallow repository from the commit head: the number of commits from
+ * head to the farthest shallow boundary (a commit of <git_dir>/shallow, whose parents were not
+ * fetched), both included, each boundary being reached by its shortest path as in git. 1 if no
+ * boundary is reachable, 0 if there is none.
+ *
+ * The commits are walked breadth first from head, by oid, until every boundary is reached. The
+ * result is stored in the git directory (git2cpp/shallow-depth) with head and a hash of the shallow
+ * file, so that a computation for the same head and boundaries, such as a fetch --deepen run again
+ * after it failed, only reads it. A successful fetch --deepen rewrites the shallow file, so the next
+ * one walks the commits again.
+ */
+size_t shallow_depth(git_repository* repo, const git_oid& head);
@@ -0,0 +1,350 @@
+#include "similarity_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "trace.hpp"
+
+static constexpr const char* cache_signature = "git2cpp signatures 1";
+
+namespace
+{
+    constexpr size_t record_size = sizeof(git_oid) + sizeof(similarity_index::signature);
+    constexpr size_t band_count = similarity_index::signature_size / similarity_index::band_size;
+
+    // Multipliers and increments of the hash functions, derived once from a fixed seed so that the
+    // stored signatures stay valid.
+    struct hash_functions
+    {
+        std::array<uint64_t, similarity_index::signature_size> multipliers;
+        std::array<uint64_t, similarity_index::signature_size> increments;
+
+        hash_functions()
+        {
+            uint64_t state = 0x9E3779B97F4A7C15ULL;
+            const auto next = [&state]()
+            {
+                // splitmix64
+                uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                return z ^ (z >> 31);
+            };
+            for (size_t i = 0; i < similarity_index::signature_size; ++i)
+            {
+                multipliers[i] = next() | 1;
+                increments[i] = next();
+            }
+        }
+    };
+
+    const hash_functions& functions()
+    {
+        static const hash_functions instance;
+        return instance;
+    }
+
+    // FNV-1a
+    uint64_t line_hash(std::string_view line)
+    {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (unsigned char c : line)
+        {
+            hash = (hash ^ c) * 0x100000001B3ULL;
+        }
+        return hash;
+    }
+
+    std::string_view trim_line(std::string_view line)
+    {
+        constexpr std::string_view whitespace = " \t\r\f\v";
+        const size_t first = line.find_first_not_of(whitespace);
+        if (first == std::string_view::npos)
+        {
+            return {};
+        }
+        return line.substr(first, line.find_last_not_of(whitespace) - first + 1);
+    }
+
+    void write_record(char* record, const git_oid& id, const similarity_index::signature& sig)
+    {
+        std::memcpy(record, &id, sizeof(id));
+        std::memcpy(record + sizeof(id), sig.data(), sizeof(sig));
+    }
+
+    uint64_t band_key(size_t band, const similarity_index::signature& sig)
+    {
+        uint64_t key = band;
+        for (size_t i = 0; i < similarity_index::band_size; ++i)
+        {
+            key = (key << 16) | sig[band * similarity_index::band_size + i];
+        }
+        return key;
+    }
+}
+
+similarity_index::similarity_index(const std::string& git_dir, size_t byte_limit)
+    : m_path((std::filesystem::path(git_dir) / "git2cpp" / "signatures").string())
+    , m_byte_limit(byte_limit)
+{
+    if (m_byte_limit == 0)
+    {
+        return;
+    }
+
+    // A missing or invalid cache is not an error, the signatures are just computed again. Records
+    // are only ever appended whole, a size that is not a multiple of theirs means a failed write.
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(m_path, ec);
+    const size_t header_size = std::strlen(cache_signature) + 1;
+    if (ec || file_size < header_size || (file_size - header_size) % record_size != 0)
+    {
+        return;
+    }
+    std::ifstream file(m_path, std::ios::binary);
+    std::string line;
+    if (!std::getline(file, line) || line != cache_signature)
+    {
+        return;
+    }
+    char record[record_size];
+    while (file.read(record, record_size))
+    {
+        git_oid id;
+        signature sig;
+        std::memcpy(&id, record, sizeof(id));
+        std::memcpy(sig.data(), record + sizeof(id), sizeof(sig));
+        m_cache.emplace(id, cache_entry{sig, m_loaded_ids.size()});
+        m_loaded_ids.push_back(id);
+    }
+    m_used.resize(m_loaded_ids.size(), false);
+}
+
+std::optional<similarity_index::signature> similarity_index::content_signature(std::string_view content)
+{
+    const auto& fns = functions();
+    std::array<uint32_t, signature_size> minimums;
+    minimums.fill(std::numeric_limits<uint32_t>::max());
+    bool has_line = false;
+
+    while (!content.empty())
+    {
+        const size_t eol = content.find('\n');
+        const std::string_view line = trim_line(content.substr(0, eol));
+        content.remove_prefix(eol == std::string_view::npos ? content.size() : eol + 1);
+        if (line.empty())
+        {
+            continue;
+        }
+
+        has_line = true;
+        const uint64_t hash = line_hash(line);
+        for (size_t i = 0; i < signature_size; ++i)
+        {
+            const auto value = uint32_t((hash * fns.multipliers[i] + fns.increments[i]) >> 32);
+            minimums[i] = std::min(minimums[i], value);
+        }
+    }
+
+    if (!has_line)
+    {
+        return std::nullopt;
+    }
+    signature sig;
+    std::transform(
+        minimums.begin(),
+        minimums.end(),
+        sig.begin(),
+        [](uint32_t value)
+        {
+            return uint16_t(value);
+        }
+    );
+    return sig;
+}
+
+std::optional<similarity_index::signature>
+similarity_index::blob_signature(git_repository* repo, const git_oid& id)
+{
+    if (auto it = m_cache.find(id); it != m_cache.end())
+    {
+        trace::add("signature cache hits");
+        if (it->second.position != not_loaded)
+        {
+            m_used[it->second.position] = true;
+        }
+        return it->second.sig;
+    }
+
+    git_blob* blob = nullptr;
+    if (git_blob_lookup(&blob, repo, &id) < 0)
+    {
+        return std::nullopt;
+    }
+    const auto sig = content_signature(std::string_view(
+        static_cast<const char*>(git_blob_rawcontent(blob)),
+        static_cast<size_t>(git_blob_rawsize(blob))
+    ));
+    git_blob_free(blob);
+
+    trace::add("signatures computed");
+    if (sig)
+    {
+        m_cache.emplace(id, cache_entry{*sig, not_loaded});
+        m_new_ids.push_back(id);
+    }
+    return sig;
+}
+
+void similarity_index::add(uint32_t item, const signature& sig)
+{
+    if (m_items.size() <= item)
+    {
+        m_items.resize(item + 1);
+    }
+    m_items[item] = sig;
+    for (size_t band = 0; band < band_count; ++band)
+    {
+        m_buckets[band_key(band, sig)].push_back(item);
+    }
+}
+
+std::vector<uint32_t>
+similarity_index::find(const signature& sig, unsigned int min_similarity, size_t max_count) const
+{
+    std::vector<uint32_t> candidates;
+    for (size_t band = 0; band < band_count; ++band)
+    {
+        const auto it = m_buckets.find(band_key(band, sig));
+        if (it != m_buckets.end())
+        {
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // The share of equal values estimates the Jaccard similarity of the sets of lines.
+    std::vector<std::pair<size_t, uint32_t>> scored;
+    for (uint32_t item : candidates)
+    {
+        const signature& other = m_items[item];
+        size_t equal = 0;
+        for (size_t i = 0; i < signature_size; ++i)
+        {
+            equal += sig[i] == other[i] ? 1 : 0;
+        }
+        if (equal * 100 >= min_similarity * signature_size)
+        {
+            scored.emplace_back(equal, item);
+        }
+    }
+    std::sort(
+        scored.begin(),
+        scored.end(),
+        [](const auto& lhs, const auto& rhs)
+        {
+            return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+        }
+    );
+
+    std::vector<uint32_t> result;
+    for (size_t i = 0; i < scored.size() && i < max_count; ++i)
+    {
+        result.push_back(scored[i].second);
+    }
+    return result;
+}
+
+void similarity_index::store() const
+{
+    if (m_byte_limit == 0 || m_new_ids.empty())
+    {
+        return;
+    }
+    if (m_loaded_ids.empty() || m_loaded_ids.size() + m_new_ids.size() > m_byte_limit / record_size)
+    {
+        rewrite();
+        return;
+    }
+
+    // A single write in append mode, so that the records of concurrent commands do not interleave.
+    std::string records(m_new_ids.size() * record_size, '\0');
+    for (size_t i = 0; i < m_new_ids.size(); ++i)
+    {
+        write_record(records.data() + i * record_size, m_new_ids[i], m_cache.at(m_new_ids[i]).sig);
+    }
+    const int fd = ::open(m_path.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0)
+    {
+        return;
+    }
+    const bool written = ::write(fd, records.data(), records.size()) == ssize_t(records.size());
+    ::close(fd);
+    if (!written)
+    {
+        // A truncated record would invalidate the file, the next command writes it again.
+        std::error_code ec;
+        std::filesystem::remove(m_path, ec);
+    }
+}
+
+void similarity_index::rewrite() const
+{
+    // The signatures used or computed by the command are kept, then the most recently added other
+    // ones, up to the byte limit. The file keeps the order in which they were added.
+    const size_t max_records = m_byte_limit / record_size;
+    std::vector<git_oid> recent;
+    for (size_t i = 0; i < m_loaded_ids.size(); ++i)
+    {
+        if (m_used[i])
+        {
+            recent.push_back(m_loaded_ids[i]);
+        }
+    }
+    recent.insert(recent.end(), m_new_ids.begin(), m_new_ids.end());
+    if (recent.size() > max_records)
+    {
+        recent.erase(recent.begin(), recent.end() - ptrdiff_t(max_records));
+    }
+    std::vector<git_oid> kept;
+    for (size_t i = m_loaded_ids.size(); i-- > 0 && kept.size() + recent.size() < max_records;)
+    {
+        // Duplicates from concurrent appends only keep their first position.
+        if (!m_used[i] && m_cache.at(m_loaded_ids[i]).position == i)
+        {
+            kept.push_back(m_loaded_ids[i]);
+        }
+    }
+    std::reverse(kept.begin(), kept.end());
+    kept.insert(kept.end(), recent.begin(), recent.end());
+    trace::add("signature cache evictions", m_cache.size() - kept.size());
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), ec);
+    const std::string lock_path = m_path + ".lock";
+    {
+        std::ofstream file(lock_path, std::ios::binary | std::ios::trunc);
+        file << cache_signature << '\n';
+        char record[record_size];
+        for (const auto& id : kept)
+        {
+            write_record(record, id, m_cache.at(id).sig);
+            file.write(record, record_size);
+        }
+
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(lock_path, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(lock_path, m_path, ec);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <git2.h>
+
+#include "common.hpp"
+
+/**
+ * Content signatures of blobs and an index of them, to find the files similar to a given one
+ * without comparing it with every file of the tree.
+ *
+ * The signature of a content is a MinHash of its lines (leading and trailing whitespace ignored,
+ * blank lines skipped): for each of signature_size hash functions, the smallest hash of its lines.
+ * Two contents have a given value in common with a probability equal to the Jaccard similarity of
+ * their sets of lines. The index buckets the signatures by bands of band_size values
+ * (locality-sensitive hashing), so that the candidates of a signature are found with one lookup per
+ * band, and only the contents having a whole band in common are compared.
+ *
+ * The index only estimates the similarity that libgit2 computes, so it may miss a file that
+ * libgit2 would find similar enough.
+ *
+ * Signatures only depend on the content: the ones of blobs are stored by blob id in the git
+ * directory (git2cpp/signatures) and reused by the following commands. The signatures computed by a
+ * command are appended to the file. When it would exceed its byte limit, it is written again with
+ * the signatures used by the command and the most recently added other ones.
+ */
+class similarity_index : private noncopyable_nonmovable
+{
+public:
+
+    static constexpr size_t signature_size = 64;
+    static constexpr size_t band_size = 2;
+    static constexpr int64_t default_byte_limit = 16 * 1024 * 1024;
+
+    // Each value only keeps 16 bits of the minimum hash, which is enough to compare them.
+    using signature = std::array<uint16_t, signature_size>;
+
+    // A byte limit of 0 disables the cache of the blob signatures.
+    similarity_index(const std::string& git_dir, size_t byte_limit);
+
+    // nullopt if the content has no line to compare.
+    static std::optional<signature> content_signature(std::string_view content);
+
+    // Signature of a blob, from the cache or computed from its content.
+    std::optional<signature> blob_signature(git_repository* repo, const git_oid& id);
+
+    void add(uint32_t item, const signature& sig);
+
+    // Items whose estimated similarity with sig is at least min_similarity percent, the most similar
+    // first, at most max_count.
+    std::vector<uint32_t> find(const signature& sig, unsigned int min_similarity, size_t max_count) const;
+
+    // Write the signatures computed since the cache was loaded. The cache is only an optimization,
+    // it is not an error if it cannot be written.
+    void store() const;
+
+private:
+
+    struct cache_entry
+    {
+        signature sig;
+        // Position in the cache file, not_loaded for the signatures computed by the command.
+        size_t position;
+    };
+
+    static constexpr size_t not_loaded = size_t(-1);
+
+    void rewrite() const;
+
+    std::string m_path;
+    size_t m_byte_limit;
+    std::unordered_map<git_oid, cache_entry, git_oid_hash, git_oid_equal_to> m_cache;
+    // Ids of the signatures of the cache file, in the order they were added, and whether the command
+    // used them.
+    std::vector<git_oid> m_loaded_ids;
+    std::vector<bool> m_used;
+    std::vector<git_oid> m_new_ids;
+
+    std::vector<signature> m_items;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_buckets;
+};
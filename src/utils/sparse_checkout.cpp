@@ -0,0 +1,301 @@
+#include "sparse_checkout.hpp"
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+
+#include <unistd.h>
+
+#include "common.hpp"
+#include "git_exception.hpp"
+#include "stat_cache.hpp"
+#include "trace.hpp"
+
+namespace
+{
+    struct index_deleter
+    {
+        void operator()(git_index* index) const
+        {
+            git_index_free(index);
+        }
+    };
+
+    bool config_bool(git_config* config, const char* name, bool default_value)
+    {
+        int value = 0;
+        return git_config_get_bool(&value, config, name) == 0 ? value != 0 : default_value;
+    }
+}
+
+std::optional<sparse_checkout> sparse_checkout::load(git_repository* repo)
+{
+    bool enabled = false;
+    bool cone = true;
+    git_config* config = nullptr;
+    if (git_repository_config_snapshot(&config, repo) == 0)
+    {
+        enabled = config_bool(config, "core.sparseCheckout", false);
+        cone = config_bool(config, "core.sparseCheckoutCone", true);
+        git_config_free(config);
+    }
+    if (!enabled || !cone)
+    {
+        return std::nullopt;
+    }
+
+    std::ifstream file(file_path(git_repository_path(repo)));
+    if (!file)
+    {
+        return std::nullopt;
+    }
+
+    // Every directory of the cone has a line of its own, followed by a negative one for the parent
+    // directories, of which only the files are included.
+    std::set<std::string> directories;
+    std::set<std::string> parents;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.ends_with('\r'))
+        {
+            line.pop_back();
+        }
+        if (line.empty() || line.starts_with('#') || line == "/*" || line == "!/*/")
+        {
+            continue;
+        }
+        if (line.size() > 5 && line.starts_with("!/") && line.ends_with("/*/"))
+        {
+            parents.insert(line.substr(2, line.size() - 5));
+        }
+        else if (line.size() > 2 && line.starts_with('/') && line.ends_with('/'))
+        {
+            directories.insert(line.substr(1, line.size() - 2));
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+
+    sparse_checkout res;
+    for (const auto& directory : directories)
+    {
+        if (!parents.contains(directory))
+        {
+            res.add_directory(directory);
+        }
+    }
+    return res;
+}
+
+std::string sparse_checkout::file_path(const std::string& git_dir)
+{
+    return (std::filesystem::path(git_dir) / "info" / "sparse-checkout").string();
+}
+
+sparse_checkout::sparse_checkout(const std::vector<std::string>& directories)
+{
+    add(directories);
+}
+
+bool sparse_checkout::includes(std::string_view path) const
+{
+    const size_t slash = path.rfind('/');
+    if (slash == std::string_view::npos)
+    {
+        return true;
+    }
+    const std::string_view directory = path.substr(0, slash);
+    return m_parents.contains(std::string(directory)) || is_in_cone(directory);
+}
+
+bool sparse_checkout::is_in_cone(std::string_view directory) const
+{
+    while (!m_recursive.contains(std::string(directory)))
+    {
+        const size_t slash = directory.rfind('/');
+        if (slash == std::string_view::npos)
+        {
+            return false;
+        }
+        directory = directory.substr(0, slash);
+    }
+    return true;
+}
+
+std::vector<std::string> sparse_checkout::directories() const
+{
+    return {m_recursive.begin(), m_recursive.end()};
+}
+
+void sparse_checkout::add(const std::vector<std::string>& directories)
+{
+    for (const auto& directory : directories)
+    {
+        add_directory(directory);
+    }
+}
+
+void sparse_checkout::add_directory(std::string directory)
+{
+    while (directory.ends_with('/'))
+    {
+        directory.pop_back();
+    }
+    directory.erase(0, directory.find_first_not_of('/'));
+    if (directory.empty() || is_in_cone(directory))
+    {
+        return;
+    }
+
+    // The directories below the new one are part of it now.
+    std::erase_if(
+        m_recursive,
+        [&directory](const std::string& existing)
+        {
+            return existing.starts_with(directory + "/");
+        }
+    );
+    m_recursive.insert(directory);
+
+    m_parents.clear();
+    for (const auto& recursive : m_recursive)
+    {
+        for (size_t slash = recursive.find('/'); slash != std::string::npos;
+             slash = recursive.find('/', slash + 1))
+        {
+            m_parents.insert(recursive.substr(0, slash));
+        }
+    }
+}
+
+void sparse_checkout::store(const std::string& git_dir) const
+{
+    const std::string path = file_path(git_dir);
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    std::set<std::string> lines(m_parents);
+    lines.insert(m_recursive.begin(), m_recursive.end());
+    const std::string lock_path = path + ".lock";
+    {
+        std::ofstream file(lock_path, std::ios::trunc);
+        file << "/*\n!/*/\n";
+        for (const auto& directory : lines)
+        {
+            file << '/' << directory << "/\n";
+            if (m_parents.contains(directory))
+            {
+                file << "!/" << directory << "/*/\n";
+            }
+        }
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(lock_path, ec);
+            throw git_exception("could not write " + path, git2cpp_error_code::FILESYSTEM_ERROR);
+        }
+    }
+    std::filesystem::rename(lock_path, path);
+}
+
+std::vector<std::string> apply_sparse_checkout(git_repository* repo, const sparse_checkout* sparse)
+{
+    trace::scoped_timer timer("sparse checkout update");
+
+    git_index* raw_index = nullptr;
+    throw_if_error(git_repository_index(&raw_index, repo));
+    std::unique_ptr<git_index, index_deleter> index(raw_index);
+    throw_if_error(git_index_read(index.get(), false));
+
+    const std::string workdir = git_repository_workdir(repo);
+    stat_cache stats(repo);
+    std::vector<git_index_entry> updated;
+    std::vector<std::string> updated_paths;
+    std::vector<std::string> written_paths;
+    std::vector<std::string> left_paths;
+    std::set<std::string, std::greater<>> emptied_directories;
+
+    const size_t entry_count = git_index_entrycount(index.get());
+    for (size_t i = 0; i < entry_count; ++i)
+    {
+        const git_index_entry* entry = git_index_get_byindex(index.get(), i);
+        if (GIT_INDEX_ENTRY_STAGE(entry) != 0 || entry->mode == GIT_FILEMODE_COMMIT)
+        {
+            continue;
+        }
+
+        const bool included = !sparse || sparse->includes(entry->path);
+        const bool skipped = (entry->flags_extended & GIT_INDEX_ENTRY_SKIP_WORKTREE) != 0;
+        if (included && skipped)
+        {
+            // A file created in the meantime is kept, the status shows how it differs.
+            if (!stats.worktree_mode(entry->path))
+            {
+                written_paths.push_back(entry->path);
+            }
+        }
+        else if (!included && !skipped)
+        {
+            if (stats.state(entry->path) == stat_cache::file_state::modified)
+            {
+                left_paths.push_back(entry->path);
+                continue;
+            }
+            const std::string path = workdir + entry->path;
+            if (::unlink(path.c_str()) != 0 && errno != ENOENT)
+            {
+                throw git_exception(
+                    "could not remove '" + std::string(entry->path) + "'",
+                    git2cpp_error_code::FILESYSTEM_ERROR
+                );
+            }
+            for (auto dir = std::filesystem::path(entry->path).parent_path(); !dir.empty();
+                 dir = dir.parent_path())
+            {
+                emptied_directories.insert(dir.string());
+            }
+        }
+        else
+        {
+            continue;
+        }
+
+        git_index_entry copy = *entry;
+        copy.flags_extended ^= GIT_INDEX_ENTRY_SKIP_WORKTREE;
+        updated.push_back(copy);
+        updated_paths.push_back(entry->path);
+    }
+
+    for (const auto& dir : emptied_directories)
+    {
+        ::rmdir((workdir + dir).c_str());
+    }
+    if (updated.empty())
+    {
+        return left_paths;
+    }
+
+    // The paths of the entries are copied first, git_index_add may reallocate the entries.
+    for (size_t i = 0; i < updated.size(); ++i)
+    {
+        updated[i].path = updated_paths[i].c_str();
+        throw_if_error(git_index_add(index.get(), &updated[i]));
+    }
+    throw_if_error(git_index_write(index.get()));
+    trace::add("sparse checkout updated entries", updated.size());
+
+    if (!written_paths.empty())
+    {
+        git_strarray_wrapper paths(written_paths);
+        git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+        opts.checkout_strategy = GIT_CHECKOUT_FORCE | GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
+        opts.paths = *static_cast<git_strarray*>(paths);
+        throw_if_error(git_checkout_index(repo, index.get(), &opts));
+    }
+    return left_paths;
+}
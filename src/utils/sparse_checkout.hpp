@@ -0,0 +1,57 @@
+#pragma once
+
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <git2.h>
+
+/**
+ * Cone-mode patterns of a sparse checkout, read from and written to <git_dir>/info/sparse-checkout
+ * in the format of git. The files of the root directory are always checked out, along with every
+ * file below the directories of the cone and the files directly in their parent directories.
+ *
+ * The index entries of the other files have the skip-worktree flag and no file in the worktree:
+ * checkout_tree does not write them, and status and add do not report or stage them as deleted.
+ * Since the excluded directories do not exist, the scans of the worktree do not go through them.
+ */
+class sparse_checkout
+{
+public:
+
+    // Patterns of the repository, nullopt if core.sparseCheckout is not set or if the patterns are not
+    // in cone mode, which is the only mode supported.
+    static std::optional<sparse_checkout> load(git_repository* repo);
+
+    static std::string file_path(const std::string& git_dir);
+
+    explicit sparse_checkout(const std::vector<std::string>& directories = {});
+
+    // Whether the file at path (relative to the worktree) is checked out.
+    bool includes(std::string_view path) const;
+
+    // Directories of the cone, recursively checked out, in alphabetical order.
+    std::vector<std::string> directories() const;
+
+    void add(const std::vector<std::string>& directories);
+    void store(const std::string& git_dir) const;
+
+private:
+
+    void add_directory(std::string directory);
+    // Whether the directory is one of the cone or below one.
+    bool is_in_cone(std::string_view directory) const;
+
+    std::set<std::string> m_recursive;
+    std::set<std::string> m_parents;
+};
+
+/**
+ * Make the worktree match the patterns, or check out every file when sparse is null: the included
+ * files whose entry has the skip-worktree flag are written, and the excluded unmodified files are
+ * removed and get the flag. The excluded files with local changes are left in place; their paths
+ * are returned.
+ */
+std::vector<std::string> apply_sparse_checkout(git_repository* repo, const sparse_checkout* sparse);
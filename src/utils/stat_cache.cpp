@@ -0,0 +1,246 @@
+#include "stat_cache.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "git_exception.hpp"
+#include "trace.hpp"
+
+namespace
+{
+    git_index_time to_index_time(const struct timespec& ts)
+    {
+        return {int32_t(ts.tv_sec), uint32_t(ts.tv_nsec)};
+    }
+
+    // Nanoseconds are only compared when the index has them, libgit2 may be built without.
+    bool same_time(const git_index_time& index_time, const git_index_time& file_time)
+    {
+        return index_time.seconds == file_time.seconds
+               && (index_time.nanoseconds == 0 || index_time.nanoseconds == file_time.nanoseconds);
+    }
+
+    bool not_older(const git_index_time& lhs, const git_index_time& rhs)
+    {
+        return lhs.seconds > rhs.seconds
+               || (lhs.seconds == rhs.seconds && lhs.nanoseconds >= rhs.nanoseconds);
+    }
+
+    uint32_t canonical_mode(mode_t mode)
+    {
+        if (S_ISLNK(mode))
+        {
+            return GIT_FILEMODE_LINK;
+        }
+        if (S_ISDIR(mode))
+        {
+            return GIT_FILEMODE_TREE;
+        }
+        return (mode & S_IXUSR) ? GIT_FILEMODE_BLOB_EXECUTABLE : GIT_FILEMODE_BLOB;
+    }
+
+    bool config_bool(git_config* config, const char* name, bool default_value)
+    {
+        int value = 0;
+        return git_config_get_bool(&value, config, name) == 0 ? value != 0 : default_value;
+    }
+}
+
+stat_cache::stat_cache(git_repository* repo)
+    : p_repo(repo)
+{
+    throw_if_error(git_repository_index(&p_index, repo));
+    if (const char* workdir = git_repository_workdir(repo))
+    {
+        m_workdir = workdir;
+    }
+
+    git_config* config = nullptr;
+    if (git_repository_config_snapshot(&config, repo) == 0)
+    {
+        m_trust_ctime = config_bool(config, "core.trustctime", true);
+        m_trust_mode = config_bool(config, "core.filemode", true);
+        git_config_free(config);
+    }
+
+    struct stat st;
+    if (const char* index_path = git_index_path(p_index); index_path && ::lstat(index_path, &st) == 0)
+    {
+#ifdef __APPLE__
+        m_index_mtime = to_index_time(st.st_mtimespec);
+#else
+        m_index_mtime = to_index_time(st.st_mtim);
+#endif
+    }
+}
+
+stat_cache::~stat_cache()
+{
+    git_index_free(p_index);
+    p_index = nullptr;
+}
+
+bool stat_cache::is_tracked(const std::string& path) const
+{
+    return git_index_find(nullptr, p_index, path.c_str()) == 0;
+}
+
+bool stat_cache::is_skipped(const std::string& path) const
+{
+    const git_index_entry* entry = git_index_get_bypath(p_index, path.c_str(), 0);
+    return entry && (entry->flags_extended & GIT_INDEX_ENTRY_SKIP_WORKTREE) != 0;
+}
+
+stat_cache::file_state stat_cache::state(const std::string& path)
+{
+    const git_index_entry* entry = git_index_get_bypath(p_index, path.c_str(), 0);
+    if (!entry)
+    {
+        return is_tracked(path) ? file_state::modified : file_state::untracked;
+    }
+    if (entry->flags_extended & GIT_INDEX_ENTRY_SKIP_WORKTREE)
+    {
+        return file_state::unmodified;
+    }
+
+    const auto& st = lstat(path);
+    if (!st)
+    {
+        return file_state::deleted;
+    }
+
+    // Submodules have a status of their own, their directory is all that is checked here.
+    if (entry->mode == GIT_FILEMODE_COMMIT)
+    {
+        return st->mode == GIT_FILEMODE_TREE ? file_state::unmodified : file_state::modified;
+    }
+    const bool same_type = (st->mode == GIT_FILEMODE_LINK) == (entry->mode == GIT_FILEMODE_LINK)
+                           && st->mode != GIT_FILEMODE_TREE;
+    if (!same_type || (m_trust_mode && st->mode != entry->mode))
+    {
+        return file_state::modified;
+    }
+    // An entry with a null size was smudged by a racy write of the index, its size is unknown.
+    if (uint32_t(st->size) != entry->file_size && entry->file_size != 0)
+    {
+        return file_state::modified;
+    }
+
+    const bool same_stat = uint32_t(st->size) == entry->file_size && same_time(entry->mtime, st->mtime)
+                           && (!m_trust_ctime || same_time(entry->ctime, st->ctime))
+                           && uint32_t(st->ino) == entry->ino;
+    if (same_stat && !is_racily_clean(*entry))
+    {
+        return file_state::unmodified;
+    }
+
+    trace::add("stat cache verifications");
+    if (!has_same_content(*entry, path, *st))
+    {
+        return file_state::modified;
+    }
+
+    // The path points to the key of the cached stat data, which is never erased.
+    git_index_entry refreshed = *entry;
+    refreshed.ctime = st->ctime;
+    refreshed.mtime = st->mtime;
+    refreshed.file_size = uint32_t(st->size);
+    refreshed.ino = uint32_t(st->ino);
+    refreshed.path = m_stats.find(path)->first.c_str();
+    m_refreshed.push_back(refreshed);
+    return file_state::unmodified;
+}
+
+std::optional<uint32_t> stat_cache::worktree_mode(const std::string& path)
+{
+    const auto& st = lstat(path);
+    return st ? std::optional<uint32_t>(st->mode) : std::nullopt;
+}
+
+std::vector<std::string> stat_cache::changed_paths(file_state state)
+{
+    std::vector<std::string> paths;
+    const size_t entry_count = git_index_entrycount(p_index);
+    for (size_t i = 0; i < entry_count; ++i)
+    {
+        const git_index_entry* entry = git_index_get_byindex(p_index, i);
+        if (GIT_INDEX_ENTRY_STAGE(entry) == 0 && this->state(entry->path) == state)
+        {
+            paths.push_back(entry->path);
+        }
+    }
+    return paths;
+}
+
+void stat_cache::refresh()
+{
+    if (m_refreshed.empty())
+    {
+        return;
+    }
+    std::vector<git_index_entry> refreshed;
+    refreshed.swap(m_refreshed);
+    for (const auto& entry : refreshed)
+    {
+        if (git_index_add(p_index, &entry) < 0)
+        {
+            // Read the index file again to drop the entries already added: all or none are.
+            git_index_read(p_index, true);
+            return;
+        }
+    }
+    trace::add("stat cache refreshed entries", refreshed.size());
+    git_index_write(p_index);
+}
+
+const std::optional<stat_cache::file_stat>& stat_cache::lstat(const std::string& path)
+{
+    auto [it, inserted] = m_stats.try_emplace(path);
+    if (inserted)
+    {
+        trace::add("stat cache lstat calls");
+        struct stat st;
+        if (::lstat((m_workdir + path).c_str(), &st) == 0)
+        {
+#ifdef __APPLE__
+            const git_index_time ctime = to_index_time(st.st_ctimespec);
+            const git_index_time mtime = to_index_time(st.st_mtimespec);
+#else
+            const git_index_time ctime = to_index_time(st.st_ctim);
+            const git_index_time mtime = to_index_time(st.st_mtim);
+#endif
+            const uint32_t mode = canonical_mode(st.st_mode);
+            it->second = file_stat{ctime, mtime, uint64_t(st.st_size), uint64_t(st.st_ino), mode};
+        }
+    }
+    return it->second;
+}
+
+bool stat_cache::is_racily_clean(const git_index_entry& entry) const
+{
+    return !m_index_mtime || not_older(entry.mtime, *m_index_mtime);
+}
+
+bool stat_cache::has_same_content(
+    const git_index_entry& entry,
+    const std::string& path,
+    const file_stat& st
+) const
+{
+    const std::string full_path = m_workdir + path;
+    git_oid id;
+    if (st.mode == GIT_FILEMODE_LINK)
+    {
+        std::string target(st.size, '\0');
+        const ssize_t size = readlink(full_path.c_str(), target.data(), target.size());
+        if (size < 0 || git_odb_hash(&id, target.data(), size_t(size), GIT_OBJECT_BLOB) < 0)
+        {
+            return false;
+        }
+    }
+    else if (git_repository_hashfile(&id, p_repo, full_path.c_str(), GIT_OBJECT_BLOB, path.c_str()) < 0)
+    {
+        return false;
+    }
+    return git_oid_equal(&id, &entry.id);
+}
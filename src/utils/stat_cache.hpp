@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <git2.h>
+
+#include "common.hpp"
+
+/**
+ * Worktree checks of the tracked files answered from the index and one lstat per path, shared by
+ * the commands of a repository instead of a status scan or a git_status_file call per path.
+ *
+ * A file is unmodified if its stat data (mtime, ctime, size, inode and mode) matches the one of its
+ * index entry. An entry whose mtime is not older than the index file is racily clean: the file may
+ * have changed again in the same timestamp after the index was written, so its content is hashed.
+ * The entries found unchanged that way get the stat data of the file, and refresh() writes them to
+ * the index so that the next commands do not hash them again.
+ *
+ * The stat data of a path is read once: the cache is meant for the checks made before a command
+ * changes the worktree.
+ */
+class stat_cache : private noncopyable_nonmovable
+{
+public:
+
+    enum class file_state
+    {
+        untracked,
+        unmodified,
+        modified,
+        deleted,
+    };
+
+    explicit stat_cache(git_repository* repo);
+    ~stat_cache();
+
+    // Whether path (relative to the worktree) is in the index, conflicted paths included.
+    bool is_tracked(const std::string& path) const;
+
+    // Whether the entry of path has the skip-worktree flag: it is outside of the sparse checkout and
+    // has no file in the worktree.
+    bool is_skipped(const std::string& path) const;
+
+    // State of the file at path in the worktree compared with its index entry, conflicted paths
+    // are modified and skipped ones unmodified.
+    file_state state(const std::string& path);
+
+    // Canonical mode of the file at path in the worktree (GIT_FILEMODE_TREE for a directory),
+    // nullopt if there is none.
+    std::optional<uint32_t> worktree_mode(const std::string& path);
+
+    // Paths of the index entries whose file is modified or deleted, in the order of the index.
+    std::vector<std::string> changed_paths(file_state state);
+
+    // Store the stat data of the racily clean entries found unchanged in the index and write it.
+    // The cache is only an optimization, so this is best effort: if an entry cannot be stored, the
+    // index is read again from its file without any of them, and a failed write is ignored. Any
+    // other change of the index not written yet is dropped as well in that case.
+    void refresh();
+
+private:
+
+    struct file_stat
+    {
+        git_index_time ctime;
+        git_index_time mtime;
+        uint64_t size;
+        uint64_t ino;
+        uint32_t mode;
+    };
+
+    const std::optional<file_stat>& lstat(const std::string& path);
+    bool is_racily_clean(const git_index_entry& entry) const;
+    bool has_same_content(const git_index_entry& entry, const std::string& path, const file_stat& st) const;
+
+    git_repository* p_repo;
+    git_index* p_index = nullptr;
+    std::string m_workdir;
+    bool m_trust_ctime = true;
+    bool m_trust_mode = true;
+    std::optional<git_index_time> m_index_mtime;
+
+    std::unordered_map<std::string, std::optional<file_stat>> m_stats;
+    std::vector<git_index_entry> m_refreshed;
+};
@@ -0,0 +1,249 @@
+#include "status_cache.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <ostream>
+
+#include <sys/stat.h>
+
+static constexpr const char* cache_signature = "git2cpp status cache 1";
+static constexpr int64_t nanoseconds_per_second = 1000000000;
+
+namespace
+{
+    struct file_stamp
+    {
+        int64_t mtime = 0;
+        int64_t ctime = 0;
+        uint64_t size = 0;
+        uint64_t inode = 0;
+        uint32_t mode = 0;
+
+        bool operator==(const file_stamp&) const = default;
+    };
+
+    int64_t to_nanoseconds(const struct timespec& ts)
+    {
+        return int64_t(ts.tv_sec) * nanoseconds_per_second + ts.tv_nsec;
+    }
+
+    // A missing path gets a null stamp, so that its creation is detected as well.
+    file_stamp make_stamp(const std::string& path)
+    {
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0)
+        {
+            return {};
+        }
+#ifdef __APPLE__
+        const int64_t mtime = to_nanoseconds(st.st_mtimespec);
+        const int64_t ctime = to_nanoseconds(st.st_ctimespec);
+#else
+        const int64_t mtime = to_nanoseconds(st.st_mtim);
+        const int64_t ctime = to_nanoseconds(st.st_ctim);
+#endif
+        return {mtime, ctime, uint64_t(st.st_size), uint64_t(st.st_ino), uint32_t(st.st_mode)};
+    }
+
+    // Strings are written as "<size>:<bytes>" so that paths may hold any character.
+    void write_string(std::ostream& os, const std::string& str)
+    {
+        os << str.size() << ':' << str;
+    }
+
+    bool read_string(std::istream& is, std::string& str)
+    {
+        size_t size = 0;
+        if (!(is >> size) || is.get() != ':')
+        {
+            return false;
+        }
+        str.resize(size);
+        return bool(is.read(str.data(), std::streamsize(size)));
+    }
+
+    void write_file(std::ostream& os, const git_diff_file& file)
+    {
+        char oid[GIT_OID_HEXSZ + 1];
+        git_oid_tostr(oid, sizeof(oid), &file.id);
+        os << ' ' << oid << ' ' << file.mode << ' ' << file.size << ' ' << file.flags << ' ';
+        write_string(os, file.path ? file.path : "");
+    }
+
+    bool read_file(std::istream& is, git_diff_file& file, std::string& path)
+    {
+        std::string oid;
+        if (!(is >> oid >> file.mode >> file.size >> file.flags) || is.get() != ' ' || !read_string(is, path))
+        {
+            return false;
+        }
+        if (git_oid_fromstrn(&file.id, oid.data(), oid.size()) != 0)
+        {
+            return false;
+        }
+        file.id_abbrev = uint16_t(oid.size());
+        file.path = path.c_str();
+        return true;
+    }
+
+    void write_delta(std::ostream& os, const git_diff_delta* delta)
+    {
+        if (!delta)
+        {
+            os << " 0";
+            return;
+        }
+        os << " 1 " << delta->status << ' ' << delta->flags << ' ' << delta->similarity << ' '
+           << delta->nfiles;
+        write_file(os, delta->old_file);
+        write_file(os, delta->new_file);
+    }
+
+    // paths holds the old and new paths of the delta, target is set to the delta if it is present.
+    bool read_delta(std::istream& is, git_diff_delta& delta, std::string* paths, git_diff_delta*& target)
+    {
+        int present = 0;
+        if (!(is >> present))
+        {
+            return false;
+        }
+        if (!present)
+        {
+            target = nullptr;
+            return true;
+        }
+
+        int status = 0;
+        if (!(is >> status >> delta.flags >> delta.similarity >> delta.nfiles))
+        {
+            return false;
+        }
+        delta.status = git_delta_t(status);
+        target = &delta;
+        return read_file(is, delta.old_file, paths[0]) && read_file(is, delta.new_file, paths[1]);
+    }
+}
+
+std::string status_cache::file_path(const std::string& git_dir)
+{
+    return (std::filesystem::path(git_dir) / "git2cpp" / "status-cache").string();
+}
+
+int64_t status_cache::now()
+{
+    const auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
+}
+
+std::optional<status_cache::entry_list> status_cache::load(const std::string& path, const std::string& key)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    std::string stored_key;
+    if (!std::getline(file, line) || line != cache_signature || !read_string(file, stored_key)
+        || stored_key != key)
+    {
+        return std::nullopt;
+    }
+
+    // A missing or truncated cache is not an error, the status is just computed again.
+    size_t stamp_count = 0;
+    file >> stamp_count;
+    std::string watched_path;
+    for (size_t i = 0; i < stamp_count; ++i)
+    {
+        file_stamp stamp;
+        if (!(file >> stamp.mtime >> stamp.ctime >> stamp.size >> stamp.inode >> stamp.mode)
+            || file.get() != ' ' || !read_string(file, watched_path))
+        {
+            return std::nullopt;
+        }
+        if (make_stamp(watched_path) != stamp)
+        {
+            return std::nullopt;
+        }
+    }
+
+    size_t entry_count = 0;
+    if (!(file >> entry_count))
+    {
+        return std::nullopt;
+    }
+
+    entry_list entries;
+    for (size_t i = 0; i < entry_count; ++i)
+    {
+        // Elements of a deque are never moved by emplace_back, the pointers to their members
+        // remain valid.
+        entry& e = entries.emplace_back();
+        unsigned int status = 0;
+        if (!(file >> status) || !read_delta(file, e.head_to_index, &e.paths[0], e.status_entry.head_to_index)
+            || !read_delta(file, e.index_to_workdir, &e.paths[2], e.status_entry.index_to_workdir))
+        {
+            return std::nullopt;
+        }
+        e.status_entry.status = git_status_t(status);
+    }
+    return entries;
+}
+
+void status_cache::store(
+    const std::string& path,
+    const std::string& key,
+    int64_t scan_start,
+    const std::vector<std::string>& watched_paths,
+    const std::vector<const git_status_entry*>& entries
+)
+{
+    const int64_t racy_limit = scan_start - scan_start % nanoseconds_per_second;
+
+    std::vector<file_stamp> stamps;
+    stamps.reserve(watched_paths.size());
+    for (const auto& watched_path : watched_paths)
+    {
+        stamps.push_back(make_stamp(watched_path));
+        if (stamps.back().mtime >= racy_limit || stamps.back().ctime >= racy_limit)
+        {
+            return;
+        }
+    }
+
+    // The cache is only an optimization: when it cannot be written (read-only repository, ...),
+    // the next status is computed from scratch.
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    const std::string lock_path = path + ".lock";
+    {
+        std::ofstream file(lock_path, std::ios::binary | std::ios::trunc);
+        file << cache_signature << '\n';
+        write_string(file, key);
+        file << '\n' << stamps.size() << '\n';
+        for (size_t i = 0; i < stamps.size(); ++i)
+        {
+            const auto& stamp = stamps[i];
+            file << stamp.mtime << ' ' << stamp.ctime << ' ' << stamp.size << ' ' << stamp.inode << ' '
+                 << stamp.mode << ' ';
+            write_string(file, watched_paths[i]);
+            file << '\n';
+        }
+
+        file << entries.size() << '\n';
+        for (const auto* entry : entries)
+        {
+            file << entry->status;
+            write_delta(file, entry->head_to_index);
+            write_delta(file, entry->index_to_workdir);
+            file << '\n';
+        }
+
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(lock_path, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(lock_path, path, ec);
+}
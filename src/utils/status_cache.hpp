@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <git2.h>
+
+/**
+ * Snapshot of a status scan, stored in the git directory (git2cpp/status-cache), holding the
+ * status entries and the stat data of every path the scan depends on: the index, HEAD and the
+ * config and exclude files, every non-ignored directory of the worktree (their mtime changes when
+ * an entry is added or removed) and every tracked or untracked file.
+ *
+ * While none of these paths changed, the status entries can be reused without walking the worktree
+ * nor reading the index, which only costs one lstat per path.
+ */
+class status_cache
+{
+public:
+
+    // Status entry read from the cache, owning the deltas and the paths it points to.
+    struct entry
+    {
+        git_status_entry status_entry;
+        git_diff_delta head_to_index;
+        git_diff_delta index_to_workdir;
+        std::string paths[4];
+    };
+
+    using entry_list = std::deque<entry>;
+
+    static std::string file_path(const std::string& git_dir);
+
+    // Nanoseconds since the epoch, to be taken before scanning and passed to store.
+    static int64_t now();
+
+    // Return the cached entries if the key is the stored one and no stored path changed.
+    static std::optional<entry_list> load(const std::string& path, const std::string& key);
+
+    // Paths modified during the second of the scan may change again without any visible stat
+    // change, in which case nothing is stored.
+    static void store(
+        const std::string& path,
+        const std::string& key,
+        int64_t scan_start,
+        const std::vector<std::string>& watched_paths,
+        const std::vector<const git_status_entry*>& entries
+    );
+};
@@ -1,8 +1,9 @@
+#include <algorithm>
 #include <cctype>
 #include <cstdint>
 #include <cstdio>
 #include <iostream>
-#include <ranges>
+#include <string_view>
 
 // OS-specific libraries.
 #include <sys/ioctl.h>
@@ -12,9 +13,19 @@
 #include "common.hpp"
 #include "input_output.hpp"
 #include "terminal_pager.hpp"
+#include "trace.hpp"
+
+// Maximum number of lines kept in memory once they have scrolled above the screen.
+static constexpr size_t max_buffered_lines = 10000;
+
+static bool pager_disabled = false;
 
 terminal_pager::terminal_pager()
-    : m_rows(0)
+    : m_cout_rdbuf(nullptr)
+    , m_producer(nullptr)
+    , m_producer_done(true)
+    , m_first_line_index(0)
+    , m_rows(0)
     , m_columns(0)
     , m_start_row_index(0)
 {
@@ -26,6 +37,52 @@ terminal_pager::~terminal_pager()
     release_cout();
 }
 
+void terminal_pager::drain_stringbuf()
+{
+    std::string_view text = m_stringbuf.view();
+    for (auto pos = text.find('\n'); pos != std::string_view::npos; pos = text.find('\n'))
+    {
+        m_partial_line.append(text.substr(0, pos));
+        m_lines.push_back(std::move(m_partial_line));
+        m_partial_line.clear();
+        text.remove_prefix(pos + 1);
+    }
+    m_partial_line.append(text);
+    m_stringbuf.str("");
+}
+
+void terminal_pager::fill_lines(size_t line_count)
+{
+    while (!m_producer_done && this->line_count() < line_count)
+    {
+        // Only redirect cout whilst the producer is writing, the pager itself writes to the terminal.
+        std::cout.rdbuf(&m_stringbuf);
+        m_producer_done = !(*m_producer)();
+        release_cout();
+        drain_stringbuf();
+    }
+
+    if (m_producer_done && !m_partial_line.empty())
+    {
+        m_lines.push_back(std::move(m_partial_line));
+        m_partial_line.clear();
+    }
+}
+
+size_t terminal_pager::line_count() const
+{
+    return m_first_line_index + m_lines.size();
+}
+
+void terminal_pager::trim_lines()
+{
+    while (m_lines.size() > max_buffered_lines && m_first_line_index < m_start_row_index)
+    {
+        m_lines.pop_front();
+        ++m_first_line_index;
+    }
+}
+
 std::string terminal_pager::get_input() const
 {
     // Blocks until input received.
@@ -46,10 +103,15 @@ std::string terminal_pager::get_input() const
     return str;
 }
 
+void terminal_pager::disable()
+{
+    pager_disabled = true;
+}
+
 void terminal_pager::maybe_grab_cout()
 {
     // Unfortunately need to access _internal namespace of termcolor to check if a tty.
-    if (termcolor::_internal::is_atty(std::cout))
+    if (!pager_disabled && termcolor::_internal::is_atty(std::cout))
     {
         // Should we do anything with cerr?
         m_cout_rdbuf = std::cout.rdbuf(&m_stringbuf);
@@ -116,11 +178,11 @@ void terminal_pager::render_terminal() const
 
     for (size_t i = m_start_row_index; i < end_row_index; i++)
     {
-        if (i >= m_lines.size())
+        if (i >= line_count())
         {
             break;
         }
-        std::cout << m_lines[i] << std::endl;
+        std::cout << m_lines[i - m_first_line_index] << std::endl;
     }
 
     std::cout << ansi_code::cursor_to_row(m_rows);  // Move cursor to bottom row of terminal.
@@ -136,23 +198,26 @@ void terminal_pager::scroll(bool up, bool page)
     if (up)
     {
         // Care needed to avoid underflow of unsigned size_t.
-        if (m_start_row_index >= offset)
+        // Lines before m_first_line_index have been discarded so cannot be scrolled back to.
+        if (m_start_row_index >= m_first_line_index + offset)
         {
             m_start_row_index -= offset;
         }
         else
         {
-            m_start_row_index = 0;
+            m_start_row_index = m_first_line_index;
         }
     }
     else
     {
         m_start_row_index += offset;
         auto end_row_index = m_start_row_index + m_rows - 1;
-        if (end_row_index > m_lines.size())
+        fill_lines(end_row_index);
+        if (end_row_index > line_count())
         {
-            m_start_row_index = m_lines.size() - (m_rows - 1);
+            m_start_row_index = std::max(line_count(), m_first_line_index + m_rows - 1) - (m_rows - 1);
         }
+        trim_lines();
     }
 
     if (m_start_row_index == old_start_row_index)
@@ -167,34 +232,69 @@ void terminal_pager::scroll(bool up, bool page)
 
 void terminal_pager::show()
 {
+    // All of the output has already been written to cout.
+    show(
+        []()
+        {
+            return false;
+        }
+    );
+}
+
+void terminal_pager::show(const producer_fn& producer)
+{
+    trace::scoped_timer timer("pager");
+    const bool grabbed_cout = std::cout.rdbuf() == &m_stringbuf;
     release_cout();
 
-    m_lines = split_input_at_newlines(m_stringbuf.view());
+    if (!grabbed_cout)
+    {
+        // Not a tty, the producer writes directly to cout.
+        while (producer())
+        {
+        }
+        return;
+    }
+
+    m_producer = &producer;
+    m_producer_done = false;
+    drain_stringbuf();
 
     update_terminal_size();
-    if (m_rows == 0 || m_lines.size() <= m_rows - 1)
+    // Reading one more line than fits on the screen tells if the pager is needed.
+    fill_lines(m_rows);
+    if (m_rows == 0 || line_count() <= m_rows - 1)
     {
         // Don't need to use pager, can display directly.
-        for (auto line : m_lines)
+        for (const auto& line : m_lines)
         {
             std::cout << line << std::endl;
         }
-        m_lines.clear();
-        return;
+        std::cout << m_partial_line;
+        while (!m_producer_done)
+        {
+            m_producer_done = !producer();
+        }
     }
+    else
+    {
+        alternative_buffer alt_buffer;
 
-    alternative_buffer alt_buffer;
-
-    m_start_row_index = 0;
-    render_terminal();
+        m_start_row_index = 0;
+        render_terminal();
 
-    bool stop = false;
-    do
-    {
-        stop = process_input(get_input());
-    } while (!stop);
+        bool stop = false;
+        do
+        {
+            stop = process_input(get_input());
+        } while (!stop);
+    }
 
+    m_producer = nullptr;
+    m_producer_done = true;
+    m_partial_line.clear();
     m_lines.clear();
+    m_first_line_index = 0;
     m_start_row_index = 0;
 }
 
@@ -1,17 +1,21 @@
 #pragma once
 
+#include <deque>
+#include <functional>
 #include <sstream>
-#include <vector>
+#include <string>
 
 /**
  * Terminal pager that displays output written to stdout one page at a time, allowing the user to
  * interactively scroll up and down. If cout is not a tty or the output is shorter than a single
  * terminal page it does nothing.
  *
- * It expects all of cout to be written before the first page is displayed, so it does not pipe from
- * cout which would be a more complicated implementation allowing the first page to be displayed
- * before all of the output is written. This may need to be reconsidered if we need more performant
- * handling of slow subcommands such as `git2cpp log` of repos with long histories.
+ * Output can either be written to cout before calling show(), or be generated incrementally by a
+ * producer passed to show(producer). The producer is called repeatedly, writing some output to cout
+ * each time, and returns false once there is nothing more to write. It is only called when more lines
+ * are needed to fill the screen, so the first page is displayed without waiting for all of the output
+ * and the producer is not called again after the user quits. Only a window of the most recent lines
+ * is kept in memory, scrolling up stops at the oldest line still held.
  *
  * Keys handled:
  *     d, space                   scroll down a page
@@ -36,8 +40,27 @@ public:
 
     void show();
 
+    // Return false when producer has no more output to write to cout.
+    using producer_fn = std::function<bool()>;
+
+    void show(const producer_fn& producer);
+
+    // Never page the output from now on, for instance because it is captured (batch mode).
+    static void disable();
+
 private:
 
+    // Move the complete lines written to m_stringbuf into m_lines.
+    void drain_stringbuf();
+
+    // Call the producer until there are at least line_count lines, or no more output.
+    void fill_lines(size_t line_count);
+
+    size_t line_count() const;
+
+    // Drop lines that are above the screen and beyond the window of lines kept in memory.
+    void trim_lines();
+
     std::string get_input() const;
 
     void maybe_grab_cout();
@@ -56,7 +79,11 @@ private:
 
     std::stringbuf m_stringbuf;
     std::streambuf* m_cout_rdbuf;
-    std::vector<std::string> m_lines;
+    const producer_fn* m_producer;
+    bool m_producer_done;
+    std::string m_partial_line;
+    std::deque<std::string> m_lines;
+    size_t m_first_line_index;  // Index of the first line in m_lines.
     size_t m_rows, m_columns;
     size_t m_start_row_index;
 };
@@ -0,0 +1,243 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    struct trace_event
+    {
+        const char* phase;
+        clock_type::time_point start;
+        clock_type::duration duration;
+        size_t thread_index;
+    };
+
+    struct phase_total
+    {
+        std::string_view phase;
+        clock_type::duration duration{};
+        size_t calls = 0;
+    };
+
+    std::mutex trace_mutex;
+    clock_type::time_point trace_start;
+    std::string trace_file;
+    std::vector<trace_event> events;
+    std::map<std::string, uint64_t, std::less<>> counters;
+
+    // Small thread numbers are easier to read in the trace viewers than thread ids.
+    size_t thread_index()
+    {
+        static std::atomic<size_t> thread_count = 0;
+        thread_local const size_t index = thread_count++;
+        return index;
+    }
+
+    uint64_t& counter(std::string_view name)
+    {
+        auto it = counters.find(name);
+        if (it == counters.end())
+        {
+            it = counters.emplace(std::string(name), 0).first;
+        }
+        return it->second;
+    }
+
+    double to_milliseconds(clock_type::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    int64_t to_microseconds(clock_type::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
+    // Phase and counter names are plain identifiers, but escape them anyway.
+    void write_json_string(std::ostream& os, std::string_view str)
+    {
+        os << '"';
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                os << '\\';
+            }
+            os << c;
+        }
+        os << '"';
+    }
+
+    void write_chrome_trace(std::ostream& os, clock_type::time_point end)
+    {
+        os << "{\"traceEvents\":[\n";
+        for (const auto& event : events)
+        {
+            os << "{\"name\":";
+            write_json_string(os, event.phase);
+            os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread_index
+               << ",\"ts\":" << to_microseconds(event.start - trace_start)
+               << ",\"dur\":" << to_microseconds(event.duration) << "},\n";
+        }
+        for (const auto& [name, value] : counters)
+        {
+            os << "{\"name\":";
+            write_json_string(os, name);
+            os << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << to_microseconds(end - trace_start)
+               << ",\"args\":{\"value\":" << value << "}},\n";
+        }
+        os << "{\"name\":\"git2cpp\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":0,\"dur\":"
+           << to_microseconds(end - trace_start) << "}\n]}\n";
+    }
+}
+
+void trace::enable()
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (!enabled())
+    {
+        trace_start = clock_type::now();
+        s_enabled = true;
+    }
+}
+
+struct trace::command_scope::state
+{
+    bool enabled;
+    clock_type::time_point start;
+    std::string file;
+    std::vector<trace_event> events;
+    std::map<std::string, uint64_t, std::less<>> counters;
+};
+
+trace::command_scope::command_scope()
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    m_outer = std::make_unique<state>(
+        state{enabled(), trace_start, std::move(trace_file), std::move(events), std::move(counters)}
+    );
+    s_enabled = false;
+    trace_file.clear();
+    events.clear();
+    counters.clear();
+}
+
+trace::command_scope::~command_scope()
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    s_enabled = m_outer->enabled;
+    trace_start = m_outer->start;
+    trace_file = std::move(m_outer->file);
+    events = std::move(m_outer->events);
+    counters = std::move(m_outer->counters);
+}
+
+void trace::enable_from_environment()
+{
+    const char* value = std::getenv("GIT2CPP_TRACE");
+    if (!value || *value == '\0' || std::string_view(value) == "0")
+    {
+        return;
+    }
+    if (std::string_view(value) != "1")
+    {
+        trace_file = value;
+    }
+    enable();
+}
+
+void trace::add_impl(std::string_view name, uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    counter(name) += value;
+}
+
+void trace::set_max_impl(std::string_view name, uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    uint64_t& current = counter(name);
+    current = std::max(current, value);
+}
+
+void trace::record(const char* phase, clock_type::time_point start, clock_type::time_point end)
+{
+    const size_t index = thread_index();
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    events.push_back({phase, start, end - start, index});
+}
+
+void trace::report()
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    const auto end = clock_type::now();
+
+    // Phases are listed in the order they were first entered.
+    std::vector<phase_total> totals;
+    for (const auto& event : events)
+    {
+        auto it = std::find_if(
+            totals.begin(),
+            totals.end(),
+            [&event](const phase_total& total)
+            {
+                return total.phase == event.phase;
+            }
+        );
+        if (it == totals.end())
+        {
+            it = totals.insert(it, {event.phase});
+        }
+        it->duration += event.duration;
+        ++it->calls;
+    }
+
+    std::cerr << "timings:\n" << std::fixed << std::setprecision(3);
+    for (const auto& total : totals)
+    {
+        std::cerr << "  " << std::left << std::setw(24) << total.phase << std::right << std::setw(12)
+                  << to_milliseconds(total.duration) << " ms";
+        if (total.calls > 1)
+        {
+            std::cerr << "  (" << total.calls << " calls)";
+        }
+        std::cerr << '\n';
+    }
+    std::cerr << "  " << std::left << std::setw(24) << "total" << std::right << std::setw(12)
+              << to_milliseconds(end - trace_start) << " ms\n";
+
+    if (!counters.empty())
+    {
+        std::cerr << "counters:\n";
+        for (const auto& [name, value] : counters)
+        {
+            std::cerr << "  " << std::left << std::setw(24) << name << std::right << std::setw(12) << value
+                      << '\n';
+        }
+    }
+    std::cerr << std::defaultfloat << std::flush;
+
+    if (!trace_file.empty())
+    {
+        std::ofstream file(trace_file);
+        write_chrome_trace(file, end);
+        if (!file)
+        {
+            std::cerr << "warning: could not write the trace to " << trace_file << std::endl;
+        }
+    }
+}
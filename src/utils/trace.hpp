@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "common.hpp"
+
+/**
+ * Instrumentation of the hot paths: scoped timers for the phases of a command (repository open,
+ * index load, status scan, diff generation, pager, ...) and named counters (object lookups, commits
+ * walked, bytes received or written, ...).
+ *
+ * Tracing is enabled by the global --timings flag or the GIT2CPP_TRACE environment variable, in
+ * which case report() writes the time spent in each phase and the counters to stderr. If
+ * GIT2CPP_TRACE is set to a file path rather than 1, the phases and counters are also written to
+ * this file in the Chrome trace event format, which can be loaded in chrome://tracing or Perfetto.
+ *
+ * When tracing is disabled, timers and counters only cost the test of a flag.
+ *
+ * The commands run by batch each get a command_scope: their own --timings flag enables tracing for
+ * them only, and their report is written to their own stderr.
+ */
+class trace
+{
+public:
+
+    static bool enabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static void enable();
+
+    // Enable tracing if GIT2CPP_TRACE is set (and not 0).
+    static void enable_from_environment();
+
+    static void add(std::string_view counter, uint64_t value = 1)
+    {
+        if (enabled())
+        {
+            add_impl(counter, value);
+        }
+    }
+
+    // For counters reporting a running total, such as the bytes received by a fetch.
+    static void set_max(std::string_view counter, uint64_t value)
+    {
+        if (enabled())
+        {
+            set_max_impl(counter, value);
+        }
+    }
+
+    // Write the report, once all the phases are done.
+    static void report();
+
+    // Tracing of a command run inside another one. Tracing starts disabled, without phases or
+    // counters, and the state of the outer command is restored when the scope ends.
+    class command_scope : private noncopyable_nonmovable
+    {
+    public:
+
+        command_scope();
+        ~command_scope();
+
+    private:
+
+        struct state;
+        std::unique_ptr<state> m_outer;
+    };
+
+    class scoped_timer : private noncopyable_nonmovable
+    {
+    public:
+
+        // phase must be a string literal, it is not copied.
+        explicit scoped_timer(const char* phase)
+            : m_phase(enabled() ? phase : nullptr)
+        {
+            if (m_phase)
+            {
+                m_start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~scoped_timer()
+        {
+            if (m_phase)
+            {
+                record(m_phase, m_start, std::chrono::steady_clock::now());
+            }
+        }
+
+    private:
+
+        const char* m_phase;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+private:
+
+    static void add_impl(std::string_view counter, uint64_t value);
+    static void set_max_impl(std::string_view counter, uint64_t value);
+    static void record(
+        const char* phase,
+        std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point end
+    );
+
+    static inline std::atomic<bool> s_enabled = false;
+};
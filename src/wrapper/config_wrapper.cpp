@@ -20,6 +20,42 @@ git_config_entry* config_wrapper::get_entry(std::string name)
     return entry;
 }
 
+bool config_wrapper::get_bool(std::string name, bool default_value)
+{
+    int value;
+    int error = git_config_get_bool(&value, *this, name.c_str());
+    if (error == GIT_ENOTFOUND)
+    {
+        return default_value;
+    }
+    throw_if_error(error);
+    return value != 0;
+}
+
+int config_wrapper::get_int(std::string name, int default_value)
+{
+    int32_t value;
+    int error = git_config_get_int32(&value, *this, name.c_str());
+    if (error == GIT_ENOTFOUND)
+    {
+        return default_value;
+    }
+    throw_if_error(error);
+    return value;
+}
+
+int64_t config_wrapper::get_int64(std::string name, int64_t default_value)
+{
+    int64_t value;
+    int error = git_config_get_int64(&value, *this, name.c_str());
+    if (error == GIT_ENOTFOUND)
+    {
+        return default_value;
+    }
+    throw_if_error(error);
+    return value;
+}
+
 void config_wrapper::set_entry(std::string name, std::string value)
 {
     throw_if_error(git_config_set_string(*this, name.c_str(), value.c_str()));
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include <git2.h>
@@ -18,6 +19,11 @@ public:
     config_wrapper& operator=(config_wrapper&&) noexcept = default;
 
     git_config_entry* get_entry(std::string name);
+    // Return default_value if the entry does not exist.
+    bool get_bool(std::string name, bool default_value);
+    int get_int(std::string name, int default_value);
+    // Accepts the k, m and g suffixes.
+    int64_t get_int64(std::string name, int64_t default_value);
     void set_entry(std::string name, std::string value);
     void delete_entry(std::string name);
 
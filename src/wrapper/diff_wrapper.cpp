@@ -1,6 +1,7 @@
 #include "../wrapper/diff_wrapper.hpp"
 
 #include "../utils/git_exception.hpp"
+#include "../utils/trace.hpp"
 
 diff_wrapper::diff_wrapper(git_diff* diff)
     : base_type(diff)
@@ -15,16 +16,20 @@ diff_wrapper::~diff_wrapper()
 
 void diff_wrapper::find_similar(git_diff_find_options* find_opts)
 {
+    trace::scoped_timer timer("rename detection");
     throw_if_error(git_diff_find_similar(p_resource, find_opts));
 }
 
 void diff_wrapper::print(git_diff_format_t format, git_diff_line_cb print_cb, void* payload)
 {
+    trace::scoped_timer timer("diff output");
+    trace::add("diff deltas", git_diff_num_deltas(p_resource));
     throw_if_error(git_diff_print(p_resource, format, print_cb, payload));
 }
 
 diffstats_wrapper diff_wrapper::get_stats() const
 {
+    trace::scoped_timer timer("diff stats");
     git_diff_stats* stats;
     throw_if_error(git_diff_get_stats(&stats, *this));
     return diffstats_wrapper(stats);
@@ -2,57 +2,274 @@
 
 #include <algorithm>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
+#include <sys/stat.h>
+
 #include <git2/index.h>
 
 #include "../utils/common.hpp"
 #include "../utils/git_exception.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 
+namespace
+{
+    int count_matched_path(const char*, const char*, void* payload)
+    {
+        ++*static_cast<size_t*>(payload);
+        return 0;
+    }
+
+    struct diff_deleter
+    {
+        void operator()(git_diff* diff) const
+        {
+            git_diff_free(diff);
+        }
+    };
+
+    git_index_time index_time(const struct timespec& time)
+    {
+        return {static_cast<int32_t>(time.tv_sec), static_cast<uint32_t>(time.tv_nsec)};
+    }
+
+    // Same stat data as libgit2 stores for an entry, so that the file is not hashed again by the next
+    // status.
+    void set_stat_data(git_index_entry& entry, const struct stat& st)
+    {
+#ifdef __APPLE__
+        entry.ctime = index_time(st.st_ctimespec);
+        entry.mtime = index_time(st.st_mtimespec);
+#else
+        entry.ctime = index_time(st.st_ctim);
+        entry.mtime = index_time(st.st_mtim);
+#endif
+        entry.dev = static_cast<uint32_t>(st.st_dev);
+        entry.ino = static_cast<uint32_t>(st.st_ino);
+        entry.uid = static_cast<uint32_t>(st.st_uid);
+        entry.gid = static_cast<uint32_t>(st.st_gid);
+        entry.file_size = static_cast<uint32_t>(st.st_size);
+    }
+
+    // Same content as git_blob_create_from_workdir, with the filters of filter_repo, but written in
+    // the object database of odb_repo.
+    int create_blob_through(
+        git_oid* id,
+        git_repository* filter_repo,
+        git_repository* odb_repo,
+        const char* path,
+        std::mutex& odb_mutex
+    )
+    {
+        git_filter_list* filters = nullptr;
+        int error =
+            git_filter_list_load(&filters, filter_repo, nullptr, path, GIT_FILTER_TO_ODB, GIT_FILTER_DEFAULT);
+        if (error < 0)
+        {
+            return error;
+        }
+        git_buf content = GIT_BUF_INIT;
+        error = git_filter_list_apply_to_file(&content, filters, filter_repo, path);
+        git_filter_list_free(filters);
+        if (error == 0)
+        {
+            std::lock_guard<std::mutex> lock(odb_mutex);
+            error = git_blob_create_from_buffer(id, odb_repo, content.ptr, content.size);
+        }
+        git_buf_dispose(&content);
+        return error;
+    }
+}
+
 index_wrapper::~index_wrapper()
 {
     git_index_free(p_resource);
     p_resource = nullptr;
 }
 
-index_wrapper index_wrapper::init(repository_wrapper& rw)
+index_wrapper index_wrapper::init(const repository_wrapper& rw)
 {
     index_wrapper index;
     throw_if_error(git_repository_index(&(index.p_resource), rw));
+
+    auto config = rw.get_config();
+    index.m_sparse = config.get_bool("core.sparseCheckout", false);
+    const int default_version = config.get_bool("feature.manyFiles", false) ? 4 : 0;
+    const int version = config.get_int("index.version", default_version);
+    if (version >= 2 && version <= 4 && unsigned(version) != git_index_version(index))
+    {
+        throw_if_error(git_index_set_version(index, unsigned(version)));
+    }
     return index;
 }
 
 void index_wrapper::add_entry(const std::string& path)
 {
     throw_if_error(git_index_add_bypath(*this, path.c_str()));
+    m_modified = true;
 }
 
-void index_wrapper::add_entries(std::vector<std::string> patterns)
+void index_wrapper::add_entries(std::vector<std::string> patterns, const index_add_options& options)
 {
-    add_impl(std::move(patterns));
+    add_impl(std::move(patterns), options);
 }
 
-void index_wrapper::add_all()
+void index_wrapper::add_all(const index_add_options& options)
 {
-    add_impl({{"."}});
+    add_impl({{"."}}, options);
 }
 
-void index_wrapper::add_impl(std::vector<std::string> patterns)
+void index_wrapper::add_impl(std::vector<std::string> patterns, const index_add_options& options)
 {
+    trace::scoped_timer timer("index add");
     git_strarray_wrapper array{patterns};
-    throw_if_error(git_index_add_all(*this, array, 0, NULL, NULL));
+    git_repository* repo = git_index_owner(*this);
+    // git_index_add_all would remove the entries outside of the sparse checkout, which have no file.
+    if ((options.thread_count > 1 || options.progress || m_sparse) && repo && !git_repository_is_bare(repo))
+    {
+        add_parallel(array, options);
+    }
+    else
+    {
+        // The callback is called for each path added or removed.
+        size_t matched_count = 0;
+        throw_if_error(git_index_add_all(*this, array, 0, count_matched_path, &matched_count));
+        m_modified = m_modified || matched_count > 0;
+    }
+}
+
+// Same selection of files as git_index_add_all, which adds every delta of the diff between the index
+// and the worktree and removes the deleted files.
+void index_wrapper::add_parallel(git_strarray* pathspec, const index_add_options& options)
+{
+    git_repository* repo = git_index_owner(*this);
+
+    git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+    opts.flags = GIT_DIFF_INCLUDE_UNTRACKED | GIT_DIFF_RECURSE_UNTRACKED_DIRS | GIT_DIFF_INCLUDE_TYPECHANGE;
+    opts.pathspec = *pathspec;
+    git_diff* raw_diff = nullptr;
+    throw_if_error(git_diff_index_to_workdir(&raw_diff, repo, *this, &opts));
+    std::unique_ptr<git_diff, diff_deleter> diff(raw_diff);
+
+    // Regular files are hashed by the workers, libgit2 adds the other ones (links, submodules) and
+    // resolves the conflicts.
+    std::vector<git_index_entry> entries;
+    std::vector<std::string> other_paths;
+    const size_t delta_count = git_diff_num_deltas(diff.get());
+    size_t skipped_count = 0;
+    for (size_t i = 0; i < delta_count; ++i)
+    {
+        const git_diff_delta* delta = git_diff_get_delta(diff.get(), i);
+        const git_diff_file& file = delta->new_file;
+        if (delta->status == GIT_DELTA_DELETED)
+        {
+            const git_index_entry* entry = git_index_get_bypath(*this, delta->old_file.path, 0);
+            if (entry && (entry->flags_extended & GIT_INDEX_ENTRY_SKIP_WORKTREE))
+            {
+                ++skipped_count;
+                continue;
+            }
+            throw_if_error(git_index_remove_bypath(*this, delta->old_file.path));
+        }
+        else if (delta->status != GIT_DELTA_CONFLICTED
+                 && (file.mode == GIT_FILEMODE_BLOB || file.mode == GIT_FILEMODE_BLOB_EXECUTABLE))
+        {
+            // The mode of the diff already accounts for core.filemode.
+            git_index_entry entry = {};
+            entry.mode = file.mode;
+            entry.path = file.path;
+            entries.push_back(entry);
+        }
+        else
+        {
+            other_paths.push_back(file.path);
+        }
+    }
+    m_modified = m_modified || delta_count > skipped_count;
+
+    // libgit2 repositories cannot be shared between threads, so each worker but the calling thread
+    // opens its own.
+    const std::string repo_path = git_repository_path(repo);
+    const std::string workdir = git_repository_workdir(repo);
+    std::vector<std::optional<repository_wrapper>> worker_repos(std::max<size_t>(options.thread_count, 1));
+    std::mutex progress_mutex;
+    std::mutex odb_mutex;
+    size_t hashed_count = 0;
+
+    parallel_for(
+        entries.size(),
+        worker_repos.size(),
+        [&](size_t index, size_t worker)
+        {
+            // With a shared object database, the repository of the index is only used to write the blobs.
+            git_repository* worker_repo = repo;
+            if (worker != 0 || (options.shared_odb && worker_repos.size() > 1))
+            {
+                auto& opened = worker_repos[worker];
+                if (!opened)
+                {
+                    opened = repository_wrapper::open(repo_path);
+                }
+                worker_repo = *opened;
+            }
+
+            // The stat data is read before the content, so that a file changed while it is hashed
+            // looks modified to the next status.
+            git_index_entry& entry = entries[index];
+            struct stat st;
+            if (lstat((workdir + entry.path).c_str(), &st) != 0)
+            {
+                throw git_exception(
+                    "error: unable to stat '" + std::string(entry.path) + "'",
+                    git2cpp_error_code::FILESYSTEM_ERROR
+                );
+            }
+            set_stat_data(entry, st);
+            if (options.shared_odb)
+            {
+                throw_if_error(create_blob_through(&entry.id, worker_repo, repo, entry.path, odb_mutex));
+            }
+            else
+            {
+                throw_if_error(git_blob_create_from_workdir(&entry.id, worker_repo, entry.path));
+            }
+
+            if (options.progress)
+            {
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                options.progress(++hashed_count, entries.size());
+            }
+        }
+    );
+    trace::add("files hashed", entries.size());
+
+    for (const auto& entry : entries)
+    {
+        throw_if_error(git_index_add(*this, &entry));
+    }
+    for (const auto& path : other_paths)
+    {
+        throw_if_error(git_index_add_bypath(*this, path.c_str()));
+    }
 }
 
 void index_wrapper::remove_entry(const std::string& path)
 {
     throw_if_error(git_index_remove_bypath(*this, path.c_str()));
+    m_modified = true;
 }
 
 void index_wrapper::remove_entries(std::vector<std::string> paths)
 {
     git_strarray_wrapper array{paths};
-    throw_if_error(git_index_remove_all(*this, array, NULL, NULL));
+    size_t matched_count = 0;
+    throw_if_error(git_index_remove_all(*this, array, count_matched_path, &matched_count));
+    m_modified = m_modified || matched_count > 0;
 }
 
 void index_wrapper::remove_directories(std::vector<std::string> entries)
@@ -65,17 +282,27 @@ void index_wrapper::remove_directories(std::vector<std::string> entries)
             throw_if_error(git_index_remove_directory(*this, path.c_str(), 0));
         }
     );
+    m_modified = m_modified || !entries.empty();
 }
 
 void index_wrapper::write()
 {
+    if (!m_modified)
+    {
+        trace::add("index writes skipped");
+        return;
+    }
+    trace::scoped_timer timer("index write");
     throw_if_error(git_index_write(*this));
+    m_modified = false;
 }
 
 git_oid index_wrapper::write_tree()
 {
     git_oid tree_id;
     throw_if_error(git_index_write_tree(&tree_id, *this));
+    // The trees written are cached in the index, so that the next commit only writes the changed ones.
+    m_modified = true;
     return tree_id;
 }
 
@@ -125,4 +352,5 @@ void index_wrapper::output_conflicts()
 void index_wrapper::conflict_cleanup()
 {
     throw_if_error(git_index_conflict_cleanup(*this));
+    m_modified = true;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -9,6 +10,20 @@
 
 class repository_wrapper;
 
+struct index_add_options
+{
+    // Called with the number of files hashed so far and the number of files to hash.
+    using progress_fn = std::function<void(size_t, size_t)>;
+
+    // With more than one thread, the files are hashed and their blobs written on thread_count
+    // threads, then all the entries are added to the index at once.
+    size_t thread_count = 1;
+    progress_fn progress;
+    // Write the blobs through the repository of the index instead of one repository per thread, for
+    // an object database in memory (see repository_wrapper::enable_pack_writes).
+    bool shared_odb = false;
+};
+
 class index_wrapper : public wrapper_base<git_index>
 {
 public:
@@ -18,14 +33,17 @@ public:
     index_wrapper(index_wrapper&&) noexcept = default;
     index_wrapper& operator=(index_wrapper&&) noexcept = default;
 
-    static index_wrapper init(repository_wrapper& rw);
+    // The index.version config entry (4 by default with feature.manyFiles) applies to the next write:
+    // version 4 compresses the paths of the entries, which makes large indexes much smaller.
+    static index_wrapper init(const repository_wrapper& rw);
 
+    // libgit2 rewrites the whole index, so it is only written if it was changed through this wrapper.
     void write();
     git_oid write_tree();
 
     void add_entry(const std::string& path);
-    void add_entries(std::vector<std::string> patterns);
-    void add_all();
+    void add_entries(std::vector<std::string> patterns, const index_add_options& options = {});
+    void add_all(const index_add_options& options = {});
 
     void remove_entry(const std::string& path);
     void remove_entries(std::vector<std::string> paths);
@@ -39,7 +57,11 @@ public:
 private:
 
     index_wrapper() = default;
-    void add_impl(std::vector<std::string> patterns);
+    void add_impl(std::vector<std::string> patterns, const index_add_options& options);
+    void add_parallel(git_strarray* pathspec, const index_add_options& options);
 
     git_index_conflict_iterator* create_conflict_iterator();
+
+    bool m_modified = false;
+    bool m_sparse = false;
 };
@@ -20,22 +20,34 @@ git_buf patch_wrapper::to_buf()
     return buf;
 }
 
+void patch_wrapper::print(git_diff_line_cb print_cb, void* payload) const
+{
+    throw_if_error(git_patch_print(*this, print_cb, payload));
+}
+
+std::optional<patch_wrapper> patch_wrapper::from_diff(const diff_wrapper& diff, size_t index)
+{
+    git_patch* patch = nullptr;
+    throw_if_error(git_patch_from_diff(&patch, diff, index));
+    return patch ? std::make_optional(patch_wrapper(patch)) : std::nullopt;
+}
+
 patch_wrapper patch_wrapper::patch_from_files(
     const std::string& path1,
-    const std::string& file1_str,
+    std::string_view file1_content,
     const std::string& path2,
-    const std::string& file2_str,
+    std::string_view file2_content,
     git_diff_options* diffopts
 )
 {
     git_patch* patch;
     throw_if_error(git_patch_from_buffers(
         &patch,
-        file1_str.c_str(),
-        file1_str.length(),
+        file1_content.data(),
+        file1_content.size(),
         path1.c_str(),
-        file2_str.c_str(),
-        file2_str.length(),
+        file2_content.data(),
+        file2_content.size(),
         path2.c_str(),
         diffopts
     ));
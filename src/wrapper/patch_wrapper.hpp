@@ -1,9 +1,12 @@
 #pragma once
 
+#include <optional>
 #include <string>
+#include <string_view>
 
 #include <git2.h>
 
+#include "../wrapper/diff_wrapper.hpp"
 #include "../wrapper/wrapper_base.hpp"
 
 class patch_wrapper : public wrapper_base<git_patch>
@@ -18,11 +21,17 @@ public:
     patch_wrapper& operator=(patch_wrapper&&) noexcept = default;
 
     git_buf to_buf();
+    void print(git_diff_line_cb print_cb, void* payload) const;
+
+    // Patch of the delta at index, nullopt if the delta is not printed (unmodified file that is
+    // only part of the diff for rename detection, ...).
+    static std::optional<patch_wrapper> from_diff(const diff_wrapper& diff, size_t index);
+    // The lines of the patch point into the contents, which must outlive it.
     static patch_wrapper patch_from_files(
         const std::string& path1,
-        const std::string& file1_str,
+        std::string_view file1_content,
         const std::string& path2,
-        const std::string& file2_str,
+        std::string_view file2_content,
         git_diff_options* diffopts
     );
 
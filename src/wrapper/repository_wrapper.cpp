@@ -1,10 +1,21 @@
 #include "../wrapper/repository_wrapper.hpp"
 
 #include <algorithm>
-#include <fstream>
+#include <filesystem>
 #include <iostream>
+#include <map>
+#include <mutex>
+
+#include <git2/sys/mempack.h>
+#include <git2/sys/odb_backend.h>
+#include <git2/sys/repository.h>
 
 #include "../utils/git_exception.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/parallel_checkout.hpp"
+#include "../utils/shallow_depth.hpp"
+#include "../utils/sparse_checkout.hpp"
+#include "../utils/trace.hpp"
 #include "../wrapper/commit_wrapper.hpp"
 #include "../wrapper/index_wrapper.hpp"
 #include "../wrapper/object_wrapper.hpp"
@@ -14,17 +25,68 @@
 
 repository_wrapper::~repository_wrapper()
 {
+    m_stat_cache.reset();
     git_repository_free(p_resource);
     p_resource = nullptr;
 }
 
+namespace
+{
+    // Object databases shared by the repositories opened at the same path, see set_odb_sharing.
+    // Repositories may be opened concurrently by the parallel status scan.
+    std::mutex shared_odbs_mutex;
+    bool odb_sharing_enabled = false;
+    std::map<std::string, git_odb*> shared_odbs;
+}
+
 repository_wrapper repository_wrapper::open(std::string_view directory)
 {
+    trace::scoped_timer timer("repository open");
     repository_wrapper rw;
     throw_if_error(git_repository_open(&(rw.p_resource), directory.data()));
+    rw.m_promisor = promisor_remote::load(rw);
+
+    std::lock_guard<std::mutex> lock(shared_odbs_mutex);
+    if (odb_sharing_enabled)
+    {
+        auto [it, inserted] = shared_odbs.try_emplace(rw.path(), nullptr);
+        if (inserted)
+        {
+            int error = git_repository_odb(&(it->second), rw);
+            if (error < 0)
+            {
+                shared_odbs.erase(it);
+                throw_if_error(error);
+            }
+        }
+        else
+        {
+            // The shared object database already has the backend of the promisor remote.
+            throw_if_error(git_repository_set_odb(rw, it->second));
+            return rw;
+        }
+    }
+    if (rw.m_promisor)
+    {
+        rw.m_promisor->add_backend(rw);
+    }
     return rw;
 }
 
+void repository_wrapper::set_odb_sharing(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(shared_odbs_mutex);
+    odb_sharing_enabled = enabled;
+    if (!enabled)
+    {
+        for (auto& [path, odb] : shared_odbs)
+        {
+            git_odb_free(odb);
+        }
+        shared_odbs.clear();
+    }
+}
+
 repository_wrapper repository_wrapper::init(std::string_view directory, bool bare)
 {
     repository_wrapper rw;
@@ -47,11 +109,69 @@ repository_wrapper::clone(std::string_view url, std::string_view path, const git
     return rw;
 }
 
+repository_wrapper repository_wrapper::partial_clone(
+    std::string_view url,
+    std::string_view path,
+    const clone_filter& filter,
+    bool bare,
+    const git_remote_callbacks& callbacks
+)
+{
+    // The URL of a path is made absolute, so that it does not depend on the working directory.
+    const std::string remote_url = url.starts_with("file://")
+                                       ? std::string(url)
+                                       : std::filesystem::absolute(url).string();
+
+    // As git_clone, only an empty directory is cloned into, and on failure the directory is removed
+    // if the clone created it, emptied otherwise.
+    const std::filesystem::path repo_path(path);
+    std::error_code ec;
+    const bool existed = std::filesystem::exists(repo_path, ec);
+    const bool is_empty = std::filesystem::is_directory(repo_path, ec)
+                          && std::filesystem::is_empty(repo_path, ec);
+    if (existed && !is_empty)
+    {
+        throw git_exception(
+            "fatal: destination path '" + std::string(path)
+                + "' already exists and is not an empty directory.",
+            git2cpp_error_code::FILESYSTEM_ERROR
+        );
+    }
+    try
+    {
+        auto rw = init(path, bare);
+        rw.create_remote("origin", remote_url);
+        const auto progress_cb = callbacks.transfer_progress;
+        promisor_remote::clone(rw, "origin", remote_url, filter, progress_cb, callbacks.payload);
+    }
+    catch (...)
+    {
+        if (existed)
+        {
+            for (const auto& entry : std::filesystem::directory_iterator(repo_path, ec))
+            {
+                std::filesystem::remove_all(entry.path(), ec);
+            }
+        }
+        else
+        {
+            std::filesystem::remove_all(repo_path, ec);
+        }
+        throw;
+    }
+    return open(path);
+}
+
 std::string repository_wrapper::path() const
 {
     return git_repository_path(*this);
 }
 
+std::string repository_wrapper::common_path() const
+{
+    return git_repository_commondir(*this);
+}
+
 git_repository_state_t repository_wrapper::state() const
 {
     return git_repository_state_t(git_repository_state(*this));
@@ -81,9 +201,16 @@ revwalk_wrapper repository_wrapper::new_walker()
 
 bool repository_wrapper::does_track(std::string_view path) const
 {
-    unsigned int flags;
-    throw_if_error(git_status_file(&flags, *this, path.data()));
-    return !(flags & GIT_STATUS_WT_NEW) && !(flags & GIT_STATUS_IGNORED);
+    return worktree_stats().is_tracked(std::string(path));
+}
+
+stat_cache& repository_wrapper::worktree_stats() const
+{
+    if (!m_stat_cache)
+    {
+        m_stat_cache = std::make_unique<stat_cache>(p_resource);
+    }
+    return *m_stat_cache;
 }
 
 // Head
@@ -136,8 +263,9 @@ std::optional<reference_wrapper> repository_wrapper::find_reference_dwim(std::st
 
 // Index
 
-index_wrapper repository_wrapper::make_index()
+index_wrapper repository_wrapper::make_index() const
 {
+    trace::scoped_timer timer("index load");
     index_wrapper index = index_wrapper::init(*this);
     return index;
 }
@@ -237,6 +365,7 @@ commit_wrapper repository_wrapper::find_commit(std::string_view ref_name) const
 
 commit_wrapper repository_wrapper::find_commit(const git_oid& id) const
 {
+    trace::add("object lookups");
     git_commit* commit;
     throw_if_error(git_commit_lookup(&commit, *this, &id));
     return commit_wrapper(commit);
@@ -281,6 +410,9 @@ void repository_wrapper::create_commit(
     git_oid tree_id = index.write_tree();
     index.write();
 
+    // The trees are on disk before a reference points to them. The commit itself is a loose object.
+    write_pack();
+
     auto tree = this->tree_lookup(&tree_id);
 
     throw_if_error(git_commit_create(
@@ -327,6 +459,7 @@ annotated_commit_wrapper repository_wrapper::find_annotated_commit(const git_oid
 
 std::optional<object_wrapper> repository_wrapper::revparse_single(std::string_view spec) const
 {
+    trace::add("object lookups");
     git_object* obj;
     int rc = git_revparse_single(&obj, *this, spec.data());
     return rc == 0 ? std::make_optional(object_wrapper(obj)) : std::nullopt;
@@ -334,6 +467,7 @@ std::optional<object_wrapper> repository_wrapper::revparse_single(std::string_vi
 
 object_wrapper repository_wrapper::find_object(const git_oid id, git_object_t type)
 {
+    trace::add("object lookups");
     git_object* object;
     git_object_lookup(&object, *this, &id, type);
     return object_wrapper(object);
@@ -368,90 +502,41 @@ size_t repository_wrapper::shallow_depth_from_head() const
     {
         return 0u;
     }
+    return shallow_depth(*this, this->find_commit("HEAD").oid());
+}
 
-    std::string path = this->path();
-    std::string shallow_path = path + "shallow";
+// Trees
 
-    std::vector<git_oid> boundaries_list;
-    std::ifstream f(shallow_path);
-    std::string line;
-    while (std::getline(f, line))
+void repository_wrapper::checkout_tree(const git_object* target, const git_checkout_options& opts)
+{
+    // The stat data read before the checkout does not describe the worktree anymore.
+    m_stat_cache.reset();
+    const size_t thread_count = resolve_thread_count(get_config().get_int("git2cpp.checkoutThreads", 1));
+    const auto sparse = sparse_checkout::load(*this);
+    const sparse_checkout* patterns = sparse ? &*sparse : nullptr;
+    if (m_promisor)
     {
-        if (!line.empty())
-        {
-            git_oid commit_oid;
-            git_oid_fromstrp(&commit_oid, line.c_str());
-            boundaries_list.push_back(commit_oid);
-        }
+        git_object* tree = nullptr;
+        throw_if_error(git_object_peel(&tree, target, GIT_OBJECT_TREE));
+        const git_oid tree_id = *git_object_id(tree);
+        git_object_free(tree);
+        m_promisor->prefetch_tree(*this, tree_id, patterns);
     }
-
-    if (boundaries_list.size() == 0u)
+    if ((thread_count > 1 || patterns) && parallel_checkout(*this, target, opts, thread_count, patterns))
     {
-        return 0u;
+        return;
     }
-
-    commit_wrapper head_commit = this->find_commit("HEAD");
-    commit_list_wrapper commits_list = head_commit.get_parents_list();
-    std::vector<size_t> depth_list(commits_list.size(), 1u);
-    std::vector<size_t> final_depths(boundaries_list.size(), 1u);
-    bool has_parent = commits_list.size() > 0u;
-    while (has_parent)
+    throw_if_error(git_checkout_tree(*this, target, &opts));
+    // libgit2 ignores the sparse checkout, the files it wrote outside of it are removed again.
+    if (patterns)
     {
-        has_parent = false;
-        std::vector<commit_wrapper> temp_commits_list;
-        std::vector<size_t> temp_depth_list;
-        commit_list_wrapper parent_list({});
-
-        for (size_t i = 0u; i < commits_list.size(); i++)
-        {
-            const commit_wrapper& commit = commits_list[i];
-            size_t depth = depth_list[i];
-            const git_oid& oid = commit.oid();
-            bool is_boundary = std::find_if(
-                                   boundaries_list.cbegin(),
-                                   boundaries_list.cend(),
-                                   [oid](const git_oid& val)
-                                   {
-                                       return git_oid_equal(&oid, &val);
-                                   }
-                               )
-                               != boundaries_list.cend();
-            if (is_boundary)
-            {
-                final_depths.push_back(depth + 1u);
-            }
-            else
-            {
-                parent_list = commit.get_parents_list();
-                if (parent_list.size() > 0u)
-                {
-                    has_parent = true;
-                    for (size_t j = 0u; parent_list.size(); j++)
-                    {
-                        const commit_wrapper& c = parent_list[j];
-                        temp_commits_list.push_back(std::move(const_cast<commit_wrapper&>(c)));
-                        temp_depth_list.push_back(depth + 1u);
-                    }
-                }
-            }
-        }
-        depth_list = temp_depth_list;
-        commits_list = commit_list_wrapper(std::move(temp_commits_list));
+        apply_sparse_checkout(*this, patterns);
     }
-
-    std::size_t depth = *std::max_element(final_depths.begin(), final_depths.end());
-    return depth;
-}
-
-// Trees
-
-void repository_wrapper::checkout_tree(const object_wrapper& target, const git_checkout_options opts)
-{
-    throw_if_error(git_checkout_tree(*this, target, &opts));
 }
 
 tree_wrapper repository_wrapper::tree_lookup(const git_oid* tree_id)
 {
+    trace::add("object lookups");
     git_tree* tree;
     throw_if_error(git_tree_lookup(&tree, *this, tree_id));
     return tree_wrapper(tree);
@@ -531,13 +616,99 @@ std::vector<std::string> repository_wrapper::list_remotes() const
 
 // Config
 
-config_wrapper repository_wrapper::get_config()
+config_wrapper repository_wrapper::get_config() const
 {
     git_config* cfg;
     throw_if_error(git_repository_config(&cfg, *this));
     return config_wrapper(cfg);
 }
 
+// Pack writes
+
+void repository_wrapper::enable_pack_writes()
+{
+    if (m_disk_odb)
+    {
+        return;
+    }
+
+    git_odb* disk_odb = nullptr;
+    throw_if_error(git_repository_odb(&disk_odb, *this));
+    std::unique_ptr<git_odb, odb_deleter> disk(disk_odb);
+
+    // The objects on disk are added as an alternate, so that they are read but never written.
+    git_odb* memory_odb = nullptr;
+    throw_if_error(git_odb_new(&memory_odb));
+    std::unique_ptr<git_odb, odb_deleter> memory(memory_odb);
+    git_odb_backend* mempack = nullptr;
+    throw_if_error(git_mempack_new(&mempack));
+    if (int error = git_odb_add_backend(memory_odb, mempack, 1000); error < 0)
+    {
+        mempack->free(mempack);
+        throw_if_error(error);
+    }
+    const std::string objects_dir = common_path() + "objects";
+    throw_if_error(git_odb_add_disk_alternate(memory_odb, objects_dir.c_str()));
+    throw_if_error(git_repository_set_odb(*this, memory_odb));
+
+    m_disk_odb = std::move(disk);
+    m_mempack = mempack;
+}
+
+bool repository_wrapper::pack_writes_enabled() const
+{
+    return m_disk_odb != nullptr;
+}
+
+void repository_wrapper::write_pack()
+{
+    if (!m_disk_odb)
+    {
+        return;
+    }
+
+    trace::scoped_timer timer("pack write");
+    size_t object_count = 0;
+    throw_if_error(git_mempack_object_count(&object_count, m_mempack));
+    if (object_count > 0)
+    {
+        git_buf pack = GIT_BUF_INIT;
+        int error = git_mempack_dump(&pack, *this, m_mempack);
+        git_odb_writepack* writepack = nullptr;
+        if (error == 0)
+        {
+            error = git_odb_write_pack(&writepack, m_disk_odb.get(), nullptr, nullptr);
+        }
+        if (error == 0)
+        {
+            git_indexer_progress stats = {};
+            error = writepack->append(writepack, pack.ptr, pack.size, &stats);
+            if (error == 0)
+            {
+                error = writepack->commit(writepack, &stats);
+            }
+            writepack->free(writepack);
+        }
+        git_buf_dispose(&pack);
+        throw_if_error(error);
+        trace::add("objects packed", object_count);
+    }
+
+    throw_if_error(git_repository_set_odb(*this, m_disk_odb.get()));
+    m_disk_odb.reset();
+    m_mempack = nullptr;
+}
+
+// Partial clones
+
+void repository_wrapper::prefetch_blobs(const diff_wrapper& diff) const
+{
+    if (m_promisor)
+    {
+        m_promisor->prefetch_diff(*this, diff);
+    }
+}
+
 // Diff
 
 diff_wrapper repository_wrapper::diff_tree_to_index(
@@ -546,6 +717,7 @@ diff_wrapper repository_wrapper::diff_tree_to_index(
     git_diff_options* diffopts
 )
 {
+    trace::scoped_timer timer("diff generation");
     git_diff* diff;
     git_index* idx = nullptr;
     if (index)
@@ -562,6 +734,7 @@ diff_wrapper repository_wrapper::diff_tree_to_tree(
     git_diff_options* diffopts
 )
 {
+    trace::scoped_timer timer("diff generation");
     git_diff* diff;
     throw_if_error(git_diff_tree_to_tree(&diff, *this, old_tree, new_tree, diffopts));
     return diff_wrapper(diff);
@@ -569,6 +742,7 @@ diff_wrapper repository_wrapper::diff_tree_to_tree(
 
 diff_wrapper repository_wrapper::diff_tree_to_workdir(const tree_wrapper& old_tree, git_diff_options* diffopts)
 {
+    trace::scoped_timer timer("diff generation");
     git_diff* diff;
     throw_if_error(git_diff_tree_to_workdir(&diff, *this, old_tree, diffopts));
     return diff_wrapper(diff);
@@ -577,6 +751,7 @@ diff_wrapper repository_wrapper::diff_tree_to_workdir(const tree_wrapper& old_tr
 diff_wrapper
 repository_wrapper::diff_tree_to_workdir_with_index(const tree_wrapper& old_tree, git_diff_options* diffopts)
 {
+    trace::scoped_timer timer("diff generation");
     git_diff* diff;
     throw_if_error(git_diff_tree_to_workdir_with_index(&diff, *this, old_tree, diffopts));
     return diff_wrapper(diff);
@@ -585,6 +760,7 @@ repository_wrapper::diff_tree_to_workdir_with_index(const tree_wrapper& old_tree
 diff_wrapper
 repository_wrapper::diff_index_to_workdir(std::optional<index_wrapper> index, git_diff_options* diffopts)
 {
+    trace::scoped_timer timer("diff generation");
     git_diff* diff;
     git_index* idx = nullptr;
     if (index)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <concepts>
+#include <memory>
 #include <optional>
 #include <string_view>
 
@@ -8,6 +9,8 @@
 
 #include "../utils/common.hpp"
 #include "../utils/git_exception.hpp"
+#include "../utils/partial_clone.hpp"
+#include "../utils/stat_cache.hpp"
 #include "../wrapper/annotated_commit_wrapper.hpp"
 #include "../wrapper/branch_wrapper.hpp"
 #include "../wrapper/commit_wrapper.hpp"
@@ -42,9 +45,22 @@ public:
     static repository_wrapper init(std::string_view directory, bool bare);
     static repository_wrapper init_ext(std::string_view repo_path, git_repository_init_options* opts);
     static repository_wrapper open(std::string_view directory);
+    // While enabled, the repositories opened at a same path share their object database, so that
+    // pack indexes and cached objects are loaded once for all of them (see batch_subcommand).
+    static void set_odb_sharing(bool enabled);
     static repository_wrapper clone(std::string_view url, std::string_view path, const git_clone_options& opts);
+    // Clone of a local repository without the objects omitted by filter, fetched when they are
+    // needed (see promisor_remote). The files are not checked out.
+    static repository_wrapper partial_clone(
+        std::string_view url,
+        std::string_view path,
+        const clone_filter& filter,
+        bool bare,
+        const git_remote_callbacks& callbacks
+    );
 
     std::string path() const;
+    std::string common_path() const;
     git_repository_state_t state() const;
     void state_cleanup();
 
@@ -53,8 +69,13 @@ public:
 
     revwalk_wrapper new_walker();
 
+    // Answered from the index, without reading the worktree.
     bool does_track(std::string_view path) const;
 
+    // Stat data of the worktree read once per path and shared by the checks of a command, see
+    // stat_cache.
+    stat_cache& worktree_stats() const;
+
     // Head
     bool is_head_unborn() const;
     reference_wrapper head() const;
@@ -65,7 +86,7 @@ public:
     std::optional<reference_wrapper> find_reference_dwim(std::string_view ref_name) const;
 
     // Index
-    index_wrapper make_index();
+    index_wrapper make_index() const;
 
     // Branches
     branch_wrapper create_branch(std::string_view name, bool force);
@@ -106,7 +127,10 @@ public:
     size_t shallow_depth_from_head() const;
 
     // Trees
-    void checkout_tree(const object_wrapper& target, const git_checkout_options opts);
+    // Files are written on several threads when the git2cpp.checkoutThreads config entry is not 1
+    // (values less than 1 mean one thread per core) and parallel_checkout supports the checkout. The
+    // files outside of the sparse checkout, if any, are not written.
+    void checkout_tree(const git_object* target, const git_checkout_options& opts);
     tree_wrapper tree_lookup(const git_oid* tree_id);
     tree_wrapper treeish_to_tree(const std::string& treeish);
 
@@ -119,7 +143,17 @@ public:
     std::vector<std::string> list_remotes() const;
 
     // Config
-    config_wrapper get_config();
+    config_wrapper get_config() const;
+
+    // Bulk imports: while enabled, the new objects are kept in memory instead of being written as one
+    // loose file each, and write_pack writes them in a single pack, with deltas between them. Objects
+    // that are not written by write_pack are dropped with the repository. Enabled by add --pack or the
+    // git2cpp.packNewObjects config entry.
+    void enable_pack_writes();
+    bool pack_writes_enabled() const;
+    // Write the objects created since enable_pack_writes and go back to loose objects. Does nothing
+    // if pack writes are not enabled.
+    void write_pack();
 
     // Diff
     diff_wrapper
@@ -130,6 +164,11 @@ public:
     diff_wrapper diff_tree_to_workdir_with_index(const tree_wrapper& old_tree, git_diff_options* diffopts);
     diff_wrapper diff_index_to_workdir(std::optional<index_wrapper> index, git_diff_options* diffopts);
 
+    // Partial clones
+    // Fetch in a single batch the blobs of the deltas of diff that are missing from a partial clone,
+    // before its patches are made. Does nothing in the other repositories.
+    void prefetch_blobs(const diff_wrapper& diff) const;
+
     // Tags
     //  git_strarray_wrapper tag_list_match(std::string pattern);
     std::vector<std::string> tag_list_match(std::string pattern);
@@ -137,6 +176,24 @@ public:
 private:
 
     repository_wrapper() = default;
+
+    struct odb_deleter
+    {
+        void operator()(git_odb* odb) const
+        {
+            git_odb_free(odb);
+        }
+    };
+
+    mutable std::unique_ptr<stat_cache> m_stat_cache;
+
+    // Object database on disk, replaced by an in-memory one while pack writes are enabled. The
+    // in-memory backend is owned by the object database of the repository.
+    std::unique_ptr<git_odb, odb_deleter> m_disk_odb;
+    git_odb_backend* m_mempack = nullptr;
+
+    // Remote of a partial clone, null in the other repositories.
+    std::shared_ptr<promisor_remote> m_promisor;
 };
 
 template <std::convertible_to<git_reference*> T>
@@ -4,6 +4,7 @@
 #include <git2/types.h>
 
 #include "../utils/git_exception.hpp"
+#include "../utils/trace.hpp"
 
 revwalk_wrapper::revwalk_wrapper(git_revwalk* walker)
     : base_type(walker)
@@ -21,12 +22,27 @@ void revwalk_wrapper::push_head()
     throw_if_error(git_revwalk_push_head(*this));
 }
 
-void revwalk_wrapper::push(git_oid& commit_oid)
+void revwalk_wrapper::push(const git_oid& commit_oid)
 {
     throw_if_error(git_revwalk_push(*this, &commit_oid));
 }
 
+void revwalk_wrapper::hide(const git_oid& commit_oid)
+{
+    throw_if_error(git_revwalk_hide(*this, &commit_oid));
+}
+
+void revwalk_wrapper::push_glob(std::string_view glob)
+{
+    throw_if_error(git_revwalk_push_glob(*this, glob.data()));
+}
+
 int revwalk_wrapper::next(git_oid& commit_oid)
 {
-    return git_revwalk_next(&commit_oid, *this);
+    const int error = git_revwalk_next(&commit_oid, *this);
+    if (error == 0)
+    {
+        trace::add("commits walked");
+    }
+    return error;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string_view>
+
 #include <git2.h>
 #include <git2/types.h>
 
@@ -18,7 +20,9 @@ public:
     revwalk_wrapper& operator=(revwalk_wrapper&&) noexcept = default;
 
     void push_head();
-    void push(git_oid& commit_oid);
+    void push(const git_oid& commit_oid);
+    void hide(const git_oid& commit_oid);
+    void push_glob(std::string_view glob);
     int next(git_oid& commit_oid);
 
 private:
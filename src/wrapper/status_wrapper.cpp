@@ -1,6 +1,15 @@
 #include "../wrapper/status_wrapper.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string_view>
+
 #include "../utils/git_exception.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
 
 status_list_wrapper::~status_list_wrapper()
 {
@@ -8,13 +17,93 @@ status_list_wrapper::~status_list_wrapper()
     p_resource = nullptr;
 }
 
-status_list_wrapper status_list_wrapper::status_list(const repository_wrapper& rw)
+git_status_options status_list_wrapper::status_options()
 {
     git_status_options opts = GIT_STATUS_OPTIONS_INIT;
     opts.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
     opts.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX
                  | GIT_STATUS_OPT_RENAMES_INDEX_TO_WORKDIR | GIT_STATUS_OPT_SORT_CASE_SENSITIVELY;
     opts.rename_threshold = 50;
+    return opts;
+}
+
+status_list_wrapper status_list_wrapper::status_list(const repository_wrapper& rw)
+{
+    trace::scoped_timer timer("status scan");
+    if (rw.is_bare() || !is_cache_enabled(rw))
+    {
+        return scan(rw);
+    }
+
+    const std::string cache_path = status_cache::file_path(rw.path());
+    const std::string key = cache_key(rw);
+    if (auto entries = status_cache::load(cache_path, key))
+    {
+        status_list_wrapper res;
+        res.m_cached_entries = std::move(*entries);
+        for (auto& entry : res.m_cached_entries)
+        {
+            res.m_entries[entry.status_entry.status].push_back(&entry.status_entry);
+        }
+        // The stored statuses of the skipped entries still have their worktree deletion.
+        res.drop_skipped_entries(rw);
+        res.set_header_flags();
+        trace::add("status cache hits");
+        return res;
+    }
+
+    const int64_t scan_start = status_cache::now();
+    status_list_wrapper res = scan(rw);
+    trace::scoped_timer store_timer("status cache store");
+    if (auto watched_paths = res.cache_watched_paths(rw))
+    {
+        std::vector<const git_status_entry*> entries;
+        for (const auto& [status, entry_list] : res.m_entries)
+        {
+            entries.insert(entries.end(), entry_list.begin(), entry_list.end());
+        }
+        status_cache::store(cache_path, key, scan_start, *watched_paths, entries);
+    }
+    return res;
+}
+
+status_list_wrapper status_list_wrapper::scan(const repository_wrapper& rw)
+{
+    const size_t thread_count = resolve_thread_count(rw.get_config().get_int("git2cpp.statusThreads", 1));
+    if (thread_count > 1 && !rw.is_bare())
+    {
+        status_list_wrapper res;
+        if (res.scan_shards(rw, thread_count))
+        {
+            res.drop_skipped_entries(rw);
+            res.set_header_flags();
+            return res;
+        }
+    }
+
+    git_status_options opts = status_options();
+
+    status_list_wrapper res;
+    throw_if_error(git_status_list_new(&(res.p_resource), rw, &opts));
+
+    std::size_t status_list_size = git_status_list_entrycount(res.p_resource);
+    for (std::size_t i = 0; i < status_list_size; ++i)
+    {
+        auto entry = git_status_byindex(res.p_resource, i);
+        res.m_entries[entry->status].push_back(entry);
+    }
+
+    res.drop_skipped_entries(rw);
+    res.set_header_flags();
+    return res;
+}
+
+status_list_wrapper status_list_wrapper::tracked_status_list(const repository_wrapper& rw)
+{
+    trace::scoped_timer timer("status scan");
+    git_status_options opts = status_options();
+    opts.flags &= ~GIT_STATUS_OPT_INCLUDE_UNTRACKED;
+    opts.flags |= GIT_STATUS_OPT_UPDATE_INDEX;
 
     status_list_wrapper res;
     throw_if_error(git_status_list_new(&(res.p_resource), rw, &opts));
@@ -26,39 +115,412 @@ status_list_wrapper status_list_wrapper::status_list(const repository_wrapper& r
         res.m_entries[entry->status].push_back(entry);
     }
 
-    if (!res.get_entry_list(GIT_STATUS_INDEX_NEW).empty()
-        || !res.get_entry_list(GIT_STATUS_INDEX_MODIFIED).empty()
-        || !res.get_entry_list(GIT_STATUS_INDEX_DELETED).empty()
-        || !res.get_entry_list(GIT_STATUS_INDEX_RENAMED).empty()
-        || !res.get_entry_list(GIT_STATUS_INDEX_TYPECHANGE).empty())
+    res.drop_skipped_entries(rw);
+    res.set_header_flags();
+    return res;
+}
+
+// The files outside of the sparse checkout have no file in the worktree but are not deleted. The
+// worktree deletion is dropped from their status, whatever the other bits, and the entries with
+// nothing left are dropped.
+void status_list_wrapper::drop_skipped_entries(const repository_wrapper& rw)
+{
+    const bool has_deletions = std::ranges::any_of(
+        m_entries,
+        [](const auto& item)
+        {
+            return (item.first & GIT_STATUS_WT_DELETED) != 0;
+        }
+    );
+    if (!has_deletions || !rw.get_config().get_bool("core.sparseCheckout", false))
     {
-        res.m_tobecommited_header_flag = true;
+        return;
     }
-    if (!res.get_entry_list(GIT_STATUS_WT_NEW).empty())
+
+    const auto path_less = [](const git_status_entry* lhs, const git_status_entry* rhs)
+    {
+        const git_diff_delta* lhs_delta = lhs->head_to_index ? lhs->head_to_index : lhs->index_to_workdir;
+        const git_diff_delta* rhs_delta = rhs->head_to_index ? rhs->head_to_index : rhs->index_to_workdir;
+        return std::strcmp(lhs_delta->old_file.path, rhs_delta->old_file.path) < 0;
+    };
+    stat_cache& stats = rw.worktree_stats();
+    std::vector<std::pair<git_status_t, const git_status_entry*>> moved;
+    for (auto& [status, entry_list] : m_entries)
     {
-        res.m_untracked_header_flag = true;
+        if (!(status & GIT_STATUS_WT_DELETED))
+        {
+            continue;
+        }
+        const git_status_t kept_status = git_status_t(status & ~GIT_STATUS_WT_DELETED);
+        std::erase_if(
+            entry_list,
+            [&](const git_status_entry* entry)
+            {
+                if (!stats.is_skipped(entry->index_to_workdir->old_file.path))
+                {
+                    return false;
+                }
+                if (kept_status != GIT_STATUS_CURRENT)
+                {
+                    moved.emplace_back(kept_status, entry);
+                }
+                return true;
+            }
+        );
     }
-    if (!res.get_entry_list(GIT_STATUS_WT_MODIFIED).empty()
-        || !res.get_entry_list(GIT_STATUS_WT_DELETED).empty()
-        || !res.get_entry_list(GIT_STATUS_WT_TYPECHANGE).empty()
-        || !res.get_entry_list(GIT_STATUS_WT_RENAMED).empty())
+    // The lists stay sorted by path, as libgit2 returns them.
+    for (const auto& [status, entry] : moved)
     {
-        res.m_notstagged_header_flag = true;
+        auto& entry_list = m_entries[status];
+        entry_list.insert(std::ranges::upper_bound(entry_list, entry, path_less), entry);
     }
-    if (!res.get_entry_list(GIT_STATUS_IGNORED).empty())
+    std::erase_if(
+        m_entries,
+        [](const auto& item)
+        {
+            return item.second.empty();
+        }
+    );
+}
+
+// Not core.untrackedCache: git would then write and trust its own cache extension in the index.
+bool status_list_wrapper::is_cache_enabled(const repository_wrapper& rw)
+{
+    return rw.get_config().get_bool("git2cpp.statusCache", false);
+}
+
+// The cache is only valid for the worktree and the HEAD commit it was computed for.
+std::string status_list_wrapper::cache_key(const repository_wrapper& rw)
+{
+    std::string key = git_repository_workdir(rw);
+    git_oid head_oid;
+    if (git_reference_name_to_id(&head_oid, rw, "HEAD") == 0)
     {
-        res.m_ignored_header_flag = true;
+        key += '\n';
+        key += git_oid_tostr_s(&head_oid);
     }
-    if (!res.get_entry_list(GIT_STATUS_CONFLICTED).empty())
+    return key;
+}
+
+// The index, the config and exclude files, every non-ignored directory of the worktree and every
+// file of the index or of the status. Submodules have a status of their own that does not show in
+// their stat data, so repositories with submodules are not cached.
+std::optional<std::vector<std::string>>
+status_list_wrapper::cache_watched_paths(const repository_wrapper& rw) const
+{
+    namespace fs = std::filesystem;
+
+    const std::string git_dir = rw.path();
+    const std::string common_dir = rw.common_path();
+    std::vector<std::string> paths = {
+        git_dir + "HEAD",
+        git_dir + "index",
+        common_dir + "config",
+        common_dir + "info/exclude"
+    };
+
+    const char* xdg_config_home = std::getenv("XDG_CONFIG_HOME");
+    const char* home = std::getenv("HOME");
+    if (home)
+    {
+        paths.push_back(std::string(home) + "/.gitconfig");
+    }
+    if (xdg_config_home || home)
+    {
+        const std::string xdg_dir = xdg_config_home ? std::string(xdg_config_home) + "/git/"
+                                                    : std::string(home) + "/.config/git/";
+        paths.push_back(xdg_dir + "config");
+        paths.push_back(xdg_dir + "ignore");
+    }
+    git_buf excludes_file = GIT_BUF_INIT;
+    if (git_config_get_path(&excludes_file, rw.get_config(), "core.excludesFile") == 0)
+    {
+        paths.emplace_back(excludes_file.ptr, excludes_file.size);
+    }
+    git_buf_dispose(&excludes_file);
+
+    const std::string workdir = git_repository_workdir(rw);
+    paths.push_back(workdir);
+    std::error_code ec;
+    auto it = fs::recursive_directory_iterator(workdir, fs::directory_options::skip_permission_denied, ec);
+    for (; it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (ec)
+        {
+            return std::nullopt;
+        }
+        if (it->symlink_status().type() != fs::file_type::directory)
+        {
+            continue;
+        }
+
+        const std::string relative_path = it->path().lexically_relative(workdir).generic_string() + "/";
+        int ignored = 0;
+        if (it->path().filename() == ".git"
+            || git_ignore_path_is_ignored(&ignored, rw, relative_path.c_str()) != 0 || ignored)
+        {
+            it.disable_recursion_pending();
+            continue;
+        }
+        paths.push_back(it->path().string());
+        if (fs::exists(it->path() / ".git"))
+        {
+            it.disable_recursion_pending();
+        }
+    }
+
+    index_wrapper index = rw.make_index();
+    for (size_t i = 0; i < git_index_entrycount(index); ++i)
     {
-        res.m_unmerged_header_flag = true;
+        const git_index_entry* entry = git_index_get_byindex(index, i);
+        if (entry->mode == GIT_FILEMODE_COMMIT)
+        {
+            return std::nullopt;
+        }
+        // The files outside of the sparse checkout are not stat'ed, a file created there shows in the
+        // modification time of a watched directory.
+        if (!(entry->flags_extended & GIT_INDEX_ENTRY_SKIP_WORKTREE))
+        {
+            paths.push_back(workdir + entry->path);
+        }
     }
-    // if (!res.tobecommited_header_flag)
+
+    // Untracked files, whose content matters for the detection of renames in the worktree.
+    for (const auto& [status, entry_list] : m_entries)
+    {
+        for (const auto* entry : entry_list)
+        {
+            if (entry->index_to_workdir)
+            {
+                std::string_view path = entry->index_to_workdir->new_file.path;
+                if (!path.ends_with('/'))
+                {
+                    paths.push_back(workdir + std::string(path));
+                }
+            }
+        }
+    }
+    return paths;
+}
+
+// Top-level names of the HEAD tree, the index and the worktree. Each directory is a shard of its
+// own, the files are grouped in a single shard, so that every path belongs to exactly one shard.
+std::vector<std::vector<std::string>> status_list_wrapper::shard_pathspecs(repository_wrapper& repo)
+{
+    std::set<std::string> directories;
+    std::set<std::string> files;
+    const auto add_path = [&](std::string_view path, bool is_directory)
+    {
+        auto slash = path.find('/');
+        if (slash != std::string_view::npos)
+        {
+            directories.emplace(path.substr(0, slash));
+        }
+        else
+        {
+            (is_directory ? directories : files).emplace(path);
+        }
+    };
+
+    if (!repo.is_head_unborn())
+    {
+        tree_wrapper tree = repo.find_commit().tree();
+        for (size_t i = 0; i < git_tree_entrycount(tree); ++i)
+        {
+            const git_tree_entry* entry = git_tree_entry_byindex(tree, i);
+            add_path(git_tree_entry_name(entry), git_tree_entry_type(entry) == GIT_OBJECT_TREE);
+        }
+    }
+
+    index_wrapper index = repo.make_index();
+    for (size_t i = 0; i < git_index_entrycount(index); ++i)
+    {
+        add_path(git_index_get_byindex(index, i)->path, false);
+    }
+
+    for (const auto& entry : std::filesystem::directory_iterator(git_repository_workdir(repo)))
+    {
+        std::string name = entry.path().filename().string();
+        if (name != ".git")
+        {
+            add_path(name, entry.symlink_status().type() == std::filesystem::file_type::directory);
+        }
+    }
+
+    std::vector<std::vector<std::string>> pathspecs;
+    for (const auto& directory : directories)
+    {
+        files.erase(directory);
+        pathspecs.push_back({directory});
+    }
+    if (!files.empty())
+    {
+        pathspecs.emplace_back(files.begin(), files.end());
+    }
+    return pathspecs;
+}
+
+bool status_list_wrapper::scan_shards(const repository_wrapper& rw, size_t thread_count)
+{
+    // libgit2 repositories cannot be shared between threads, so each worker opens its own.
+    const std::string path = rw.path();
+    m_shard_repos.resize(1);
+    m_shard_repos[0] = repository_wrapper::open(path);
+
+    const auto pathspecs = shard_pathspecs(*m_shard_repos[0]);
+    if (pathspecs.size() < 2)
+    {
+        return false;
+    }
+
+    m_shard_repos.resize(std::min(thread_count, pathspecs.size()));
+    for (size_t i = 0; i < pathspecs.size(); ++i)
+    {
+        m_shard_lists.push_back(status_list_wrapper());
+    }
+
+    parallel_for(
+        pathspecs.size(),
+        m_shard_repos.size(),
+        [&](size_t index, size_t worker)
+        {
+            auto& repo = m_shard_repos[worker];
+            if (!repo)
+            {
+                repo = repository_wrapper::open(path);
+            }
+
+            git_strarray_wrapper pathspec(pathspecs[index]);
+            git_status_options opts = status_options();
+            opts.flags |= GIT_STATUS_OPT_DISABLE_PATHSPEC_MATCH;
+            opts.pathspec = *static_cast<git_strarray*>(pathspec);
+            throw_if_error(git_status_list_new(&(m_shard_lists[index].p_resource), *repo, &opts));
+        }
+    );
+
+    if (has_cross_shard_rename_candidates())
+    {
+        trace::add("status shard fallbacks");
+        return false;
+    }
+    trace::add("status shards merged", m_shard_lists.size());
+
+    std::vector<const git_status_entry*> entries;
+    for (const auto& shard : m_shard_lists)
+    {
+        std::size_t shard_size = git_status_list_entrycount(shard);
+        for (std::size_t i = 0; i < shard_size; ++i)
+        {
+            entries.push_back(git_status_byindex(shard, i));
+        }
+    }
+
+    // Same order as GIT_STATUS_OPT_SORT_CASE_SENSITIVELY in a serial scan.
+    const auto entry_path = [](const git_status_entry* entry) -> const char*
+    {
+        const git_diff_delta* delta = entry->index_to_workdir ? entry->index_to_workdir
+                                                              : entry->head_to_index;
+        return delta ? delta->new_file.path : nullptr;
+    };
+    std::sort(
+        entries.begin(),
+        entries.end(),
+        [&entry_path](const git_status_entry* lhs, const git_status_entry* rhs)
+        {
+            const char* lhs_path = entry_path(lhs);
+            const char* rhs_path = entry_path(rhs);
+            if (!lhs_path || !rhs_path)
+            {
+                return !lhs_path && rhs_path;
+            }
+            return std::strcmp(lhs_path, rhs_path) < 0;
+        }
+    );
+
+    for (const auto* entry : entries)
+    {
+        m_entries[entry->status].push_back(entry);
+    }
+    return true;
+}
+
+// Renames are only detected between the paths of a same shard, so a deletion in one shard and an
+// addition in another one could have been reported as a rename by a serial scan. Additions alone, as
+// untracked files in several directories, or deletions and additions in a single shard are safe.
+bool status_list_wrapper::has_cross_shard_rename_candidates() const
+{
+    constexpr unsigned int deletions[] = {
+        GIT_STATUS_INDEX_DELETED | GIT_STATUS_INDEX_RENAMED,
+        GIT_STATUS_WT_DELETED | GIT_STATUS_WT_RENAMED
+    };
+    constexpr unsigned int additions[] = {
+        GIT_STATUS_INDEX_NEW | GIT_STATUS_INDEX_RENAMED,
+        GIT_STATUS_WT_NEW | GIT_STATUS_WT_RENAMED
+    };
+
+    std::vector<unsigned int> shard_statuses(m_shard_lists.size(), 0);
+    for (size_t i = 0; i < m_shard_lists.size(); ++i)
+    {
+        std::size_t shard_size = git_status_list_entrycount(m_shard_lists[i]);
+        for (std::size_t j = 0; j < shard_size; ++j)
+        {
+            shard_statuses[i] |= git_status_byindex(m_shard_lists[i], j)->status;
+        }
+    }
+
+    for (size_t side = 0; side < 2; ++side)
+    {
+        for (size_t i = 0; i < shard_statuses.size(); ++i)
+        {
+            if (!(shard_statuses[i] & deletions[side]))
+            {
+                continue;
+            }
+            for (size_t j = 0; j < shard_statuses.size(); ++j)
+            {
+                if (j != i && (shard_statuses[j] & additions[side]))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void status_list_wrapper::set_header_flags()
+{
+    if (!get_entry_list(GIT_STATUS_INDEX_NEW).empty()
+        || !get_entry_list(GIT_STATUS_INDEX_MODIFIED).empty()
+        || !get_entry_list(GIT_STATUS_INDEX_DELETED).empty()
+        || !get_entry_list(GIT_STATUS_INDEX_RENAMED).empty()
+        || !get_entry_list(GIT_STATUS_INDEX_TYPECHANGE).empty())
+    {
+        m_tobecommited_header_flag = true;
+    }
+    if (!get_entry_list(GIT_STATUS_WT_NEW).empty())
+    {
+        m_untracked_header_flag = true;
+    }
+    if (!get_entry_list(GIT_STATUS_WT_MODIFIED).empty()
+        || !get_entry_list(GIT_STATUS_WT_DELETED).empty()
+        || !get_entry_list(GIT_STATUS_WT_TYPECHANGE).empty()
+        || !get_entry_list(GIT_STATUS_WT_RENAMED).empty())
+    {
+        m_notstagged_header_flag = true;
+    }
+    if (!get_entry_list(GIT_STATUS_IGNORED).empty())
+    {
+        m_ignored_header_flag = true;
+    }
+    if (!get_entry_list(GIT_STATUS_CONFLICTED).empty())
+    {
+        m_unmerged_header_flag = true;
+    }
+    // if (!tobecommited_header_flag)
     // {
-    //     res.m_nothingtocommit_message_flag = true;
+    //     m_nothingtocommit_message_flag = true;
     // }
-
-    return res;
 }
 
 bool status_list_wrapper::has_untracked_header() const
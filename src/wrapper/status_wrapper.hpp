@@ -1,10 +1,13 @@
 #pragma once
 
 #include <map>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include <git2.h>
 
+#include "../utils/status_cache.hpp"
 #include "../wrapper/repository_wrapper.hpp"
 #include "../wrapper/wrapper_base.hpp"
 
@@ -19,8 +22,16 @@ public:
     status_list_wrapper(status_list_wrapper&&) noexcept = default;
     status_list_wrapper& operator=(status_list_wrapper&&) noexcept = default;
 
+    // The worktree is scanned in parallel, one top-level directory per task, when the
+    // git2cpp.statusThreads config entry is not 1 (values less than 1 mean one thread per core).
+    // When git2cpp.statusCache is true, the result is stored in the git directory and reused until
+    // a file or a directory of the worktree changes (see status_cache).
     static status_list_wrapper status_list(const repository_wrapper& wrapper);
 
+    // Status of the tracked files only, without walking the untracked directories. The stat data of
+    // the files found unchanged by hashing them is refreshed in the index.
+    static status_list_wrapper tracked_status_list(const repository_wrapper& wrapper);
+
     const status_entry_list& get_entry_list(git_status_t status) const;
 
     bool has_untracked_header() const;
@@ -34,6 +45,20 @@ private:
 
     status_list_wrapper() = default;
 
+    static status_list_wrapper scan(const repository_wrapper& rw);
+    static bool is_cache_enabled(const repository_wrapper& rw);
+    static std::string cache_key(const repository_wrapper& rw);
+    std::optional<std::vector<std::string>> cache_watched_paths(const repository_wrapper& rw) const;
+
+    static git_status_options status_options();
+    static std::vector<std::vector<std::string>> shard_pathspecs(repository_wrapper& repo);
+
+    // Return false if the result may differ from a serial scan, in which case it must be discarded.
+    bool scan_shards(const repository_wrapper& rw, size_t thread_count);
+    bool has_cross_shard_rename_candidates() const;
+    void drop_skipped_entries(const repository_wrapper& rw);
+    void set_header_flags();
+
     using status_entry_map = std::map<git_status_t, status_entry_list>;
     status_entry_map m_entries;
     status_entry_list m_empty = {};
@@ -43,4 +68,11 @@ private:
     bool m_notstagged_header_flag = false;
     bool m_unmerged_header_flag = false;
     bool m_nothingtocommit_message_flag = false;
+
+    // Only used when the status is read from the cache.
+    status_cache::entry_list m_cached_entries;
+
+    // Only used by parallel scans, the repositories must outlive the status lists.
+    std::vector<std::optional<repository_wrapper>> m_shard_repos;
+    std::vector<status_list_wrapper> m_shard_lists;
 };
@@ -43,3 +43,96 @@ def test_add_nogit(git2cpp_path, tmp_path):
     p_add = subprocess.run(cmd_add, cwd=tmp_path, text=True, capture_output=True)
     assert p_add.returncode != 0
     assert "error: could not find repository at" in p_add.stderr
+
+
+@pytest.mark.parametrize("threads", ["1", "4"])
+def test_add_parallel_hashing(repo_init_with_commit, git2cpp_path, tmp_path, threads):
+    cmd_set = [git2cpp_path, "config", "set", "git2cpp.addThreads", threads]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+
+    for i in range(40):
+        directory = tmp_path / f"dir{i % 4}"
+        directory.mkdir(exist_ok=True)
+        (directory / f"file{i}.txt").write_text(f"content {i}\n")
+    (tmp_path / "initial.txt").unlink()
+
+    cmd_add = [git2cpp_path, "add", "--progress", "-A"]
+    p_add = subprocess.run(cmd_add, capture_output=True, cwd=tmp_path, text=True)
+    assert p_add.returncode == 0
+    assert "Hashing objects: 100% (40/40), done." in p_add.stdout
+
+    cmd_status = [git2cpp_path, "status", "--short"]
+    p_status = subprocess.run(cmd_status, capture_output=True, cwd=tmp_path, text=True)
+    assert p_status.returncode == 0
+    assert p_status.stdout.count("A  ") == 40
+    assert "D  initial.txt" in p_status.stdout
+    assert "A  dir1/file5.txt" in p_status.stdout
+    assert "??" not in p_status.stdout
+
+    (tmp_path / "dir2" / "file6.txt").write_text("changed\n")
+    p_modified = subprocess.run([git2cpp_path, "add", "dir2"], cwd=tmp_path)
+    assert p_modified.returncode == 0
+
+    cmd_diff = [git2cpp_path, "diff", "--cached", "--numstat", "dir2/file6.txt"]
+    p_diff = subprocess.run(cmd_diff, capture_output=True, cwd=tmp_path, text=True)
+    assert p_diff.returncode == 0
+    assert p_diff.stdout.split() == ["1", "0", "dir2/file6.txt"]
+
+
+@pytest.mark.parametrize("threads", ["1", "4"])
+def test_add_pack(repo_init_with_commit, git2cpp_path, tmp_path, threads):
+    cmd_set = [git2cpp_path, "config", "set", "git2cpp.addThreads", threads]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+
+    objects_dir = tmp_path / ".git" / "objects"
+    loose_before = {p for p in objects_dir.glob("??/*")}
+    for i in range(30):
+        (tmp_path / f"file{i}.txt").write_text("".join(f"line {j}\n" for j in range(i, i + 50)))
+
+    p_add = subprocess.run([git2cpp_path, "add", "--pack", "-A"], cwd=tmp_path)
+    assert p_add.returncode == 0
+    assert {p for p in objects_dir.glob("??/*")} == loose_before
+    assert len(list((objects_dir / "pack").glob("*.idx"))) == 1
+
+    cmd_set = [git2cpp_path, "config", "set", "git2cpp.packNewObjects", "true"]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+    p_commit = subprocess.run([git2cpp_path, "commit", "-m", "bulk"], cwd=tmp_path)
+    assert p_commit.returncode == 0
+    # Only the commit itself is a loose object, its tree is in a second pack.
+    assert len({p for p in objects_dir.glob("??/*")} - loose_before) == 1
+    assert len(list((objects_dir / "pack").glob("*.idx"))) == 2
+
+    cmd_diff = [git2cpp_path, "diff", "--numstat", "HEAD~1", "HEAD"]
+    p_diff = subprocess.run(cmd_diff, capture_output=True, cwd=tmp_path, text=True)
+    assert p_diff.returncode == 0
+    assert "50\t0\tfile7.txt" in p_diff.stdout
+    assert len(p_diff.stdout.splitlines()) == 30
+
+
+def test_add_unchanged_keeps_index(repo_init_with_commit, git2cpp_path, tmp_path):
+    index_file = tmp_path / ".git" / "index"
+    before = index_file.stat().st_mtime_ns
+
+    p_add = subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path)
+    assert p_add.returncode == 0
+    assert index_file.stat().st_mtime_ns == before
+
+
+def test_add_index_version(repo_init_with_commit, git2cpp_path, tmp_path):
+    cmd_set = [git2cpp_path, "config", "set", "index.version", "4"]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+
+    (tmp_path / "dir").mkdir()
+    (tmp_path / "dir" / "file.txt").write_text("content\n")
+    p_add = subprocess.run([git2cpp_path, "add", "dir"], cwd=tmp_path)
+    assert p_add.returncode == 0
+
+    header = (tmp_path / ".git" / "index").read_bytes()[:8]
+    assert header[:4] == b"DIRC"
+    assert int.from_bytes(header[4:], "big") == 4
+
+    p_status = subprocess.run(
+        [git2cpp_path, "status", "--short"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_status.returncode == 0
+    assert "A  dir/file.txt" in p_status.stdout
@@ -0,0 +1,107 @@
+import subprocess
+
+
+def parse_frames(output):
+    # Split the batch output into (exit code, stdout, stderr) frames.
+    frames = []
+    while output:
+        header, output = output.split(b"\n", 1)
+        exit_code, out_size, err_size = (int(field) for field in header.split())
+        out = output[:out_size]
+        err = output[out_size : out_size + err_size]
+        output = output[out_size + err_size :]
+        frames.append((exit_code, out.decode(), err.decode()))
+    return frames
+
+
+def test_batch(repo_init_with_commit, git2cpp_path, tmp_path):
+    p_head = subprocess.run([git2cpp_path, "rev-parse", "HEAD"], capture_output=True, cwd=tmp_path, text=True)
+    assert p_head.returncode == 0
+
+    (tmp_path / "untracked.txt").write_text("untracked")
+    commands = b'rev-parse HEAD\n\nstatus -s\nrev-parse unknown\nlog -n 1 --format "oneline"\nbatch\n'
+    p = subprocess.run([git2cpp_path, "batch"], input=commands, capture_output=True, cwd=tmp_path)
+    assert p.returncode == 0
+
+    frames = parse_frames(p.stdout)
+    assert len(frames) == 5
+    assert frames[0] == (0, p_head.stdout, "")
+    assert frames[1] == (0, "?? untracked.txt\n", "")
+    assert frames[2][0] == 129
+    assert "bad revision" in frames[2][2]
+    assert frames[3][0] == 0
+    assert frames[3][1].startswith(p_head.stdout[:7])
+    assert frames[4][0] != 0
+    assert "batch cannot be nested" in frames[4][2]
+
+
+def test_batch_nul_delimited(repo_init_with_commit, git2cpp_path, tmp_path):
+    commands = b"rev-list --count 'HEAD'\0tag -l\0"
+    p = subprocess.run([git2cpp_path, "batch", "-z"], input=commands, capture_output=True, cwd=tmp_path)
+    assert p.returncode == 0
+
+    frames = parse_frames(p.stdout)
+    assert frames == [(0, "1\n", ""), (0, "", "")]
+
+
+def test_batch_commands_do_not_read_stdin(repo_init_with_commit, git2cpp_path, tmp_path):
+    # A merge conflict, so that merge --abort asks for a confirmation.
+    for branch, content in [("other", "other"), ("main", "main")]:
+        if branch == "other":
+            subprocess.run([git2cpp_path, "checkout", "-b", branch], cwd=tmp_path, check=True)
+        else:
+            subprocess.run([git2cpp_path, "checkout", branch], cwd=tmp_path, check=True)
+        (tmp_path / "conflict.txt").write_text(content)
+        subprocess.run([git2cpp_path, "add", "conflict.txt"], cwd=tmp_path, check=True)
+        subprocess.run([git2cpp_path, "commit", "-m", branch], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "merge", "other"], capture_output=True, cwd=tmp_path)
+
+    # The answer is the next command line of the batch, not an input of merge --abort.
+    commands = b"merge --abort\ny\nrev-parse HEAD\n"
+    p = subprocess.run([git2cpp_path, "batch"], input=commands, capture_output=True, cwd=tmp_path)
+    assert p.returncode == 0
+
+    frames = parse_frames(p.stdout)
+    assert len(frames) == 3
+    assert "Abort." in frames[0][1]
+    assert frames[1][0] != 0
+    assert frames[2][0] == 0
+
+
+def test_batch_timings(repo_init_with_commit, git2cpp_path, tmp_path):
+    # --timings only applies to its command, whose report is in its own stderr.
+    commands = b"--timings status -s\nstatus -s\n"
+    p = subprocess.run([git2cpp_path, "batch"], input=commands, capture_output=True, cwd=tmp_path)
+    assert p.returncode == 0
+    assert p.stderr == b""
+
+    frames = parse_frames(p.stdout)
+    assert len(frames) == 2
+    assert frames[0][0] == 0
+    assert frames[0][2].startswith("timings:\n")
+    assert "status scan" in frames[0][2]
+    assert frames[1] == (0, "", "")
+
+
+def test_batch_fetch(repo_init_with_commit, git2cpp_path, tmp_path):
+    # The progress of fetch is in its frame, the frames that follow are still read by length.
+    clone_cmd = [git2cpp_path, "clone", str(tmp_path), "cloned"]
+    subprocess.run(clone_cmd, capture_output=True, cwd=tmp_path, check=True)
+    (tmp_path / "second.txt").write_text("second")
+    subprocess.run([git2cpp_path, "add", "second.txt"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "second"], cwd=tmp_path, check=True)
+    p_head = subprocess.run(
+        [git2cpp_path, "rev-parse", "HEAD"], capture_output=True, cwd=tmp_path, text=True
+    )
+
+    commands = b"fetch origin\nrev-parse origin/main\n"
+    cloned_path = tmp_path / "cloned"
+    batch_cmd = [git2cpp_path, "batch"]
+    p = subprocess.run(batch_cmd, input=commands, capture_output=True, cwd=cloned_path)
+    assert p.returncode == 0
+
+    frames = parse_frames(p.stdout)
+    assert len(frames) == 2
+    assert frames[0][0] == 0
+    assert "Received" in frames[0][1]
+    assert frames[1] == (0, p_head.stdout, "")
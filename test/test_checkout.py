@@ -170,3 +170,72 @@ def test_checkout_refuses_overwrite(
         branch_cmd = [git2cpp_path, "branch"]
         p_branch = subprocess.run(branch_cmd, capture_output=True, cwd=tmp_path, text=True)
         assert "* newbranch" in p_branch.stdout
+
+
+def test_checkout_refuses_overwrite_same_size(
+    repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path
+):
+    """Local changes keeping the size of the file, made right after the index was written"""
+    initial_file = tmp_path / "initial.txt"
+    subprocess.run([git2cpp_path, "checkout", "-b", "newbranch"], cwd=tmp_path, check=True)
+    initial_file.write_text("Content on newbranch")
+    subprocess.run([git2cpp_path, "add", "initial.txt"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Change on newbranch"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "checkout", "main"], cwd=tmp_path, check=True)
+
+    assert initial_file.read_text() == "initial"
+    initial_file.write_text("changed")
+    (tmp_path / "untracked.txt").write_text("untracked")
+
+    p_checkout = subprocess.run(
+        [git2cpp_path, "checkout", "newbranch"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_checkout.returncode != 0
+    assert "\tinitial.txt\n" in p_checkout.stdout
+    assert "untracked.txt" not in p_checkout.stdout
+
+
+@pytest.mark.parametrize("threads", ["1", "4"])
+def test_checkout_parallel(
+    repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path, threads
+):
+    cmd_set = [git2cpp_path, "config", "set", "git2cpp.checkoutThreads", threads]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+
+    subprocess.run([git2cpp_path, "checkout", "-b", "many"], cwd=tmp_path, check=True)
+    for i in range(40):
+        directory = tmp_path / f"dir{i % 4}" / f"sub{i % 3}"
+        directory.mkdir(parents=True, exist_ok=True)
+        (directory / f"file{i}.txt").write_text(f"content {i}\n")
+    (tmp_path / "initial.txt").write_text("changed on many\n")
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Many files"], cwd=tmp_path, check=True)
+
+    p_main = subprocess.run(
+        [git2cpp_path, "checkout", "main"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_main.returncode == 0
+    assert not (tmp_path / "dir0").exists()
+    assert (tmp_path / "initial.txt").read_text() == "initial"
+
+    p_many = subprocess.run(
+        [git2cpp_path, "checkout", "many"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_many.returncode == 0
+    assert (tmp_path / "dir1" / "sub2" / "file5.txt").read_text() == "content 5\n"
+    assert (tmp_path / "initial.txt").read_text() == "changed on many\n"
+
+    p_status = subprocess.run(
+        [git2cpp_path, "status", "--short"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_status.returncode == 0
+    assert p_status.stdout == ""
+
+    # A file that would be overwritten is still refused.
+    (tmp_path / "initial.txt").write_text("local change\n")
+    p_refused = subprocess.run(
+        [git2cpp_path, "checkout", "main"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_refused.returncode != 0
+    assert "\tinitial.txt\n" in p_refused.stdout
+    assert (tmp_path / "dir1" / "sub2" / "file5.txt").exists()
@@ -144,3 +144,53 @@ def test_clone_gitlab(git2cpp_path, tmp_path, run_in_tmp_path, protocol):
     assert p_status.returncode == 0
     assert "On branch main" in p_status.stdout
     assert "Your branch is up to date with 'origin/main'" in p_status.stdout
+
+
+@pytest.mark.parametrize("filter_spec", ["blob:none", "tree:0"])
+def test_clone_filter(repo_init_with_commit, git2cpp_path, tmp_path, filter_spec):
+    # The repository in tmp_path is cloned through its path, the blobs are fetched from it.
+    for content in ["first version\n", "second version\n"]:
+        (tmp_path / "asset.txt").write_text(content)
+        subprocess.run([git2cpp_path, "add", "asset.txt"], cwd=tmp_path, check=True)
+        subprocess.run([git2cpp_path, "commit", "-m", content], cwd=tmp_path, check=True)
+
+    clone_cmd = [git2cpp_path, "clone", f"--filter={filter_spec}", str(tmp_path), "partial"]
+    p_clone = subprocess.run(clone_cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_clone.returncode == 0
+
+    clone_path = tmp_path / "partial"
+    assert (clone_path / "asset.txt").read_text() == "second version\n"
+    config = (clone_path / ".git" / "config").read_text()
+    assert "promisor = true" in config
+    assert f"partialclonefilter = {filter_spec}" in config
+
+    # The objects of the first commit were not cloned, the diff fetches them.
+    diff_cmd = [git2cpp_path, "--timings", "diff", "HEAD~1", "HEAD"]
+    p_diff = subprocess.run(diff_cmd, capture_output=True, cwd=clone_path, text=True)
+    assert p_diff.returncode == 0
+    assert "-first version" in p_diff.stdout
+    assert "+second version" in p_diff.stdout
+    assert "promisor objects fetched" in p_diff.stderr
+
+    status_cmd = [git2cpp_path, "status"]
+    p_status = subprocess.run(status_cmd, capture_output=True, cwd=clone_path, text=True)
+    assert p_status.returncode == 0
+    assert "Your branch is up to date with 'origin/main'" in p_status.stdout
+
+
+@pytest.mark.parametrize("filter_spec", ["blob:large", "blob:limit=18014398509481984k"])
+def test_clone_filter_invalid(repo_init_with_commit, git2cpp_path, tmp_path, filter_spec):
+    clone_cmd = [git2cpp_path, "clone", f"--filter={filter_spec}", str(tmp_path), "partial"]
+    p_clone = subprocess.run(clone_cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_clone.returncode != 0
+    assert f"invalid filter-spec '{filter_spec}'" in p_clone.stderr
+
+
+def test_clone_filter_failure_removes_directory(git2cpp_path, tmp_path):
+    """A partial clone that fails leaves no directory behind"""
+    source = tmp_path / "not_a_repository"
+    source.mkdir()
+    clone_cmd = [git2cpp_path, "clone", "--filter=blob:none", str(source), "partial"]
+    p_clone = subprocess.run(clone_cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_clone.returncode != 0
+    assert not (tmp_path / "partial").exists()
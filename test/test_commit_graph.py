@@ -0,0 +1,105 @@
+import hashlib
+import subprocess
+
+
+def _commit_file(git2cpp_path, tmp_path, name):
+    (tmp_path / name).write_text(name)
+    subprocess.run([git2cpp_path, "add", name], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", f"Add {name}"], cwd=tmp_path, check=True)
+
+
+def test_commit_graph_write(repo_init_with_commit, git2cpp_path, tmp_path):
+    assert (tmp_path / "initial.txt").exists()
+
+    _commit_file(git2cpp_path, tmp_path, "second.txt")
+    subprocess.run([git2cpp_path, "branch", "other"], cwd=tmp_path, check=True)
+    _commit_file(git2cpp_path, tmp_path, "third.txt")
+
+    cmd_log = [git2cpp_path, "log"]
+    p_log_before = subprocess.run(cmd_log, capture_output=True, cwd=tmp_path, text=True)
+    assert p_log_before.returncode == 0
+
+    cmd_revlist = [git2cpp_path, "rev-list", "HEAD"]
+    p_revlist_before = subprocess.run(cmd_revlist, capture_output=True, cwd=tmp_path, text=True)
+    assert p_revlist_before.returncode == 0
+
+    p_write = subprocess.run(
+        [git2cpp_path, "commit-graph", "write"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_write.returncode == 0
+    graph_file = tmp_path / ".git" / "objects" / "info" / "commit-graph"
+    assert graph_file.exists()
+    assert graph_file.read_bytes()[:4] == b"CGPH"
+
+    p_verify = subprocess.run(
+        [git2cpp_path, "commit-graph", "verify"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_verify.returncode == 0
+
+    # Walks give the same result when using the commit-graph.
+    p_log_after = subprocess.run(cmd_log, capture_output=True, cwd=tmp_path, text=True)
+    assert p_log_after.returncode == 0
+    assert p_log_after.stdout == p_log_before.stdout
+
+    p_revlist_after = subprocess.run(cmd_revlist, capture_output=True, cwd=tmp_path, text=True)
+    assert p_revlist_after.returncode == 0
+    assert p_revlist_after.stdout == p_revlist_before.stdout
+    assert len(p_revlist_after.stdout.splitlines()) == 3
+
+
+def test_commit_graph_verify_corrupt(repo_init_with_commit, git2cpp_path, tmp_path):
+    assert (tmp_path / "initial.txt").exists()
+
+    subprocess.run([git2cpp_path, "commit-graph", "write"], cwd=tmp_path, check=True)
+
+    graph_file = tmp_path / ".git" / "objects" / "info" / "commit-graph"
+    content = bytearray(graph_file.read_bytes())
+    content[-1] ^= 0xFF
+    graph_file.write_bytes(bytes(content))
+
+    p_verify = subprocess.run(
+        [git2cpp_path, "commit-graph", "verify"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_verify.returncode != 0
+    assert "incorrect checksum" in p_verify.stderr
+
+
+def test_commit_graph_verify_without_file(repo_init_with_commit, git2cpp_path, tmp_path):
+    assert (tmp_path / "initial.txt").exists()
+
+    p_verify = subprocess.run(
+        [git2cpp_path, "commit-graph", "verify"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_verify.returncode == 0
+
+
+def test_commit_graph_verify_corrupt_parent(repo_init_with_commit, git2cpp_path, tmp_path):
+    assert (tmp_path / "initial.txt").exists()
+
+    _commit_file(git2cpp_path, tmp_path, "second.txt")
+    subprocess.run([git2cpp_path, "commit-graph", "write"], cwd=tmp_path, check=True)
+
+    graph_file = tmp_path / ".git" / "objects" / "info" / "commit-graph"
+    content = bytearray(graph_file.read_bytes())
+
+    # Find the commit data chunk in the chunk table following the 8 bytes header.
+    chunk_offset = None
+    for i in range(content[6]):
+        entry = 8 + i * 12
+        if content[entry : entry + 4] == b"CDAT":
+            chunk_offset = int.from_bytes(content[entry + 4 : entry + 12], "big")
+    assert chunk_offset is not None
+
+    # Point the first parent of every commit past the end of the graph, and fix the checksum so
+    # that only the parents are wrong.
+    for i in range(2):
+        parent = chunk_offset + i * 36 + 20
+        content[parent : parent + 4] = (0x0FFFFFFF).to_bytes(4, "big")
+    content[-20:] = hashlib.sha1(bytes(content[:-20])).digest()
+    graph_file.write_bytes(bytes(content))
+
+    p_verify = subprocess.run(
+        [git2cpp_path, "commit-graph", "verify"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_verify.returncode != 0
+    assert "commit-graph file is corrupt" in p_verify.stderr
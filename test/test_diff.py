@@ -63,6 +63,34 @@ def test_diff_two_commits(repo_init_with_commit, commit_env_config, git2cpp_path
     assert "+Hello, world!" in p_diff.stdout
 
 
+def test_diff_parallel_matches_serial(repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path):
+    for i in range(40):
+        (tmp_path / f"file{i:02}.txt").write_text(f"line 1\nline 2 of file {i}\nline 3\n")
+    subprocess.run([git2cpp_path, "add", "--all"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Add files"], cwd=tmp_path, check=True)
+    for i in range(0, 40, 2):
+        (tmp_path / f"file{i:02}.txt").write_text(f"line 1\nline 2 of file {i} changed\nline 3\n")
+    (tmp_path / "file01.txt").unlink()
+
+    cmds = [
+        [git2cpp_path, "diff"],
+        [git2cpp_path, "diff", "HEAD~1", "HEAD"],
+        [git2cpp_path, "diff", "--color", "HEAD"],
+    ]
+    serial = [subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True) for cmd in cmds]
+    assert all(p.returncode == 0 for p in serial)
+
+    cmd_set = [git2cpp_path, "config", "set", "git2cpp.diffThreads", "4"]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+
+    for cmd, p_serial in zip(cmds, serial):
+        p_parallel = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+        assert p_parallel.returncode == 0
+        assert p_parallel.stdout == p_serial.stdout
+    assert "+line 2 of file 38 changed" in serial[0].stdout
+    assert "-line 2 of file 1\n" in serial[0].stdout
+
+
 def test_diff_no_index(git2cpp_path, tmp_path):
     file1 = tmp_path / "file1.txt"
     file2 = tmp_path / "file2.txt"
@@ -77,6 +105,46 @@ def test_diff_no_index(git2cpp_path, tmp_path):
     assert "+Python" in p.stdout
 
 
+def test_diff_no_index_identical_files(git2cpp_path, tmp_path):
+    file1 = tmp_path / "file1.txt"
+    file2 = tmp_path / "file2.txt"
+    file1.write_text("Hello\nWorld\n")
+    file2.write_text("Hello\nWorld\n")
+
+    cmd = [git2cpp_path, "diff", "--no-index", str(file1), str(file2)]
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode == 0
+    assert p.stdout == ""
+
+
+def test_diff_no_index_binary_and_empty_files(git2cpp_path, tmp_path):
+    binary1 = tmp_path / "file1.bin"
+    binary2 = tmp_path / "file2.bin"
+    binary1.write_bytes(b"abc\0def\n" * 1000)
+    binary2.write_bytes(b"abc\0xyz\n" * 1000)
+
+    cmd = [git2cpp_path, "diff", "--no-index", str(binary1), str(binary2)]
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode == 0
+    assert "Binary files" in p.stdout
+    assert "abc" not in p.stdout
+
+    empty = tmp_path / "empty.txt"
+    empty.write_text("")
+    text = tmp_path / "text.txt"
+    text.write_text("Hello\n")
+
+    cmd = [git2cpp_path, "diff", "--no-index", str(empty), str(text)]
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode == 0
+    assert "+Hello" in p.stdout
+
+    cmd = [git2cpp_path, "diff", "--no-index", str(text), str(tmp_path / "missing.txt")]
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode != 0
+    assert "Could not access" in p.stderr
+
+
 def test_diff_stat(repo_init_with_commit, git2cpp_path, tmp_path):
     initial_file = tmp_path / "initial.txt"
     assert (initial_file).exists()
@@ -123,6 +191,74 @@ def test_diff_numstat(repo_init_with_commit, git2cpp_path, tmp_path):
     assert "Modified content" not in p.stdout
 
 
+def test_diff_numstat_counts(repo_init_with_commit, git2cpp_path, tmp_path):
+    """Line counts of modified, added, deleted and binary files, between commits and in the worktree"""
+    lines = [f"line {i}\n" for i in range(100)]
+    (tmp_path / "modified.txt").write_text("".join(lines))
+    (tmp_path / "deleted.txt").write_text("a\nb\nc\n")
+    (tmp_path / "image.bin").write_bytes(b"\0\1\2")
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "files"], cwd=tmp_path, check=True)
+
+    lines[10] = "changed\n"
+    del lines[50]
+    lines[80:80] = ["inserted 1\n", "inserted 2\n"]
+    (tmp_path / "modified.txt").write_text("".join(lines))
+    (tmp_path / "deleted.txt").unlink()
+    (tmp_path / "added.txt").write_text("x\ny")
+    (tmp_path / "image.bin").write_bytes(b"\0\1\3")
+
+    p = subprocess.run(
+        [git2cpp_path, "diff", "--numstat"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p.returncode == 0
+    assert "3       2       modified.txt\n" in p.stdout
+
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "changes"], cwd=tmp_path, check=True)
+
+    p = subprocess.run(
+        [git2cpp_path, "diff", "--numstat", "HEAD~1", "HEAD"],
+        capture_output=True,
+        cwd=tmp_path,
+        text=True,
+    )
+    assert p.returncode == 0
+    assert p.stdout == (
+        "2       0       added.txt\n"
+        "0       3       deleted.txt\n"
+        "-       -       image.bin\n"
+        "3       2       modified.txt\n"
+    )
+
+    p = subprocess.run(
+        [git2cpp_path, "diff", "--shortstat", "HEAD~1", "HEAD"],
+        capture_output=True,
+        cwd=tmp_path,
+        text=True,
+    )
+    assert p.returncode == 0
+    assert p.stdout == " 4 files changed, 5 insertions(+), 5 deletions(-)\n"
+
+
+def test_diff_numstat_diff_attribute(repo_init_with_commit, git2cpp_path, tmp_path):
+    """A set diff attribute counts the lines of files with NUL bytes, an unset one hides them"""
+    (tmp_path / ".gitattributes").write_text("text.bin diff\nhidden.txt -diff\n")
+    (tmp_path / "text.bin").write_bytes(b"a\0\nb\n")
+    (tmp_path / "hidden.txt").write_text("a\nb\n")
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "attributes"], cwd=tmp_path, check=True)
+
+    (tmp_path / "text.bin").write_bytes(b"a\0\nc\n")
+    (tmp_path / "hidden.txt").write_text("a\nc\n")
+
+    p = subprocess.run(
+        [git2cpp_path, "diff", "--numstat"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p.returncode == 0
+    assert p.stdout == "-       -       hidden.txt\n1       1       text.bin\n"
+
+
 def test_diff_summary(repo_init_with_commit, git2cpp_path, tmp_path):
     """Test diff with --summary"""
     assert (tmp_path / "initial.txt").exists()
@@ -660,6 +796,86 @@ def test_diff_find_copies_harder(
     assert "copy to copied.txt" in p.stdout
 
 
+def test_diff_find_copies_harder_signature_cache(
+    repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path
+):
+    """Copy sources among many unmodified files, found through the signatures stored in .git"""
+    for i in range(50):
+        (tmp_path / f"file{i}.txt").write_text("".join(f"file {i} line {j}\n" for j in range(20)))
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "add files"], cwd=tmp_path, check=True)
+
+    content = (tmp_path / "file17.txt").read_text().replace("line 5\n", "line five\n")
+    (tmp_path / "copied.txt").write_text(content)
+    subprocess.run([git2cpp_path, "add", "copied.txt"], cwd=tmp_path, check=True)
+
+    # Without the config entry, libgit2 compares every unmodified file.
+    cmd = [git2cpp_path, "--timings", "diff", "--cached", "-C", "--find-copies-harder"]
+    p_exact = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_exact.returncode == 0
+    assert "copy from file17.txt" in p_exact.stdout
+    assert "copy sources" not in p_exact.stderr
+
+    cmd_set = [git2cpp_path, "config", "set", "git2cpp.copySourceIndex", "true"]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode == 0
+    assert p.stdout == p_exact.stdout
+    assert "signatures computed" in p.stderr
+    signatures = tmp_path / ".git" / "git2cpp" / "signatures"
+    size = signatures.stat().st_size
+
+    # The second run only reads the signatures, the file is not written again.
+    p_cached = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_cached.returncode == 0
+    assert p_cached.stdout == p.stdout
+    assert "signature cache hits" in p_cached.stderr
+    assert "signatures computed" not in p_cached.stderr
+    assert signatures.stat().st_size == size
+
+    # Under a limit of 10 signatures, the file is written again with the ones used by the command.
+    cmd_limit = [git2cpp_path, "config", "set", "git2cpp.signatureCacheLimit", "1500"]
+    subprocess.run(cmd_limit, cwd=tmp_path, check=True)
+    (tmp_path / "copied.txt").write_text(content + "one more line\n")
+    subprocess.run([git2cpp_path, "add", "copied.txt"], cwd=tmp_path, check=True)
+    p_limited = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_limited.returncode == 0
+    assert "copy from file17.txt" in p_limited.stdout
+    assert "signature cache evictions" in p_limited.stderr
+    assert signatures.stat().st_size <= 1500 + len("git2cpp signatures 1\n")
+
+
+def test_diff_stat_cache(repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path):
+    """The stats of blob pairs are stored in .git and reused, unless git2cpp.diffCacheLimit is 0"""
+    (tmp_path / "initial.txt").write_text("".join(f"line {i}\n" for i in range(30)))
+    (tmp_path / "added.txt").write_text("one\ntwo\n")
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "second"], cwd=tmp_path, check=True)
+
+    cache_file = tmp_path / ".git" / "git2cpp" / "diff-stats-cache"
+    cmd = [git2cpp_path, "--timings", "diff", "--numstat", "HEAD~1", "HEAD"]
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode == 0
+    assert "diff stats cache hits" not in p.stderr
+    assert cache_file.exists()
+    generation = cache_file.read_bytes().split(b"\n")[1]
+
+    # A command only reading the cache still stores the recency of the entries it used.
+    p_cached = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_cached.returncode == 0
+    assert p_cached.stdout == p.stdout
+    assert "diff stats cache hits" in p_cached.stderr
+    assert int(cache_file.read_bytes().split(b"\n")[1]) == int(generation) + 1
+
+    cache_file.unlink()
+    cmd_set = [git2cpp_path, "config", "set", "git2cpp.diffCacheLimit", "0"]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+    p_uncached = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_uncached.returncode == 0
+    assert p_uncached.stdout == p.stdout
+    assert not cache_file.exists()
+
+
 @pytest.mark.parametrize("copies_flag", ["-C50", "--find-copies=50"])
 def test_diff_find_copies_with_threshold(
     repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path, copies_flag
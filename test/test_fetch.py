@@ -27,3 +27,61 @@ def test_fetch_private_repo(git2cpp_path, tmp_path, run_in_tmp_path, private_tes
     p_branch = subprocess.run(branch_cmd, capture_output=True, text=True)
     assert p_branch.returncode == 0
     assert "origin/main" in p_branch.stdout
+
+
+def test_fetch_deepen(git2cpp_path, tmp_path, run_in_tmp_path):
+    clone_cmd = [git2cpp_path, "clone", "--depth", "1", "https://github.com/xtensor-stack/xtl.git"]
+    p_clone = subprocess.run(clone_cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_clone.returncode == 0
+    xtl_path = tmp_path / "xtl"
+
+    fetch_cmd = [git2cpp_path, "fetch", "--deepen", "2"]
+    p_fetch = subprocess.run(fetch_cmd, capture_output=True, cwd=xtl_path, text=True)
+    assert p_fetch.returncode == 0
+    # The depth of the clone before the fetch is stored.
+    memo = (xtl_path / ".git" / "git2cpp" / "shallow-depth").read_text()
+    assert memo.splitlines()[-1] == "1"
+
+    p_log = subprocess.run([git2cpp_path, "log"], capture_output=True, cwd=xtl_path, text=True)
+    assert p_log.returncode == 0
+    assert p_log.stdout.count("Author") == 3
+
+
+def test_fetch_deepen_merge_history(repo_init_with_commit, git2cpp_path, tmp_path):
+    """The depth of a shallow history with a merge, counted along the shortest path, and stored"""
+    p_rev = subprocess.run(
+        [git2cpp_path, "rev-parse", "HEAD"], capture_output=True, cwd=tmp_path, text=True
+    )
+    root = p_rev.stdout.strip()
+
+    def commit_file(name):
+        (tmp_path / name).write_text(name)
+        subprocess.run([git2cpp_path, "add", name], cwd=tmp_path, check=True)
+        subprocess.run([git2cpp_path, "commit", "-m", name], cwd=tmp_path, check=True)
+
+    # Two commits on side and one on main, merged: the initial commit is at depth 3 through main
+    # and 4 through side.
+    subprocess.run([git2cpp_path, "checkout", "-b", "side"], cwd=tmp_path, check=True)
+    commit_file("side1.txt")
+    commit_file("side2.txt")
+    subprocess.run([git2cpp_path, "checkout", "main"], cwd=tmp_path, check=True)
+    commit_file("main.txt")
+    subprocess.run([git2cpp_path, "merge", "side"], cwd=tmp_path, check=True)
+
+    # A shallow repository whose remote cannot be reached: the fetch fails once the depth is
+    # computed.
+    (tmp_path / ".git" / "shallow").write_text(root + "\n")
+    remote_cmd = [git2cpp_path, "remote", "add", "origin", str(tmp_path / "missing")]
+    subprocess.run(remote_cmd, cwd=tmp_path, check=True)
+
+    fetch_cmd = [git2cpp_path, "--timings", "fetch", "--deepen", "1"]
+    p_fetch = subprocess.run(fetch_cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_fetch.returncode != 0
+    assert "shallow depth memo hits" not in p_fetch.stderr
+    memo = (tmp_path / ".git" / "git2cpp" / "shallow-depth").read_text()
+    assert memo.splitlines()[-1] == "3"
+
+    # The same HEAD and shallow file: the fetch run again reads the stored depth.
+    p_again = subprocess.run(fetch_cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_again.returncode != 0
+    assert "shallow depth memo hits" in p_again.stderr
@@ -1,3 +1,4 @@
+import json
 import pytest
 import re
 import subprocess
@@ -22,6 +23,38 @@ def test_error_on_unknown_option(git2cpp_path):
     assert p.stderr.startswith(b"The following argument was not expected: --unknown")
 
 
+def test_timings(repo_init_with_commit, git2cpp_path, tmp_path):
+    cmd = [git2cpp_path, "status", "--short"]
+    p_plain = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_plain.returncode == 0
+
+    cmd = [git2cpp_path, "--timings", "status", "--short"]
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode == 0
+    assert p.stdout == p_plain.stdout
+    assert p.stderr.startswith("timings:\n")
+    assert "repository open" in p.stderr
+    assert "status scan" in p.stderr
+    assert p_plain.stderr == ""
+
+
+@pytest.mark.skipif(GIT2CPP_TEST_WASM, reason="Chrome trace file not written in WebAssembly tests")
+def test_trace_file(repo_init_with_commit, git2cpp_path, tmp_path, monkeypatch):
+    trace_path = tmp_path / "trace.json"
+    monkeypatch.setenv("GIT2CPP_TRACE", str(trace_path))
+
+    cmd = [git2cpp_path, "log"]
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode == 0
+    assert "commits walked" in p.stderr
+
+    events = json.loads(trace_path.read_text())["traceEvents"]
+    names = {event["name"] for event in events}
+    assert "repository open" in names
+    assert "commits walked" in names
+    assert all(event["ph"] in ("X", "C") for event in events)
+
+
 @pytest.mark.skipif(not GIT2CPP_TEST_WASM, reason="Only test in WebAssembly")
 def test_cockle_config(git2cpp_path):
     # Check cockle-config shows git2cpp is available.
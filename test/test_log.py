@@ -377,3 +377,58 @@ def test_log_oneline_no_abbrev_commit(repo_init_with_commit, git2cpp_path, tmp_p
 
     assert full_sha in p.stdout
     assert "Initial commit" in p.stdout
+
+
+def test_log_refs_on_older_commits(repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path):
+    """Test that tags and branches are attached to the commit they point to, not only to HEAD."""
+    assert (tmp_path / "initial.txt").exists()
+
+    subprocess.run([git2cpp_path, "tag", "v0.1"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "branch", "old-branch"], cwd=tmp_path, check=True)
+
+    p = tmp_path / "second.txt"
+    p.write_text("second file")
+    subprocess.run([git2cpp_path, "add", "second.txt"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Second commit"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "tag", "v0.2"], cwd=tmp_path, check=True)
+
+    p_log = subprocess.run([git2cpp_path, "log"], capture_output=True, cwd=tmp_path, text=True)
+    assert p_log.returncode == 0
+
+    lines = strip_ansi_colours(p_log.stdout).split("\n")
+    commit_lines = [line for line in lines if line.startswith("commit")]
+    assert len(commit_lines) == 2
+    assert "HEAD ->" in commit_lines[0]
+    assert "tag: v0.2" in commit_lines[0]
+    assert "old-branch" not in commit_lines[0]
+    assert "HEAD" not in commit_lines[1]
+    assert "tag: v0.1" in commit_lines[1]
+    assert "old-branch" in commit_lines[1]
+
+
+def test_log_long_output(repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path):
+    """Test that a log longer than the lines kept by the pager is written whole and in order."""
+    assert (tmp_path / "initial.txt").exists()
+
+    commit_count = 60
+    body_lines = 200
+    for i in range(commit_count):
+        (tmp_path / f"file{i}.txt").write_text(f"file {i}")
+        subprocess.run([git2cpp_path, "add", f"file{i}.txt"], cwd=tmp_path, check=True)
+        body = "\n".join(f"commit {i} line {j}" for j in range(body_lines))
+        cmd_commit = [git2cpp_path, "commit", "-m", f"Commit {i}\n\n{body}"]
+        subprocess.run(cmd_commit, cwd=tmp_path, check=True)
+
+    # stdout is not a tty, the log is not paged but still produced by the pager's producer.
+    p_log = subprocess.run([git2cpp_path, "log"], capture_output=True, cwd=tmp_path, text=True)
+    assert p_log.returncode == 0
+
+    lines = strip_ansi_colours(p_log.stdout).split("\n")
+    assert len(lines) > 10000
+    body = [line for line in lines if re.fullmatch(r"    commit \d+ line \d+", line)]
+    expected = [
+        f"    commit {i} line {j}" for i in reversed(range(commit_count)) for j in range(body_lines)
+    ]
+    assert body == expected
+    assert lines[-2] == "    Initial commit"
+    assert lines[-1] == ""
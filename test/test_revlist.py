@@ -21,3 +21,72 @@ def test_revlist(repo_init_with_commit, commit_env_config, git2cpp_path, tmp_pat
     assert len(lines) == 2
     assert all(len(oid) == 40 for oid in lines)
     assert lines[0] != lines[1]
+
+
+def test_revlist_range_and_count(repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path):
+    p = tmp_path / "initial.txt"
+    for i in range(2, 5):
+        p.write_text(f"commit{i}")
+        subprocess.run([git2cpp_path, "add", "initial.txt"], cwd=tmp_path, check=True)
+        subprocess.run([git2cpp_path, "commit", "-m", f"commit {i}"], cwd=tmp_path, check=True)
+
+    cmd = [git2cpp_path, "rev-list", "HEAD"]
+    p_all = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_all.returncode == 0
+    all_oids = p_all.stdout.splitlines()
+    assert len(all_oids) == 4
+
+    cmd = [git2cpp_path, "rev-list", "HEAD~3..HEAD"]
+    p_range = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_range.returncode == 0
+    assert p_range.stdout.splitlines() == all_oids[:3]
+
+    cmd = [git2cpp_path, "rev-list", "HEAD", "^HEAD~2"]
+    p_exclude = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_exclude.returncode == 0
+    assert p_exclude.stdout.splitlines() == all_oids[:2]
+
+    cmd = [git2cpp_path, "rev-list", "--count", "HEAD~3..HEAD"]
+    p_count = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_count.returncode == 0
+    assert p_count.stdout == "3\n"
+
+    cmd = [git2cpp_path, "rev-list", "--count", "HEAD~1...HEAD~3"]
+    p_symmetric = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_symmetric.returncode == 0
+    assert p_symmetric.stdout == "2\n"
+
+    cmd = [git2cpp_path, "rev-list", "unknown..HEAD"]
+    p_bad = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_bad.returncode != 0
+    assert "bad revision 'unknown'" in p_bad.stderr
+
+
+def test_revlist_objects(repo_init_with_commit, commit_env_config, git2cpp_path, tmp_path):
+    (tmp_path / "dir").mkdir()
+    (tmp_path / "dir" / "file.txt").write_text("content")
+    subprocess.run([git2cpp_path, "add", "dir/file.txt"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Add dir"], cwd=tmp_path, check=True)
+
+    cmd = [git2cpp_path, "rev-list", "--objects", "HEAD~1..HEAD"]
+    p = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p.returncode == 0
+
+    # The commit, the new root tree, dir and dir/file.txt, but not initial.txt which is unchanged
+    lines = p.stdout.splitlines()
+    assert len(lines) == 4
+    assert len(lines[0]) == 40
+    assert lines[1].endswith(" ")
+    assert [line[41:] for line in lines[2:]] == ["dir", "dir/file.txt"]
+
+    cmd = [git2cpp_path, "rev-list", "--objects", "--count", "HEAD~1..HEAD"]
+    p_count = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_count.returncode == 0
+    assert p_count.stdout == "4\n"
+
+
+    # The commits and trees walked are looked up through the repository
+    cmd = [git2cpp_path, "--timings", "rev-list", "--objects", "HEAD"]
+    p_timings = subprocess.run(cmd, capture_output=True, cwd=tmp_path, text=True)
+    assert p_timings.returncode == 0
+    assert "object lookups" in p_timings.stderr
@@ -0,0 +1,112 @@
+import subprocess
+
+import pytest
+
+
+@pytest.fixture
+def repo_with_directories(repo_init_with_commit, git2cpp_path, tmp_path):
+    files = ["a/x.txt", "a/sub/y.txt", "b/z.txt", "c/top.txt", "c/d/w.txt", "root.txt"]
+    for name in files:
+        path = tmp_path / name
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(f"content of {name}\n")
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Directories"], cwd=tmp_path, check=True)
+
+
+def test_sparse_checkout_set(repo_with_directories, git2cpp_path, tmp_path):
+    cmd_set = [git2cpp_path, "sparse-checkout", "set", "a", "c/d"]
+    p_set = subprocess.run(cmd_set, capture_output=True, cwd=tmp_path, text=True)
+    assert p_set.returncode == 0
+
+    assert (tmp_path / "a" / "sub" / "y.txt").exists()
+    assert (tmp_path / "c" / "top.txt").exists()
+    assert (tmp_path / "c" / "d" / "w.txt").exists()
+    assert (tmp_path / "root.txt").exists()
+    assert not (tmp_path / "b").exists()
+
+    patterns = (tmp_path / ".git" / "info" / "sparse-checkout").read_text()
+    assert patterns == "/*\n!/*/\n/a/\n/c/\n!/c/*/\n/c/d/\n"
+
+    p_list = subprocess.run(
+        [git2cpp_path, "sparse-checkout", "list"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_list.returncode == 0
+    assert p_list.stdout == "a\nc/d\n"
+
+    # The files outside of the sparse checkout are neither deleted nor staged as deleted.
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    p_status = subprocess.run(
+        [git2cpp_path, "status", "--short"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_status.returncode == 0
+    assert p_status.stdout == ""
+
+    p_add = subprocess.run(
+        [git2cpp_path, "sparse-checkout", "add", "b"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_add.returncode == 0
+    assert (tmp_path / "b" / "z.txt").read_text() == "content of b/z.txt\n"
+
+    p_disable = subprocess.run(
+        [git2cpp_path, "sparse-checkout", "disable"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_disable.returncode == 0
+    assert (tmp_path / "b" / "z.txt").exists()
+    assert (tmp_path / "c" / "d" / "w.txt").exists()
+
+
+def test_sparse_checkout_switch_branch(repo_with_directories, git2cpp_path, tmp_path):
+    subprocess.run([git2cpp_path, "checkout", "-b", "other"], cwd=tmp_path, check=True)
+    (tmp_path / "a" / "x.txt").write_text("changed a\n")
+    (tmp_path / "b" / "z.txt").write_text("changed b\n")
+    (tmp_path / "b" / "new.txt").write_text("new b\n")
+    subprocess.run([git2cpp_path, "add", "-A"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Other"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "checkout", "main"], cwd=tmp_path, check=True)
+
+    subprocess.run([git2cpp_path, "sparse-checkout", "set", "a"], cwd=tmp_path, check=True)
+    assert not (tmp_path / "b").exists()
+
+    p_checkout = subprocess.run(
+        [git2cpp_path, "checkout", "other"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_checkout.returncode == 0
+    assert (tmp_path / "a" / "x.txt").read_text() == "changed a\n"
+    assert not (tmp_path / "b").exists()
+
+    p_status = subprocess.run(
+        [git2cpp_path, "status", "--short"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_status.returncode == 0
+    assert p_status.stdout == ""
+
+    subprocess.run([git2cpp_path, "sparse-checkout", "disable"], cwd=tmp_path, check=True)
+    assert (tmp_path / "b" / "z.txt").read_text() == "changed b\n"
+    assert (tmp_path / "b" / "new.txt").read_text() == "new b\n"
+
+
+def test_sparse_checkout_staged_change(repo_with_directories, git2cpp_path, tmp_path):
+    """A staged change of a file outside of the sparse checkout shows without the deletion"""
+    (tmp_path / "b" / "z.txt").write_text("staged b\n")
+    subprocess.run([git2cpp_path, "add", "b/z.txt"], cwd=tmp_path, check=True)
+    cmd_config = [git2cpp_path, "config", "set", "git2cpp.statusCache", "true"]
+    subprocess.run(cmd_config, cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "sparse-checkout", "set", "a"], cwd=tmp_path, check=True)
+    assert not (tmp_path / "b").exists()
+
+    # The second status is read from the status cache.
+    for _ in range(2):
+        p_status = subprocess.run(
+            [git2cpp_path, "status", "--short"], capture_output=True, cwd=tmp_path, text=True
+        )
+        assert p_status.returncode == 0
+        assert p_status.stdout == "M  b/z.txt\n"
+
+
+def test_sparse_checkout_list_not_sparse(repo_init_with_commit, git2cpp_path, tmp_path):
+    p_list = subprocess.run(
+        [git2cpp_path, "sparse-checkout", "list"], capture_output=True, cwd=tmp_path, text=True
+    )
+    assert p_list.returncode != 0
+    assert "this worktree is not sparse" in p_list.stderr
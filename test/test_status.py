@@ -1,6 +1,7 @@
 # from pathlib import Path
 import os
 import subprocess
+import time
 
 import pytest
 
@@ -372,3 +373,91 @@ def test_status_all_headers_shown(repo_init_with_commit, git2cpp_path, tmp_path)
     assert 'use "git add <file>..." to update what will be committed' in p.stdout
     assert "Untracked files:" in p.stdout
     assert 'use "git add <file>..." to include in what will be committed' in p.stdout
+
+
+@pytest.mark.parametrize("short_flag", ["", "-s"])
+def test_status_parallel_matches_serial(repo_init_with_commit, git2cpp_path, tmp_path, short_flag):
+    """Test that the sharded status scan reports the same entries as the serial one"""
+    for name in ["a", "b", "c"]:
+        (tmp_path / name).mkdir()
+        (tmp_path / name / "tracked.txt").write_text(name)
+    (tmp_path / "top.txt").write_text("top")
+    subprocess.run([git2cpp_path, "add", "--all"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Add dirs"], cwd=tmp_path, check=True)
+
+    (tmp_path / "a" / "tracked.txt").write_text("modified")
+    (tmp_path / "b" / "staged.txt").write_text("staged")
+    subprocess.run([git2cpp_path, "add", "b/staged.txt"], cwd=tmp_path, check=True)
+    (tmp_path / "c" / "untracked.txt").write_text("untracked")
+    (tmp_path / "d").mkdir()
+    (tmp_path / "d" / "new.txt").write_text("new")
+
+    cmd_status = [git2cpp_path, "status"]
+    if short_flag:
+        cmd_status.append(short_flag)
+    cmd_timings = [git2cpp_path, "--timings"] + cmd_status[1:]
+
+    def check_parallel_matches_serial():
+        subprocess.run(
+            [git2cpp_path, "config", "set", "git2cpp.statusThreads", "1"], cwd=tmp_path, check=True
+        )
+        p_serial = subprocess.run(cmd_status, capture_output=True, cwd=tmp_path, text=True)
+        assert p_serial.returncode == 0
+
+        subprocess.run(
+            [git2cpp_path, "config", "set", "git2cpp.statusThreads", "4"], cwd=tmp_path, check=True
+        )
+        p_parallel = subprocess.run(cmd_timings, capture_output=True, cwd=tmp_path, text=True)
+        assert p_parallel.returncode == 0
+        assert p_parallel.stdout == p_serial.stdout
+        return p_parallel.stderr
+
+    # Additions in several shards cannot be renames, the shards are merged
+    timings = check_parallel_matches_serial()
+    assert "status shards merged" in timings
+    assert "status shard fallbacks" not in timings
+
+    # A deletion in one shard and additions in other ones fall back to the serial scan
+    (tmp_path / "top.txt").unlink()
+    timings = check_parallel_matches_serial()
+    assert "status shard fallbacks" in timings
+
+    # A rename across top-level directories falls back to the serial scan
+    os.rename(tmp_path / "a" / "tracked.txt", tmp_path / "d" / "tracked.txt")
+    subprocess.run([git2cpp_path, "add", "--all"], cwd=tmp_path, check=True)
+    p_rename = subprocess.run(cmd_status, capture_output=True, cwd=tmp_path, text=True)
+    assert p_rename.returncode == 0
+    assert "a/tracked.txt -> d/tracked.txt" in p_rename.stdout
+
+
+def test_status_cache(repo_init_with_commit, git2cpp_path, tmp_path):
+    """Test that the cached status is reused and refreshed when the worktree changes"""
+    (tmp_path / "dir").mkdir()
+    (tmp_path / "dir" / "tracked.txt").write_text("tracked")
+    subprocess.run([git2cpp_path, "add", "dir/tracked.txt"], cwd=tmp_path, check=True)
+    subprocess.run([git2cpp_path, "commit", "-m", "Add dir"], cwd=tmp_path, check=True)
+    (tmp_path / "untracked.txt").write_text("untracked")
+
+    cmd_set = [git2cpp_path, "config", "set", "git2cpp.statusCache", "true"]
+    subprocess.run(cmd_set, cwd=tmp_path, check=True)
+
+    # Paths modified during the second of the scan are not cached
+    time.sleep(1.1)
+
+    cmd_status = [git2cpp_path, "status", "-s"]
+    p_first = subprocess.run(cmd_status, capture_output=True, cwd=tmp_path, text=True)
+    assert p_first.returncode == 0
+    assert "?? untracked.txt" in p_first.stdout
+    assert (tmp_path / ".git" / "git2cpp" / "status-cache").exists()
+
+    p_cached = subprocess.run(cmd_status, capture_output=True, cwd=tmp_path, text=True)
+    assert p_cached.returncode == 0
+    assert p_cached.stdout == p_first.stdout
+
+    (tmp_path / "dir" / "new.txt").write_text("new")
+    (tmp_path / "dir" / "tracked.txt").write_text("modified")
+    p_changed = subprocess.run(cmd_status, capture_output=True, cwd=tmp_path, text=True)
+    assert p_changed.returncode == 0
+    assert "?? dir/new.txt" in p_changed.stdout
+    assert " M dir/tracked.txt" in p_changed.stdout
+    assert "?? untracked.txt" in p_changed.stdout